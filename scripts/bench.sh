@@ -0,0 +1,6 @@
+#!/usr/bin/env bash
+# Software rendered offscreen, numbers and frame hashes don't depend on the GPU.
+# Frames are checked against render_bench_hashes.txt, taken with lands.pack
+# compiled from Natural Earth ne_10m_land by map_compiler_cli.
+ninja && DATA_ROOT=../data SHADERS_ROOT=../src/render_lib/render_units/ LIBGL_ALWAYS_SOFTWARE=1 \
+    ./src/render_demo/render_bench --check-hashes ../scripts/render_bench_hashes.txt "$@"
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Allocator whose construct() without arguments default-initializes instead of
+// value-initializing, so resize() of a vector of trivial types leaves new
+// elements uninitialized rather than zero-filling them. Meant for output
+// buffers sized up front and then written in full.
+template <class T, class A = std::allocator<T>> class default_init_allocator : public A {
+    using traits = std::allocator_traits<A>;
+
+  public:
+    template <class U> struct rebind {
+        using other = default_init_allocator<U, typename traits::template rebind_alloc<U>>;
+    };
+
+    using A::A;
+
+    template <class U> void construct(U *p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void *>(p)) U;
+    }
+    template <class U, class... Args> void construct(U *p, Args &&...args) {
+        traits::construct(static_cast<A &>(*this), p, std::forward<Args>(args)...);
+    }
+};
+
+// Vector whose resize() does not zero-fill, see default_init_allocator.
+template <class T> using uninit_vector = std::vector<T, default_init_allocator<T>>;
@@ -2,6 +2,7 @@
 
 #include "log.h"
 #include <glad/glad.h>
+#include <string_view>
 
 inline void check_opengl_err(const char *stmt, const char *fname, int line) {
     if (auto err = glGetError(); err != GL_NO_ERROR) {
@@ -15,3 +16,16 @@ inline void check_opengl_err(const char *stmt, const char *fname, int line) {
         Statement;                                                                                 \
         check_opengl_err(#Statement, __FILE__, __LINE__);                                          \
     } while (false)
+
+// Extension is reported by the current context.
+inline bool has_gl_extension(std::string_view name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        auto *ext = reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+        if (ext && name == ext) {
+            return true;
+        }
+    }
+    return false;
+}
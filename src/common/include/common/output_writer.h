@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cassert>
+
+#include "span.hpp"
+
+// Append-only cursor over storage allocated up front, normally sized exactly
+// with required_capacity() of the code producing the output. Running out of
+// space means capacity was computed wrong, so it is asserted instead of
+// silently truncating.
+template <class T> class OutputWriter {
+  public:
+    explicit OutputWriter(nonstd::span<T> storage) : m_storage(storage) {}
+
+    void push_back(const T &v) {
+        assert(m_size < m_storage.size());
+        m_storage[m_size++] = v;
+    }
+    // Reserves next n elements and returns them for filling in.
+    nonstd::span<T> append(size_t n) {
+        assert(n <= remaining());
+        auto res = m_storage.subspan(m_size, n);
+        m_size += n;
+        return res;
+    }
+
+    size_t size() const { return m_size; }
+    size_t remaining() const { return m_storage.size() - m_size; }
+    nonstd::span<T> written() const { return m_storage.first(m_size); }
+
+  private:
+    nonstd::span<T> m_storage;
+    size_t m_size = 0;
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+inline size_t default_concurrency() {
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+// Runs worker(worker_idx) on `workers` threads (one of them is calling thread)
+// and waits for all of them. If any of workers throws, first exception is
+// rethrown after all workers are finished.
+template <class Worker> void run_workers(size_t workers, Worker &&worker) {
+    workers = std::max<size_t>(workers, 1);
+
+    std::mutex error_mutex;
+    std::exception_ptr first_error;
+    auto guarded = [&](size_t worker_idx) {
+        try {
+            worker(worker_idx);
+        } catch (...) {
+            auto lock = std::unique_lock(error_mutex);
+            if (!first_error) {
+                first_error = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t i = 1; i < workers; ++i) {
+        threads.emplace_back(guarded, i);
+    }
+    guarded(0);
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    if (first_error) {
+        std::rethrow_exception(first_error);
+    }
+}
+
+} // namespace parallel
@@ -50,38 +50,41 @@ std::array<tile_id_t, 4> children_tiles(tile_at_level_t tile) {
 }
 
 namespace utils {
-std::vector<p32> eliminate_parallel_segments(std::vector<p32> points) {
-    const size_t N = points.size();
+p32 *eliminate_parallel_segments(p32 *first, p32 *last) {
+    const size_t N = last - first;
     if (N < 3) {
         throw std::runtime_error("eliminate_parallel_segments: N < 3");
     }
     size_t l = 0;
     size_t r = 1;
-    while (r < points.size() - 1) {
-        gg::v2 p0(points[l]);
-        gg::v2 p1(points[r]);
-        gg::v2 p2(points[r + 1]);
+    while (r < N - 1) {
+        gg::v2 p0(first[l]);
+        gg::v2 p1(first[r]);
+        gg::v2 p2(first[r + 1]);
         gg::v2 a(p0, p1);
         gg::v2 b(p1, p2);
         gg::v2 br(-b.y, b.x);
         if (std::abs(dot(a, br)) < 1e-5) {
-            points[r].x = gg::U32_MAX; // todo: this is not good since we steal valid point
-                                       // which can naturally occur during tiles cuts or clamps.
-            points[r].y = gg::U32_MAX;
+            first[r].x = gg::U32_MAX; // todo: this is not good since we steal valid point
+                                      // which can naturally occur during tiles cuts or clamps.
+            first[r].y = gg::U32_MAX;
             r++;
         } else {
             r++;
-            while ((points[++l].x == gg::U32_MAX) && (points[++l].y == gg::U32_MAX)) {
+            while ((first[++l].x == gg::U32_MAX) && (first[++l].y == gg::U32_MAX)) {
                 // hop through wholes
             }
         }
     }
-    const size_t points_before = points.size();
-    points.erase(
-        std::remove_if(std::begin(points), std::end(points),
-                       [](const gg::p32 &v) { return v.x == gg::U32_MAX && v.y == gg::U32_MAX; }),
-        std::end(points));
-    return std::move(points);
+    return std::remove_if(first, last, [](const gg::p32 &v) {
+        return v.x == gg::U32_MAX && v.y == gg::U32_MAX;
+    });
+}
+
+std::vector<p32> eliminate_parallel_segments(std::vector<p32> points) {
+    p32 *new_end = eliminate_parallel_segments(points.data(), points.data() + points.size());
+    points.resize(new_end - points.data());
+    return points;
 }
 } // namespace utils
 
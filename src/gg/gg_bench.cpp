@@ -0,0 +1,102 @@
+#include "gg/corpus.h"
+#include "gg/gg.h"
+#include <benchmark/benchmark.h>
+
+// Microbenchmarks of gg kernels on synthetic inputs, see gg/corpus.h. Sizes
+// are points per call.
+
+namespace {
+void BM_lat_to_yu(benchmark::State &state) {
+    std::vector<double> lon, lat;
+    gg::corpus::random_lon_lat(state.range(0), 1, lon, lat);
+    for (auto _ : state) {
+        for (double v : lat) {
+            benchmark::DoNotOptimize(gg::mercator::lat_to_yu(v));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lat.size());
+}
+BENCHMARK(BM_lat_to_yu)->Arg(4096);
+
+void BM_lon_to_xu(benchmark::State &state) {
+    std::vector<double> lon, lat;
+    gg::corpus::random_lon_lat(state.range(0), 1, lon, lat);
+    for (auto _ : state) {
+        for (double v : lon) {
+            benchmark::DoNotOptimize(gg::mercator::lon_to_xu(v));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * lon.size());
+}
+BENCHMARK(BM_lon_to_xu)->Arg(4096);
+
+// The batch both of the above are replaced with, by kernel.
+void BM_project_batch(benchmark::State &state) {
+    const auto kernel = static_cast<gg::simd::Isa>(state.range(1));
+    // project_batch would fall back to a slower kernel and report its timing
+    // under this one's name.
+    if (kernel > gg::mercator::best_batch_kernel()) {
+        state.SkipWithError(kernel == gg::simd::Isa::avx2 ? "AVX2 kernel is not available"
+                                                          : "SSE2 kernel is not available");
+        return;
+    }
+    std::vector<double> lon, lat;
+    gg::corpus::random_lon_lat(state.range(0), 1, lon, lat);
+    std::vector<gg::p32> out(lon.size());
+    for (auto _ : state) {
+        gg::mercator::project_batch(lon.data(), lat.data(), lon.size(), out.data(), kernel);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * lon.size());
+}
+BENCHMARK(BM_project_batch)
+    ->ArgNames({"points", "kernel"})
+    ->Args({4096, static_cast<int>(gg::simd::Isa::scalar)})
+    ->Args({4096, static_cast<int>(gg::simd::Isa::sse2)})
+    ->Args({4096, static_cast<int>(gg::simd::Isa::avx2)});
+
+// Offset lines of adjacent segments, as roads tessellation intersects them.
+void BM_lines_intersection(benchmark::State &state) {
+    const auto polyline = gg::corpus::random_polyline(state.range(0), 1);
+    std::vector<gg::v2> points(polyline.begin(), polyline.end());
+    const double width = 2000;
+    for (auto _ : state) {
+        for (size_t i = 2; i < points.size(); ++i) {
+            const gg::v2 p1 = points[i - 2], p2 = points[i - 1], p3 = points[i];
+            const gg::v2 a = p2 - p1, b = p3 - p2;
+            const gg::v2 t1 = gg::normalized(gg::v2(-a.y, a.x)) * width;
+            const gg::v2 t2 = gg::normalized(gg::v2(-b.y, b.x)) * width;
+            gg::v2 d;
+            benchmark::DoNotOptimize(gg::lines_intersection(p1 + t1, p2 + t1, p3 + t2, p2 + t2, d));
+            benchmark::DoNotOptimize(d);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * (points.size() - 2));
+}
+BENCHMARK(BM_lines_intersection)->RangeMultiplier(8)->Range(64, 32768);
+
+// Works in place, so every iteration copies the input first. The second
+// argument is percent of segments parallel to the previous one.
+void BM_eliminate_parallel_segments(benchmark::State &state) {
+    gg::corpus::PolylineParams params;
+    params.straight = state.range(1) / 100.0;
+    const auto polyline = gg::corpus::random_polyline(state.range(0), 1, params);
+    std::vector<gg::p32> points(polyline.size());
+    for (auto _ : state) {
+        std::copy(polyline.begin(), polyline.end(), points.begin());
+        benchmark::DoNotOptimize(gg::utils::eliminate_parallel_segments(
+            points.data(), points.data() + points.size()));
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.size());
+}
+BENCHMARK(BM_eliminate_parallel_segments)
+    ->ArgNames({"points", "straight%"})
+    ->Apply([](benchmark::internal::Benchmark *b) {
+        for (int points = 64; points <= 32768; points *= 8) {
+            b->Args({points, 0});
+            b->Args({points, 50});
+        }
+    });
+} // namespace
+
+BENCHMARK_MAIN();
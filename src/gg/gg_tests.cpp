@@ -57,6 +57,61 @@ TEST(gg_tests, mercator_tests) {
     EXPECT_EQ(gg::mercator::lon_to_xu(+180.0), std::numeric_limits<uint32_t>::max());
 }
 
+TEST(gg_tests, mercator_project_batch) {
+    using gg::simd::Isa;
+
+    // values from mercator_tests plus clamping, poles and a dense sweep.
+    std::vector<double> lats = {-90.0, -85.0, -70.0, -35.0, -15.0, 0.0,
+                                15.0,  35.0,  70.0,  85.0,  90.0};
+    std::vector<double> lons = {-200.0, -180.0, -85.0, -70.0, -35.0, 0.0,
+                                35.0,   70.0,   85.0,  180.0, 200.0};
+    for (int i = 0; i <= 200'001; ++i) {
+        lats.push_back(-90.0 + 180.0 * i / 200'001);
+        lons.push_back(-180.0 + 360.0 * i / 200'001);
+    }
+    const size_t N = lats.size(); // not multiple of any vector width, so tail is covered.
+
+    std::vector<gg::p32> expected(N);
+    for (size_t i = 0; i < N; ++i) {
+        using namespace gg::mercator;
+        expected[i] = gg::p32(gg::lon_to_x(project_lon(clamp_lon_to_valid(lons[i]))),
+                              gg::lat_to_y(project_lat(clamp_lat_to_valid(lats[i]))));
+    }
+
+    std::vector<gg::p32> sse2_result;
+    for (auto kernel : {Isa::scalar, Isa::sse2, Isa::avx2}) {
+        std::vector<gg::p32> result(N);
+        gg::mercator::project_batch(lons.data(), lats.data(), N, result.data(), kernel);
+        for (size_t i = 0; i < N; ++i) {
+            EXPECT_EQ(result[i].x, expected[i].x) << "lon " << lons[i];
+            EXPECT_NEAR(result[i].y, expected[i].y, kernel == Isa::scalar ? 0 : 1)
+                << "lat " << lats[i];
+        }
+        EXPECT_EQ(result[0].y, 0);
+        EXPECT_EQ(result[10].y, gg::U32_MAX);
+
+        // SSE2 and AVX2 use the same sequence of operations.
+        if (kernel == Isa::sse2) {
+            sse2_result = result;
+        } else if (kernel == Isa::avx2 && !sse2_result.empty()) {
+            for (size_t i = 0; i < N; ++i) {
+                ASSERT_EQ(result[i], sse2_result[i]);
+            }
+        }
+    }
+}
+
+TEST(gg_tests, simd_fallback) {
+    using gg::simd::Isa;
+    EXPECT_EQ(gg::simd::usable(Isa::scalar, true), Isa::scalar);
+    // Without the kernel compiled AVX2 is never picked, whatever the CPU.
+    EXPECT_NE(gg::simd::usable(Isa::avx2, false), Isa::avx2);
+    EXPECT_EQ(gg::simd::best(false), gg::simd::usable(Isa::sse2, false));
+    const Isa best = gg::simd::best(true);
+    EXPECT_TRUE(gg::simd::supported(best));
+    EXPECT_EQ(best == Isa::avx2, gg::simd::supported(Isa::avx2));
+}
+
 TEST(gg_tests, eliminate_parallel_segments_test) {
     using vertice_t = std::tuple<double, double>;
     std::vector<vertice_t> test_segments = {{3.7756453790000819, -85.051128779806589}, // 0
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "gg/gg.h"
+#include <random>
+
+// Synthetic inputs for benchmarks of geometry kernels. The same seed gives
+// the same input on every run, so runs before and after a change measure the
+// same work.
+namespace gg::corpus {
+
+struct PolylineParams {
+    double min_segment = 10000; // units.
+    double max_segment = 110000;
+    double max_turn = 10; // degrees between adjacent segments.
+    // Share of segments repeating the previous one exactly, so they are
+    // parallel to it as eliminate_parallel_segments sees them.
+    double straight = 0;
+};
+
+// Random walk of `points` points from origin, turning a little at every
+// point like roads do. Turns back at the edges of the world.
+inline std::vector<p32> random_polyline(size_t points, uint32_t seed,
+                                        const PolylineParams &params = {},
+                                        p32 origin = p32(U32_MAX / 2, U32_MAX / 2)) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<p32> res;
+    res.reserve(points);
+    int64_t x = origin.x, y = origin.y;
+    int64_t dx = 0, dy = 0;
+    double angle = unit(rng) * 2 * M_PI;
+    for (size_t i = 0; i < points; ++i) {
+        res.push_back(p32(static_cast<uint32_t>(x), static_cast<uint32_t>(y)));
+        if (i == 0 || unit(rng) >= params.straight) {
+            angle += deg_to_rad((unit(rng) * 2 - 1) * params.max_turn);
+            const double length =
+                params.min_segment + unit(rng) * (params.max_segment - params.min_segment);
+            dx = std::llround(std::cos(angle) * length);
+            dy = std::llround(std::sin(angle) * length);
+        }
+        if (x + dx < 0 || x + dx > U32_MAX || y + dy < 0 || y + dy > U32_MAX) {
+            angle += M_PI;
+            dx = -dx;
+            dy = -dy;
+        }
+        x += dx;
+        y += dy;
+    }
+    return res;
+}
+
+// `count` polylines of `points` points starting around the middle of the
+// world.
+inline std::vector<std::vector<p32>> random_polylines(size_t count, size_t points, uint32_t seed,
+                                                      const PolylineParams &params = {}) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> origin(U32_MAX / 4, U32_MAX / 4 * 3);
+    std::vector<std::vector<p32>> res;
+    res.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        res.push_back(random_polyline(points, rng(), params, p32(origin(rng), origin(rng))));
+    }
+    return res;
+}
+
+// Closed ring of `points` points (the last one repeats the first) around
+// center. Star shaped, so it is a simple polygon whatever the radii.
+inline std::vector<p32> random_ring(size_t points, uint32_t seed,
+                                    p32 center = p32(U32_MAX / 2, U32_MAX / 2),
+                                    double radius = 1e6) {
+    assert(points >= 4 && "a triangle and the closing point");
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> scale(0.5, 1.0);
+    std::vector<p32> res;
+    res.reserve(points);
+    for (size_t i = 0; i + 1 < points; ++i) {
+        const double angle = 2 * M_PI * i / (points - 1);
+        const double r = radius * scale(rng);
+        res.push_back(p32(static_cast<uint32_t>(center.x + std::cos(angle) * r),
+                          static_cast<uint32_t>(center.y + std::sin(angle) * r)));
+    }
+    res.push_back(res.front());
+    return res;
+}
+
+// n coordinates within the range Mercator projects.
+inline void random_lon_lat(size_t n, uint32_t seed, std::vector<double> &lon,
+                           std::vector<double> &lat) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> lon_dist(-180.0, 180.0);
+    std::uniform_real_distribution<double> lat_dist(-85.0, 85.0);
+    lon.resize(n);
+    lat.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        lon[i] = lon_dist(rng);
+        lat[i] = lat_dist(rng);
+    }
+}
+
+} // namespace gg::corpus
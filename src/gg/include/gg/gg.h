@@ -16,6 +16,8 @@
 
 #include <glm/glm.hpp>
 
+#include "gg/simd.h"
+
 // general geometry
 namespace gg {
 
@@ -83,6 +85,16 @@ struct tile_at_level_t {
     uint32_t level; // 0 .. 15
 };
 
+inline bool operator==(tile_at_level_t lhs, tile_at_level_t rhs) {
+    return lhs.id.id == rhs.id.id && lhs.level == rhs.level;
+}
+inline bool operator!=(tile_at_level_t lhs, tile_at_level_t rhs) { return !(lhs == rhs); }
+
+// Unique among tiles of all levels, for hash maps.
+inline uint64_t tile_key(tile_at_level_t tile) {
+    return static_cast<uint64_t>(tile.level) << 32 | tile.id.id;
+}
+
 tile_id_t tile_id_by_pt(gpt_t pt, uint32_t level);
 gbb_t tile_bb(tile_at_level_t tile);
 
@@ -234,11 +246,25 @@ inline double clamp_lat_to_valid(double lat) {
     return std::clamp(lat, gg::mercator::PROJECTED_LAT_MIN, gg::mercator::PROJECTED_LAT_MAX);
 }
 
+// Best kernel supported by this build and by CPU we are running on.
+simd::Isa best_batch_kernel();
+
+// Projects n (lon, lat) pairs into world units, the same as
+//   p32(lon_to_x(project_lon(clamp_lon_to_valid(lon))),
+//       lat_to_y(project_lat(clamp_lat_to_valid(lat))))
+// but several points at a time. x is bit exact, y computed by SIMD kernels may
+// differ from scalar formula by 1 unit (see mercator_batch_impl.h for bounds).
+// Unsupported kernel falls back to the next best one.
+void project_batch(const double *lon, const double *lat, size_t n, p32 *out);
+void project_batch(const double *lon, const double *lat, size_t n, p32 *out, simd::Isa kernel);
+
 } // namespace mercator
 
 namespace utils {
 std::vector<p32> eliminate_parallel_segments(std::vector<p32> points);
-}
+// In place version, returns new end of the range (like std::remove_if).
+p32 *eliminate_parallel_segments(p32 *first, p32 *last);
+} // namespace utils
 
 inline p32 v22p(v2 v) {
     // tip: round can be appropriate.
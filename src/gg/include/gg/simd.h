@@ -0,0 +1,28 @@
+#pragma once
+
+// Runtime choice of the instruction set batch kernels run with. A kernel
+// family keeps its AVX2 variant in a translation unit of its own compiled with
+// -mavx2 (see gg/mercator_batch_avx2.cpp) and reports whether it was built
+// that way, the CPU check and the fallback order are shared here.
+namespace gg::simd {
+
+// SSE2 is baseline for x86-64, SSE2 kernels are compiled whenever it is set.
+#if defined(__SSE2__) || defined(_M_X64)
+#define GG_SIMD_SSE2 1
+#endif
+
+// From the slowest.
+enum class Isa { scalar, sse2, avx2 };
+
+// Kernels for isa can run: the build targets it and so does the CPU we are
+// running on.
+bool supported(Isa isa);
+
+// isa if it is supported, the next best supported one otherwise.
+// avx2_compiled tells whether the family's AVX2 translation unit has the
+// kernel or only a stub.
+Isa usable(Isa isa, bool avx2_compiled);
+
+Isa best(bool avx2_compiled);
+
+} // namespace gg::simd
@@ -0,0 +1,101 @@
+#include "gg/gg.h"
+#include "mercator_batch.h"
+
+#ifdef GG_SIMD_SSE2
+#include <emmintrin.h>
+#include "mercator_batch_impl.h"
+#endif
+
+// Batch mercator projection. SSE2 kernel lives in this file since SSE2 is
+// baseline for x86-64, AVX2 kernel lives in mercator_batch_avx2.cpp which is
+// the only file compiled with -mavx2. The kernel is picked at runtime.
+namespace gg::mercator {
+
+#ifdef GG_SIMD_SSE2
+namespace detail {
+namespace {
+struct Sse2Ops {
+    using vd = __m128d;
+    static constexpr size_t width = 2;
+
+    static vd set1(double v) { return _mm_set1_pd(v); }
+    static vd load(const double *p) { return _mm_loadu_pd(p); }
+    static vd add(vd a, vd b) { return _mm_add_pd(a, b); }
+    static vd sub(vd a, vd b) { return _mm_sub_pd(a, b); }
+    static vd mul(vd a, vd b) { return _mm_mul_pd(a, b); }
+    static vd div(vd a, vd b) { return _mm_div_pd(a, b); }
+    static vd min(vd a, vd b) { return _mm_min_pd(a, b); }
+    static vd max(vd a, vd b) { return _mm_max_pd(a, b); }
+    static vd cmpgt(vd a, vd b) { return _mm_cmpgt_pd(a, b); }
+    static vd and_(vd mask, vd a) { return _mm_and_pd(mask, a); }
+    static vd blend(vd mask, vd a, vd b) {
+        return _mm_or_pd(_mm_and_pd(mask, a), _mm_andnot_pd(mask, b));
+    }
+
+    static void split_exponent(vd q, vd &m, vd &e) {
+        const __m128i bits = _mm_castpd_si128(q);
+        const __m128i exp32 = _mm_shuffle_epi32(_mm_srli_epi64(bits, 52), _MM_SHUFFLE(3, 1, 2, 0));
+        e = _mm_sub_pd(_mm_cvtepi32_pd(exp32), _mm_set1_pd(1023.0));
+        m = _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi64x(0x000fffffffffffff)),
+                                          _mm_set1_epi64x(0x3ff0000000000000)));
+    }
+
+    // v must be in [0, 2^32), there is no unsigned conversion in SSE2 so values
+    // above 2^31 are shifted down and high bit is restored afterwards.
+    static __m128i to_u32(vd v) {
+        const vd two31 = _mm_set1_pd(2147483648.0);
+        const vd big = _mm_cmpge_pd(v, two31);
+        const __m128i low = _mm_cvttpd_epi32(_mm_sub_pd(v, _mm_and_pd(big, two31)));
+        const __m128i big32 = _mm_shuffle_epi32(_mm_castpd_si128(big), _MM_SHUFFLE(3, 1, 2, 0));
+        return _mm_or_si128(low, _mm_and_si128(big32, _mm_set1_epi32(0x80000000)));
+    }
+
+    static void store_units(vd x, vd y, uint32_t *out_xy) {
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out_xy),
+                         _mm_unpacklo_epi32(to_u32(x), to_u32(y)));
+    }
+};
+} // namespace
+
+void project_batch_sse2(const BatchParams &params, const double *lon, const double *lat, size_t n,
+                        uint32_t *out_xy) {
+    project_batch_impl<Sse2Ops>(params, lon, lat, n, out_xy);
+}
+} // namespace detail
+#endif // GG_SIMD_SSE2
+
+simd::Isa best_batch_kernel() { return simd::best(detail::avx2_compiled()); }
+
+void project_batch(const double *lon, const double *lat, size_t n, p32 *out, simd::Isa kernel) {
+    static_assert(sizeof(p32) == sizeof(uint32_t) * 2);
+    const detail::BatchParams params{PROJECTED_LON_MIN, PROJECTED_LON_MAX, PROJECTED_LAT_MIN,
+                                     PROJECTED_LAT_MAX, U32_MAX / 360.0};
+    auto *out_xy = reinterpret_cast<uint32_t *>(out);
+
+    switch (simd::usable(kernel, detail::avx2_compiled())) {
+#ifdef GG_SIMD_SSE2
+    case simd::Isa::avx2:
+        detail::project_batch_avx2(params, lon, lat, n, out_xy);
+        return;
+    case simd::Isa::sse2:
+        detail::project_batch_sse2(params, lon, lat, n, out_xy);
+        return;
+#else
+    case simd::Isa::avx2:
+    case simd::Isa::sse2:
+#endif
+    case simd::Isa::scalar:
+        for (size_t i = 0; i < n; ++i) {
+            out[i] = p32(lon_to_x(project_lon(clamp_lon_to_valid(lon[i]))),
+                         lat_to_y(project_lat(clamp_lat_to_valid(lat[i]))));
+        }
+        return;
+    }
+}
+
+void project_batch(const double *lon, const double *lat, size_t n, p32 *out) {
+    static const simd::Isa best = best_batch_kernel();
+    project_batch(lon, lat, n, out, best);
+}
+
+} // namespace gg::mercator
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Private interface between mercator::project_batch and its SIMD kernels.
+// Kernels are compiled in separate translation units with their own
+// instruction set flags, so this header must not pull in any inline code
+// which could be shared with the rest of the program (see mercator_batch.cpp).
+namespace gg::mercator::detail {
+
+struct BatchParams {
+    double lon_min, lon_max;
+    double lat_min, lat_max;
+    double units_per_degree; // U32_MAX / 360.0
+};
+
+// out_xy receives n pairs of (x, y) units.
+void project_batch_sse2(const BatchParams &params, const double *lon, const double *lat, size_t n,
+                        uint32_t *out_xy);
+void project_batch_avx2(const BatchParams &params, const double *lon, const double *lat, size_t n,
+                        uint32_t *out_xy);
+
+bool avx2_compiled();
+
+} // namespace gg::mercator::detail
@@ -0,0 +1,78 @@
+// This file is compiled with -mavx2 (see CMakeLists.txt). Do not include
+// anything with inline functions here (gg.h, <algorithm>, etc.): linker may
+// pick AVX2 version of such function for the whole program.
+#include "mercator_batch.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+#include "mercator_batch_impl.h"
+
+namespace gg::mercator::detail {
+namespace {
+struct Avx2Ops {
+    using vd = __m256d;
+    static constexpr size_t width = 4;
+
+    static vd set1(double v) { return _mm256_set1_pd(v); }
+    static vd load(const double *p) { return _mm256_loadu_pd(p); }
+    static vd add(vd a, vd b) { return _mm256_add_pd(a, b); }
+    static vd sub(vd a, vd b) { return _mm256_sub_pd(a, b); }
+    static vd mul(vd a, vd b) { return _mm256_mul_pd(a, b); }
+    static vd div(vd a, vd b) { return _mm256_div_pd(a, b); }
+    static vd min(vd a, vd b) { return _mm256_min_pd(a, b); }
+    static vd max(vd a, vd b) { return _mm256_max_pd(a, b); }
+    static vd cmpgt(vd a, vd b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+    static vd and_(vd mask, vd a) { return _mm256_and_pd(mask, a); }
+    static vd blend(vd mask, vd a, vd b) { return _mm256_blendv_pd(b, a, mask); }
+
+    // low 32 bits of each 64 bit lane.
+    static __m128i pack_lo32(__m256i v) {
+        return _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0)));
+    }
+
+    static void split_exponent(vd q, vd &m, vd &e) {
+        const __m256i bits = _mm256_castpd_si256(q);
+        const __m128i exp32 = pack_lo32(_mm256_srli_epi64(bits, 52));
+        e = _mm256_sub_pd(_mm256_cvtepi32_pd(exp32), _mm256_set1_pd(1023.0));
+        m = _mm256_castsi256_pd(
+            _mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi64x(0x000fffffffffffff)),
+                            _mm256_set1_epi64x(0x3ff0000000000000)));
+    }
+
+    // v must be in [0, 2^32), see Sse2Ops::to_u32.
+    static __m128i to_u32(vd v) {
+        const vd two31 = _mm256_set1_pd(2147483648.0);
+        const vd big = _mm256_cmp_pd(v, two31, _CMP_GE_OQ);
+        const __m128i low = _mm256_cvttpd_epi32(_mm256_sub_pd(v, _mm256_and_pd(big, two31)));
+        const __m128i big32 = pack_lo32(_mm256_castpd_si256(big));
+        return _mm_or_si128(low, _mm_and_si128(big32, _mm_set1_epi32(0x80000000)));
+    }
+
+    static void store_units(vd x, vd y, uint32_t *out_xy) {
+        const __m128i xi = to_u32(x), yi = to_u32(y);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out_xy), _mm_unpacklo_epi32(xi, yi));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out_xy + 4), _mm_unpackhi_epi32(xi, yi));
+    }
+};
+} // namespace
+
+void project_batch_avx2(const BatchParams &params, const double *lon, const double *lat, size_t n,
+                        uint32_t *out_xy) {
+    project_batch_impl<Avx2Ops>(params, lon, lat, n, out_xy);
+}
+
+bool avx2_compiled() { return true; }
+} // namespace gg::mercator::detail
+
+#else
+
+namespace gg::mercator::detail {
+// Never called, project_batch checks avx2_compiled() first.
+void project_batch_avx2(const BatchParams &, const double *, const double *, size_t, uint32_t *) {}
+
+bool avx2_compiled() { return false; }
+} // namespace gg::mercator::detail
+
+#endif // __AVX2__
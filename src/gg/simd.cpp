@@ -0,0 +1,37 @@
+#include "gg/simd.h"
+
+namespace gg::simd {
+
+bool supported(Isa isa) {
+    switch (isa) {
+    case Isa::scalar:
+        return true;
+    case Isa::sse2:
+#ifdef GG_SIMD_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case Isa::avx2:
+#if defined(GG_SIMD_SSE2) && defined(__GNUC__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false; // todo: use __cpuid on MSVC.
+#endif
+    }
+    return false;
+}
+
+Isa usable(Isa isa, bool avx2_compiled) {
+    if (isa == Isa::avx2 && !(avx2_compiled && supported(Isa::avx2))) {
+        isa = Isa::sse2;
+    }
+    if (isa == Isa::sse2 && !supported(Isa::sse2)) {
+        isa = Isa::scalar;
+    }
+    return isa;
+}
+
+Isa best(bool avx2_compiled) { return usable(Isa::avx2, avx2_compiled); }
+
+} // namespace gg::simd
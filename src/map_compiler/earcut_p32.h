@@ -0,0 +1,15 @@
+#pragma once
+
+#include <common/global.h>
+#include <mapbox/earcut.hpp>
+
+// Lets mapbox::earcut read p32 rings directly, without copying them into
+// arrays of coordinates.
+namespace mapbox::util {
+template <> struct nth<0, gg::p32> {
+    inline static double get(const gg::p32 &p) { return p.x; }
+};
+template <> struct nth<1, gg::p32> {
+    inline static double get(const gg::p32 &p) { return p.y; }
+};
+} // namespace mapbox::util
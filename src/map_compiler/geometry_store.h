@@ -0,0 +1,92 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+
+namespace map_compiler {
+
+// Flat storage of polygons: all points of all rings live in one contiguous
+// buffer, rings are described by offsets into points buffer and shapes by
+// offsets into rings. This way we have three allocations no matter how many
+// shapes we store and geometry can be written to disk as is.
+//
+//   points:        [ r0 r0 r0 r0 | r1 r1 r1 r1 r1 | r2 r2 r2 r2 ]
+//   ring_offsets:  [ 0, 4, 9, 13 ]
+//   shape_offsets: [ 0, 2, 3 ]      // shape 0 has rings 0,1; shape 1 has ring 2.
+class GeometryStore {
+  public:
+    size_t shapes_count() const { return m_shape_offsets.size() - 1; }
+    size_t rings_count() const { return m_ring_offsets.size() - 1; }
+    size_t points_count() const { return m_points.size(); }
+
+    span<const p32> points() const { return m_points; }
+
+    span<const p32> ring(size_t ring_idx) const {
+        assert(ring_idx < rings_count());
+        return span<const p32>(m_points.data() + m_ring_offsets[ring_idx],
+                               m_ring_offsets[ring_idx + 1] - m_ring_offsets[ring_idx]);
+    }
+    // Index of the first point of ring in points().
+    size_t ring_offset(size_t ring_idx) const { return m_ring_offsets[ring_idx]; }
+
+    // Returns [first, last) range of ring indices which belong to shape.
+    std::pair<size_t, size_t> shape_rings(size_t shape_idx) const {
+        assert(shape_idx < shapes_count());
+        return {m_shape_offsets[shape_idx], m_shape_offsets[shape_idx + 1]};
+    }
+    // All points of all rings of a shape.
+    span<const p32> shape_points(size_t shape_idx) const {
+        auto [first, last] = shape_rings(shape_idx);
+        return span<const p32>(m_points.data() + m_ring_offsets[first],
+                               m_ring_offsets[last] - m_ring_offsets[first]);
+    }
+
+    // Building. Points added after last finish_ring() form an open ring which
+    // can be edited in place before it is finished or discarded.
+    void reserve(size_t points, size_t rings, size_t shapes) {
+        m_points.reserve(points);
+        m_ring_offsets.reserve(rings + 1);
+        m_shape_offsets.reserve(shapes + 1);
+    }
+    void add_point(p32 p) { m_points.push_back(p); }
+    span<p32> open_ring() {
+        return span<p32>(m_points.data() + m_ring_offsets.back(),
+                         m_points.size() - m_ring_offsets.back());
+    }
+    void resize_open_ring(size_t n) { m_points.resize(m_ring_offsets.back() + n); }
+    void discard_ring() { resize_open_ring(0); }
+    void finish_ring() { m_ring_offsets.push_back(m_points.size()); }
+    void add_ring(span<const p32> ring) {
+        m_points.insert(m_points.end(), ring.begin(), ring.end());
+        finish_ring();
+    }
+    // Closes shape made of rings finished since previous shape.
+    void finish_shape() { m_shape_offsets.push_back(rings_count()); }
+    // Removes all shapes, keeps allocated memory for reuse.
+    void clear() {
+        m_points.clear();
+        m_ring_offsets.assign(1, 0);
+        m_shape_offsets.assign(1, 0);
+    }
+
+    // Appends all shapes of other store after shapes of this one.
+    void append(const GeometryStore &other) {
+        assert(m_points.size() == m_ring_offsets.back()); // no open ring.
+        const uint64_t points_base = m_points.size();
+        const uint64_t rings_base = rings_count();
+        m_points.insert(m_points.end(), other.m_points.begin(), other.m_points.end());
+        for (size_t i = 1; i < other.m_ring_offsets.size(); ++i) {
+            m_ring_offsets.push_back(points_base + other.m_ring_offsets[i]);
+        }
+        for (size_t i = 1; i < other.m_shape_offsets.size(); ++i) {
+            m_shape_offsets.push_back(rings_base + other.m_shape_offsets[i]);
+        }
+    }
+
+  private:
+    vector<p32> m_points;
+    vector<uint64_t> m_ring_offsets = {0};
+    vector<uint64_t> m_shape_offsets = {0};
+};
+
+} // namespace map_compiler
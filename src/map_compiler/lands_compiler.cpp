@@ -0,0 +1,177 @@
+#include <atomic>
+#include <common/log.h>
+#include <common/parallel.h>
+#include <numeric>
+
+#include <render_units/roads_shader_aa/make_geometry.h>
+
+#include "earcut_p32.h"
+#include "lands_compiler.h"
+
+namespace map_compiler {
+
+namespace {
+// Calls f for each piece of ring outline which does not run along the tile
+// boundary. Unclipped rings are passed as is.
+template <class F>
+void for_each_outline(span<const p32> ring, const std::optional<ClipBox> &tile_box,
+                      vector<p32> &scratch, F &&f) {
+    const size_t segments = ring.size() - 1;
+    const auto is_cut = [&](size_t s) {
+        return tile_box && is_boundary_segment(ring[s], ring[s + 1], *tile_box);
+    };
+    size_t start = 0;
+    while (start < segments && !is_cut(start)) {
+        ++start;
+    }
+    if (start == segments) {
+        f(ring);
+        return;
+    }
+    // start right after a cut so that pieces never wrap around.
+    scratch.clear();
+    for (size_t k = 1; k <= segments; ++k) {
+        const size_t s = (start + k) % segments;
+        if (is_cut(s)) {
+            if (scratch.size() > 2) {
+                f(span<const p32>(scratch));
+            }
+            scratch.clear();
+            continue;
+        }
+        if (scratch.empty()) {
+            scratch.push_back(ring[s]);
+        }
+        scratch.push_back(ring[s + 1]);
+    }
+    if (scratch.size() > 2) {
+        f(span<const p32>(scratch));
+    }
+}
+
+// Triangulates every polygon (outer ring and its holes) on its own. Polygons
+// are handed out to workers biggest first, so the largest ones (Eurasia,
+// Antarctica) start right away instead of ending up as the tail of the
+// critical path. Indices of each polygon are kept separately and then written
+// at offsets given by prefix sum of their sizes, so the result is exactly what
+// serial triangulation produces.
+vector<uint32_t> triangulate_polygons(const GeometryStore &shapes, size_t workers) {
+    const size_t shapes_count = shapes.shapes_count();
+    vector<uint32_t> order(shapes_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return shapes.shape_points(a).size() > shapes.shape_points(b).size();
+    });
+
+    vector<vector<uint32_t>> shape_indices(shapes_count);
+    std::atomic<size_t> next{0};
+    workers = std::clamp<size_t>(workers, 1, std::max<size_t>(shapes_count, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        vector<span<const p32>> earcut_polygon;
+        for (size_t i = next++; i < shapes_count; i = next++) {
+            const uint32_t shape_idx = order[i];
+            auto [first_ring, last_ring] = shapes.shape_rings(shape_idx);
+            // mapbox::earcut expects polygon defined as a list of rings: main
+            // polygon and holes, it reads p32 directly (see earcut_p32.h).
+            // Resulting indices go through all rings in order, same as points
+            // of the shape in the store.
+            earcut_polygon.clear();
+            for (size_t r = first_ring; r != last_ring; ++r) {
+                earcut_polygon.push_back(shapes.ring(r));
+            }
+            if (!earcut_polygon.empty()) {
+                shape_indices[shape_idx] = mapbox::earcut(earcut_polygon);
+            }
+        }
+    });
+
+    vector<size_t> offsets(shapes_count + 1, 0);
+    for (size_t s = 0; s < shapes_count; ++s) {
+        offsets[s + 1] = offsets[s] + shape_indices[s].size();
+    }
+    vector<uint32_t> indices(offsets.back());
+    next = 0;
+    parallel::run_workers(workers, [&](size_t) {
+        for (size_t s = next++; s < shapes_count; s = next++) {
+            const uint32_t base = shapes.ring_offset(shapes.shape_rings(s).first);
+            std::transform(shape_indices[s].begin(), shape_indices[s].end(),
+                           indices.begin() + offsets[s], [&](uint32_t idx) { return idx + base; });
+        }
+    });
+    return indices;
+}
+} // namespace
+
+LandsMesh compile_lands(const GeometryStore &shapes, DebugCtx &dctx,
+                        std::optional<ClipBox> tile_box, size_t workers) {
+    LandsMesh mesh;
+    auto &vertices = mesh.vertices;
+    auto &indices = mesh.indices;
+    auto &aa_vertices = mesh.aa_vertices;
+    auto &aa_indices = mesh.aa_indices;
+
+    // Polygons are triangulated in place so vertices are just points of the store.
+    vertices.assign(shapes.points().begin(), shapes.points().end());
+    const auto earcut_start_time = std::chrono::steady_clock::now();
+    indices = triangulate_polygons(shapes, workers);
+    const auto earcut_time = std::chrono::steady_clock::now() - earcut_start_time;
+
+    // Outline pieces are independent polylines, they are collected first and
+    // extruded in one parallel batch. Pieces of clipped rings live in scratch
+    // buffer, so all of them are copied.
+    const auto aa_start_time = std::chrono::steady_clock::now();
+    vector<p32> outline, outline_points;
+    vector<size_t> outline_offsets = {0};
+    outline_points.reserve(shapes.points_count());
+    for (size_t ring_idx = 0; ring_idx < shapes.rings_count(); ++ring_idx) {
+        for_each_outline(shapes.ring(ring_idx), tile_box, outline, [&](span<const p32> polyline) {
+            outline_points.insert(outline_points.end(), polyline.begin(), polyline.end());
+            outline_offsets.push_back(outline_points.size());
+        });
+    }
+    vector<span<const p32>> outlines;
+    outlines.reserve(outline_offsets.size() - 1);
+    for (size_t i = 0; i + 1 < outline_offsets.size(); ++i) {
+        outlines.emplace_back(outline_points.data() + outline_offsets[i],
+                              outline_offsets[i + 1] - outline_offsets[i]);
+    }
+    const vector<double> widths(outlines.size(), 1.0);
+    roads_shader_aa::make_geometry_batch(outlines, widths, aa_vertices, aa_indices, workers);
+    const auto aa_time = std::chrono::steady_clock::now() - aa_start_time;
+
+    for (size_t shape_idx = 0; shape_idx < shapes.shapes_count(); ++shape_idx) {
+        auto [first_ring, last_ring] = shapes.shape_rings(shape_idx);
+        int parn_n = 0;
+        for (size_t ring_idx = first_ring; ring_idx != last_ring; ++ring_idx) {
+            auto part = shapes.ring(ring_idx);
+            assert(part.front() == part.back());
+            const size_t M = shapes.ring_offset(ring_idx);
+
+            { // debug
+                auto pen = dctx.make_pen();
+                auto it = std::begin(part);
+                pen.move_to(*it++);
+                int k = 0;
+                for (; it != std::end(part); ++it) {
+                    vector<Color> colors({colors::red, colors::green, colors::blue});
+                    auto c = colors[parn_n % colors.size()];
+                    c.r *= k / (double)M;
+                    c.g *= k / (double)M;
+                    c.b *= k / (double)M;
+                    pen.line_to(*it, c);
+                    k++;
+                }
+            }
+            parn_n++;
+        } // parts
+    }     // shapes
+
+    log_debug("Lands Triangulation time: {}ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(earcut_time).count());
+    log_debug("Lands AA time: {}ms",
+              std::chrono::duration_cast<std::chrono::milliseconds>(aa_time).count());
+
+    return mesh;
+}
+
+} // namespace map_compiler
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <common/default_init_allocator.h>
+#include <common/global.h>
+#include <common/parallel.h>
+#include <render_lib/debug_ctx.h>
+#include <render_units/roads_shader_aa/types.h>
+
+#include "map_compiler_lib.h"
+#include "tile_clipper.h"
+
+namespace map_compiler {
+
+// GPU ready geometry for lands: filled triangles and AA outline.
+// Indices are relative to the beginning of corresponding vertices array.
+// AA vertices are in full precision, they are packed when written to a tile
+// pack or before upload, see roads_shader_aa::pack_aa_mesh. AA buffers are
+// sized before extrusion fills them, so they are not zero-filled.
+struct LandsMesh {
+    vector<p32> vertices;
+    vector<uint32_t> indices;
+    uninit_vector<roads_shader_aa::AAVertex> aa_vertices;
+    uninit_vector<uint32_t> aa_indices;
+};
+
+// Triangulates lands polygons (shapes with outer ring first, then holes) and
+// extrudes AA outline of each ring on `workers` threads, result does not
+// depend on number of workers. For shapes clipped to a tile `tile_box` is the
+// box they were clipped to, edges running along it are cuts rather than
+// coastline and get no outline.
+LandsMesh compile_lands(const GeometryStore &shapes, DebugCtx &dctx,
+                        std::optional<ClipBox> tile_box = std::nullopt,
+                        size_t workers = parallel::default_concurrency());
+
+} // namespace map_compiler
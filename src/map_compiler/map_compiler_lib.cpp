@@ -1,95 +1,161 @@
+#include <atomic>
 #include <common/global.h>
 #include <common/log.h>
+#include <common/parallel.h>
 #include <cstdlib>
 #include <filesystem>
 #include <fmt/format.h>
 #include <fmt/ranges.h>
 #include <list>
+#include <map>
+#include <mutex>
 #include <shapefil.h> // shapelib
 
 #include "map_compiler_lib.h"
+#include "polygons.h"
+#include "shp_reader.h"
 
 namespace fs = std::filesystem;
 namespace map_compiler {
 
-// https://www.esri.com/content/dam/esrisites/sitecore-archive/Files/Pdfs/library/whitepapers/pdfs/shapefile.pdf
-shapes_t load_shapes(const fs::path &shape_file_path) {
-    if (!fs::exists(shape_file_path)) {
-        throw std::runtime_error(fmt::format("Path {} does not exist", shape_file_path));
-    }
+namespace {
+using shp_handle_t = std::unique_ptr<SHPInfo, decltype(&SHPClose)>;
 
+shp_handle_t open_shp(const fs::path &shape_file_path) {
     // Note, on MSVC fs::path::string_type is wstring
-    SHPHandle lands_shp = SHPOpen(shape_file_path.string().c_str(), "rb");
-    if (!lands_shp) {
+    shp_handle_t shp(SHPOpen(shape_file_path.string().c_str(), "rb"), &SHPClose);
+    if (!shp) {
         throw std::runtime_error(
             fmt::format("failed opening lands dbf. error: {}({})", strerror(errno), errno));
     }
+    return shp;
+}
+
+// Post-processes ring projected into store.open_ring(): drops redundant
+// points and finishes the ring, or discards it if nothing is left.
+void finish_projected_ring(GeometryStore &store, size_t shape_i, size_t part_i) {
+    auto part_points = store.open_ring();
+    p32 *part_end = gg::utils::eliminate_parallel_segments(
+        part_points.data(), part_points.data() + part_points.size());
+    store.resize_open_ring(part_end - part_points.data());
+    part_points = store.open_ring();
+    if (part_points.size() < 3) {
+        log_warn("discarding part {} of shape {}: less than 3 points", part_i, shape_i);
+        store.discard_ring();
+    } else {
+        if (part_points.front() != part_points.back()) {
+            log_debug("{} != {}", part_points.front(), part_points.back());
+            assert(part_points.front() == part_points.back());
+        }
+        store.finish_ring();
+    }
+}
 
-    double adfMinBound[4], adfMaxBound[4];
-    int nShapeType, nEntities;
+// Decodes entity with shapelib as a shape appended to the store. Used for
+// record types ShpReader does not handle.
+void read_shape(SHPHandle shp, int i, GeometryStore &store) {
+    std::unique_ptr<SHPObject, decltype(&SHPDestroyObject)> shape(SHPReadObject(shp, i),
+                                                                  &SHPDestroyObject);
 
-    SHPGetInfo(lands_shp, &nEntities, &nShapeType, adfMinBound, adfMaxBound);
-    if (nShapeType != SHPT_POLYGON) {
-        throw std::runtime_error(
-            fmt::format("Unexpected type of shape: {}", SHPTypeName(nShapeType)));
+    if (!shape) {
+        throw std::runtime_error(fmt::format("failed reading shape object {}", i));
     }
 
-    shapes_t shapes;
-    for (int i = 0; i < nEntities; i++) {
-        std::unique_ptr<SHPObject, decltype(&SHPDestroyObject)> shape(SHPReadObject(lands_shp, i),
-                                                                      &SHPDestroyObject);
+    store.reserve(store.points_count() + shape->nVertices, store.rings_count() + shape->nParts,
+                  store.shapes_count() + 1);
+    for (auto part_i = 0; part_i < shape->nParts; ++part_i) {
+        assert(shape->panPartType[part_i] == SHPP_RING);
+
+        const size_t part_start_offset = shape->panPartStart[part_i];
+        const size_t part_end_offset =
+            part_i == shape->nParts - 1 ? shape->nVertices : shape->panPartStart[part_i + 1];
+
+        const size_t part_size = part_end_offset - part_start_offset;
+        store.resize_open_ring(part_size);
+        gg::mercator::project_batch(shape->padfX + part_start_offset,
+                                    shape->padfY + part_start_offset, part_size,
+                                    store.open_ring().data());
+        finish_projected_ring(store, i, part_i);
+    }
+    store.finish_shape();
+}
+} // namespace
 
-        if (!shape) {
-            throw std::runtime_error(fmt::format("failed reading shape object {}", i));
-        }
+// https://www.esri.com/content/dam/esrisites/sitecore-archive/Files/Pdfs/library/whitepapers/pdfs/shapefile.pdf
+GeometryStore load_shapes(const fs::path &shape_file_path, size_t workers) {
+    if (!fs::exists(shape_file_path)) {
+        throw std::runtime_error(fmt::format("Path {} does not exist", shape_file_path));
+    }
 
-        shape_parts_t shape_parts;
-        for (auto part_i = 0; part_i < shape->nParts; ++part_i) {
-            assert(shape->panPartType[part_i] == SHPP_RING);
-
-            const size_t part_start_offset = shape->panPartStart[part_i];
-            const size_t part_end_offset =
-                part_i == shape->nParts - 1 ? shape->nVertices : shape->panPartStart[part_i + 1];
-
-            assert(shape->padfX[part_start_offset] == shape->padfX[part_end_offset - 1]);
-
-            part_points_t part_points;
-            // todo:  detect orientation of RING.
-            for (size_t vi = part_start_offset; vi != part_end_offset; ++vi) {
-                auto x = shape->padfX[vi];
-                auto y = shape->padfY[vi];
-                x = gg::mercator::project_lon(gg::mercator::clamp_lon_to_valid(x));
-                y = gg::mercator::project_lat(gg::mercator::clamp_lat_to_valid(y));
-                gg::gpt_units_t ux = gg::lon_to_x(x);
-                gg::gpt_units_t uy = gg::lat_to_y(y);
-                part_points.emplace_back(ux, uy);
-            }
-            part_points = gg::utils::eliminate_parallel_segments(std::move(part_points));
-            if (part_points.size() < 3) {
-                log_warn("discarding part {} of shape {}: less than 3 points", i, part_i);
-            } else {
-                if (part_points.front() != part_points.back()) {
-                    log_debug("{} != {}", part_points.front(), part_points.back());
-                    assert(part_points.front() == part_points.back());
+    auto shp_reader = ShpReader::open(shape_file_path);
+    const int shape_type = shp_reader->shape_type();
+    if (shape_type != SHPT_POLYGON && shape_type != SHPT_POLYGONZ &&
+        shape_type != SHPT_POLYGONM) {
+        throw std::runtime_error(
+            fmt::format("Unexpected type of shape: {}", SHPTypeName(shape_type)));
+    }
+    const int nEntities = shp_reader->records_count();
+
+    // Entities are handed out one by one since their sizes differ by orders of
+    // magnitude. They are appended to shapes in order, so result does not
+    // depend on number of workers or on scheduling: an entity finished before
+    // all previous ones waits in pending, the rest go straight to shapes.
+    GeometryStore shapes;
+    const auto [points_bound, rings_bound] = shp_reader->polygons_size();
+    shapes.reserve(points_bound, rings_bound, rings_bound);
+    std::mutex shapes_mutex;
+    int next_append = 0;
+    std::map<int, GeometryStore> pending;
+    std::atomic<int> next_entity{0};
+    std::atomic<int> fallback_entities{0};
+    workers = std::clamp<size_t>(workers, 1, std::max(nEntities, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        ShpReader::Scratch scratch;
+        // SHPHandle owns file position and read buffers so each worker needs
+        // its own one. Opened only if file has records ShpReader can't decode.
+        shp_handle_t shp(nullptr, &SHPClose);
+        GeometryStore entity, grouped; // reused between entities.
+        for (int i = next_entity++; i < nEntities; i = next_entity++) {
+            entity.clear();
+            if (!shp_reader->read_polygon(i, entity, scratch, finish_projected_ring)) {
+                if (!shp) {
+                    shp = open_shp(shape_file_path);
                 }
-                shape_parts.emplace_back(std::move(part_points));
+                read_shape(shp.get(), i, entity);
+                ++fallback_entities;
+            }
+            // One entity may hold several polygons, each one becomes a shape.
+            grouped.clear();
+            group_polygons(entity, grouped);
+
+            auto lock = std::unique_lock(shapes_mutex);
+            if (i != next_append) {
+                pending.emplace(i, std::move(grouped));
+                grouped = GeometryStore{};
+                continue;
+            }
+            shapes.append(grouped);
+            ++next_append;
+            for (auto it = pending.begin(); it != pending.end() && it->first == next_append;
+                 it = pending.erase(it)) {
+                shapes.append(it->second);
+                ++next_append;
             }
         }
-
-        shapes.emplace_back(std::move(shape_parts));
+    });
+    assert(pending.empty());
+    if (fallback_entities > 0) {
+        log_debug("{} of {} entities decoded by shapelib", fallback_entities.load(), nEntities);
     }
 
-    log_debug("Loaded {} shapes:", shapes.size());
-    int shape_n = 0;
-    for (auto &shape : shapes) {
-        size_t part_size = 0;
-        for (auto &part : shape) {
-            part_size += part.size();
-        }
-        log_debug("  {}: {} parts ({} points) ", shape_n++, shape.size(), part_size);
+    log_debug("Loaded {} shapes:", shapes.shapes_count());
+    for (size_t shape_n = 0; shape_n < shapes.shapes_count(); ++shape_n) {
+        auto [first_ring, last_ring] = shapes.shape_rings(shape_n);
+        log_debug("  {}: {} parts ({} points) ", shape_n, last_ring - first_ring,
+                  shapes.shape_points(shape_n).size());
     }
 
-    return std::move(shapes);
+    return shapes;
 }
 
 } // namespace map_compiler
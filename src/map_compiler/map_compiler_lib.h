@@ -1,15 +1,19 @@
 #include <common/global.h>
+#include <common/parallel.h>
 #include <tuple>
 #include <vector>
 
+#include "geometry_store.h"
+
 #pragma once
 namespace map_compiler {
 
-// see shpdump.c
-using part_points_t = std::vector<gg::p32>;
-using shape_parts_t = std::vector<part_points_t>;
-using shapes_t = std::vector<shape_parts_t>;
-
-shapes_t load_shapes(const fs::path &shape_file_path);
+// Loads polygons from shape file and projects them into world coordinates.
+// Every shape of the result is one polygon: its outer ring comes first,
+// followed by its holes (see group_polygons).
+// Entities are decoded by `workers` threads, result is the same for any number
+// of workers.
+GeometryStore load_shapes(const fs::path &shape_file_path,
+                          size_t workers = parallel::default_concurrency());
 
 } // namespace map_compiler
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include "common/log.h"
+#include "lands_compiler.h"
+#include "map_compiler_lib.h"
+#include "polygons.h"
+#include "simplify.h"
+#include "tile_clipper.h"
+#include "tile_pack.h"
+#include <fmt/ranges.h>
+#include <render_units/roads_shader_aa/packed_vertex.h>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <random>
+#include <shapefil.h>
+
+TEST(map_compiler_tests, geometry_store) {
+    map_compiler::GeometryStore a;
+    a.add_ring(vector<p32>{p32(0, 0), p32(1, 0), p32(0, 1), p32(0, 0)});
+    a.add_point(p32(5, 5));
+    a.add_point(p32(6, 6));
+    ASSERT_EQ(a.open_ring().size(), 2);
+    a.discard_ring();
+    a.finish_shape();
+
+    map_compiler::GeometryStore b;
+    b.add_ring(vector<p32>{p32(2, 2), p32(3, 2), p32(2, 3), p32(2, 2)});
+    b.add_point(p32(7, 7));
+    b.add_point(p32(8, 7));
+    b.add_point(p32(7, 8));
+    b.add_point(p32(9, 9));
+    b.add_point(p32(7, 7));
+    b.open_ring()[3] = p32(7, 7);
+    b.resize_open_ring(4);
+    b.finish_ring();
+    b.finish_shape();
+
+    a.append(b);
+    ASSERT_EQ(a.shapes_count(), 2);
+    ASSERT_EQ(a.rings_count(), 3);
+    ASSERT_EQ(a.points_count(), 12);
+    EXPECT_EQ(a.shape_rings(0), std::make_pair(size_t(0), size_t(1)));
+    EXPECT_EQ(a.shape_rings(1), std::make_pair(size_t(1), size_t(3)));
+    EXPECT_EQ(a.ring_offset(2), 8);
+    EXPECT_EQ(a.ring(2).size(), 4);
+    EXPECT_EQ(a.ring(2)[3], p32(7, 7));
+    EXPECT_EQ(a.shape_points(1).size(), 8);
+    EXPECT_EQ(a.shape_points(1)[0], p32(2, 2));
+
+    b.clear();
+    EXPECT_EQ(b.shapes_count(), 0);
+    EXPECT_EQ(b.rings_count(), 0);
+    EXPECT_EQ(b.points_count(), 0);
+    b.add_ring(a.ring(0));
+    b.finish_shape();
+    EXPECT_EQ(b.shape_points(0).size(), a.ring(0).size());
+}
+
+TEST(map_compiler_tests, tile_pack_roundtrip) {
+    using namespace map_compiler::tile_pack;
+
+    PackTile tile;
+    tile.tile = gg::tile_at_level_t{gg::tile_id_t{uint16_t(3), uint16_t(5)}, 4};
+    tile.mesh.vertices = {p32(1, 2), p32(3, 4), p32(5, 6)};
+    tile.mesh.indices = {0, 1, 2};
+    tile.mesh.aa_vertices.assign(2, roads_shader_aa::AAVertex{p32(0, 0), 0, 0, {0, 0}});
+    tile.mesh.aa_vertices[1].coords = p32(7, 8);
+    tile.mesh.aa_vertices[1].is_outer = 1;
+    tile.mesh.aa_indices = {1, 0, 1};
+
+    auto path = fs::temp_directory_path() / "map_compiler_tests.pack";
+    write_tile_pack(path, {tile, PackTile{gg::root_tile(), {}}});
+
+    auto pack = TilePack::open(path);
+    ASSERT_EQ(pack->tiles().size(), 2);
+    EXPECT_EQ(pack->size_bytes() % PAGE_SIZE, sizeof(TileEntry) * 2);
+    EXPECT_EQ(pack->find(gg::tile_at_level_t{gg::tile_id_t{uint16_t(3), uint16_t(4)}, 4}),
+              nullptr);
+
+    auto *entry = pack->find(tile.tile);
+    ASSERT_NE(entry, nullptr);
+    for (auto &s : entry->sections) {
+        EXPECT_EQ(s.offset % PAGE_SIZE, 0);
+    }
+    auto vertices = pack->vertices(*entry);
+    ASSERT_EQ(vertices.size(), 3);
+    EXPECT_EQ(vertices[2], p32(5, 6));
+    ASSERT_EQ(pack->indices(*entry).size(), 3);
+    EXPECT_EQ(pack->indices(*entry)[2], 2);
+    ASSERT_EQ(pack->aa_vertices(*entry).size(), 2);
+    auto aa_vertex = pack->aa_vertices(*entry)[1];
+    EXPECT_EQ(roads_shader_aa::unpack_coords(aa_vertex, entry->aa_box), p32(7, 8));
+    EXPECT_EQ(aa_vertex.style, roads_shader_aa::PackedAAVertex::OUTER_BIT);
+    EXPECT_EQ(pack->aa_indices(*entry).size(), 3);
+
+    auto *root = pack->find(gg::root_tile());
+    ASSERT_NE(root, nullptr);
+    EXPECT_TRUE(pack->vertices(*root).empty());
+
+    fs::remove(path);
+}
+
+TEST(map_compiler_tests, tile_pack_rejects_garbage) {
+    auto path = fs::temp_directory_path() / "map_compiler_tests_garbage.pack";
+    {
+        std::ofstream os(path, std::ios::binary);
+        os << "definitely not a tile pack, but long enough to contain a header";
+    }
+    EXPECT_THROW(map_compiler::tile_pack::TilePack::open(path), std::runtime_error);
+    fs::remove(path);
+}
+
+namespace {
+// Writes `shapes_count` polygons, each one having its own number of rings.
+fs::path make_test_shapefile(std::string name, int shapes_count, int shape_type = SHPT_POLYGON) {
+    auto path = fs::temp_directory_path() / name;
+    SHPHandle shp = SHPCreate(path.string().c_str(), shape_type);
+    for (int i = 0; i < shapes_count; ++i) {
+        vector<double> xs, ys;
+        vector<int> part_starts;
+        for (int r = 0; r < i % 4 + 1; ++r) {
+            part_starts.push_back(xs.size());
+            const double x = -170.0 + i * 3.0, y = -70.0 + r * 10.0 + i * 0.5;
+            for (auto [dx, dy] : {std::pair{0.0, 0.0}, {0.0, 1.0}, {1.0, 1.5}, {2.0, 1.0},
+                                  {2.0, 0.0}, {0.0, 0.0}}) {
+                xs.push_back(x + dx);
+                ys.push_back(y + dy);
+            }
+        }
+        SHPObject *obj = SHPCreateObject(shape_type, -1, part_starts.size(), part_starts.data(),
+                                         nullptr, xs.size(), xs.data(), ys.data(), nullptr,
+                                         nullptr);
+        SHPWriteObject(shp, -1, obj);
+        SHPDestroyObject(obj);
+    }
+    SHPClose(shp);
+    path.replace_extension(".shp");
+    return path;
+}
+} // namespace
+
+TEST(map_compiler_tests, parallel_load_shapes_matches_serial) {
+    auto path = make_test_shapefile("map_compiler_tests_shapes", 37);
+
+    auto serial = map_compiler::load_shapes(path, 1);
+    // all rings are clockwise, so every one of them is a polygon of its own.
+    ASSERT_EQ(serial.shapes_count(), 9 * 10 + 1);
+    EXPECT_EQ(serial.rings_count(), 9 * 10 + 1);
+    EXPECT_EQ(serial.shape_rings(11), std::make_pair(size_t(11), size_t(12)));
+    for (size_t workers : {2, 3, 8, 64}) {
+        auto parallel = map_compiler::load_shapes(path, workers);
+        ASSERT_EQ(parallel.shapes_count(), serial.shapes_count());
+        ASSERT_EQ(parallel.rings_count(), serial.rings_count());
+        for (size_t i = 0; i < serial.shapes_count(); ++i) {
+            EXPECT_EQ(parallel.shape_rings(i), serial.shape_rings(i));
+        }
+        ASSERT_EQ(parallel.points_count(), serial.points_count());
+        for (size_t i = 0; i < serial.points_count(); ++i) {
+            EXPECT_EQ(parallel.points()[i], serial.points()[i]) << "point " << i;
+        }
+    }
+
+    for (auto ext : {".shp", ".shx"}) {
+        fs::remove(fs::path(path).replace_extension(ext));
+    }
+}
+
+// PolygonZ records are not handled by ShpReader and go through shapelib, both
+// paths must produce the same geometry.
+TEST(map_compiler_tests, shp_reader_matches_shapelib) {
+    auto path = make_test_shapefile("map_compiler_tests_polygons", 11);
+    auto path_z = make_test_shapefile("map_compiler_tests_polygons_z", 11, SHPT_POLYGONZ);
+
+    auto streamed = map_compiler::load_shapes(path, 2);
+    auto fallback = map_compiler::load_shapes(path_z, 2);
+    ASSERT_EQ(streamed.shapes_count(), 26);
+    ASSERT_EQ(streamed.rings_count(), fallback.rings_count());
+    for (size_t i = 0; i < streamed.shapes_count(); ++i) {
+        EXPECT_EQ(streamed.shape_rings(i), fallback.shape_rings(i));
+    }
+    ASSERT_EQ(streamed.points_count(), fallback.points_count());
+    for (size_t i = 0; i < streamed.points_count(); ++i) {
+        EXPECT_EQ(streamed.points()[i], fallback.points()[i]) << "point " << i;
+    }
+
+    for (auto p : {path, path_z}) {
+        for (auto ext : {".shp", ".shx"}) {
+            fs::remove(p.replace_extension(ext));
+        }
+    }
+}
+
+namespace {
+double ring_area(span<const p32> ring) {
+    double area2 = 0;
+    for (size_t i = 0; i + 1 < ring.size(); ++i) {
+        area2 += double(ring[i].x) * double(ring[i + 1].y) -
+                 double(ring[i + 1].x) * double(ring[i].y);
+    }
+    return std::abs(area2) / 2;
+}
+} // namespace
+
+TEST(map_compiler_tests, clip_ring) {
+    const map_compiler::ClipBox box{100, 100, 200, 200};
+    vector<p32> out;
+
+    // fully outside and fully inside.
+    vector<p32> outside{p32(0, 0), p32(50, 0), p32(50, 50), p32(0, 0)};
+    EXPECT_EQ(map_compiler::clip_ring(outside, box, out), 0);
+    vector<p32> inside{p32(120, 120), p32(150, 120), p32(150, 150), p32(120, 120)};
+    EXPECT_EQ(map_compiler::clip_ring(inside, box, out), 4);
+    EXPECT_EQ(out, inside);
+
+    // square overlapping the corner of the box.
+    out.clear();
+    vector<p32> corner{p32(150, 150), p32(250, 150), p32(250, 250), p32(150, 250), p32(150, 150)};
+    ASSERT_EQ(map_compiler::clip_ring(corner, box, out), 5);
+    EXPECT_EQ(out.front(), out.back());
+    EXPECT_EQ(ring_area(out), 50.0 * 50.0);
+    size_t cuts = 0;
+    for (size_t i = 0; i + 1 < out.size(); ++i) {
+        cuts += map_compiler::is_boundary_segment(out[i], out[i + 1], box);
+    }
+    EXPECT_EQ(cuts, 2);
+
+    // box inside of the ring becomes the box itself.
+    out.clear();
+    vector<p32> big{p32(0, 0), p32(300, 0), p32(300, 300), p32(0, 300), p32(0, 0)};
+    ASSERT_EQ(map_compiler::clip_ring(big, box, out), 5);
+    EXPECT_EQ(ring_area(out), 100.0 * 100.0);
+}
+
+// Tiles of a level cover the world without overlaps, so pieces of a shape
+// must add up to the area of the shape at every level.
+TEST(map_compiler_tests, slice_to_tiles_preserves_area) {
+    const uint32_t W = 1u << 31; // level 0 tile size.
+    map_compiler::GeometryStore shapes;
+    // concave "C" shape crossing level 0 tiles in the middle of the world.
+    shapes.add_ring(vector<p32>{p32(W - 1000, W - 1000), p32(W + 1000, W - 1000),
+                                p32(W + 1000, W - 600), p32(W - 600, W - 600),
+                                p32(W - 600, W + 600), p32(W + 1000, W + 600),
+                                p32(W + 1000, W + 1000), p32(W - 1000, W + 1000),
+                                p32(W - 1000, W - 1000)});
+    shapes.finish_shape();
+    shapes.add_ring(vector<p32>{p32(10, 10), p32(20, 10), p32(10, 20), p32(10, 10)});
+    shapes.finish_shape();
+    const double total = ring_area(shapes.ring(0)) + ring_area(shapes.ring(1));
+
+    const uint32_t levels[] = {0, 3, 15};
+    auto tiles = map_compiler::slice_to_tiles(shapes, levels);
+    for (uint32_t level : levels) {
+        double area = 0;
+        size_t tiles_count = 0;
+        for (auto &t : tiles) {
+            if (t.tile.level != level) {
+                continue;
+            }
+            ++tiles_count;
+            auto box = map_compiler::tile_clip_box(t.tile);
+            for (size_t r = 0; r < t.shapes.rings_count(); ++r) {
+                for (auto p : t.shapes.ring(r)) {
+                    ASSERT_GE(p.x, box.min_x);
+                    ASSERT_LE(p.x, box.max_x);
+                    ASSERT_GE(p.y, box.min_y);
+                    ASSERT_LE(p.y, box.max_y);
+                }
+                area += ring_area(t.shapes.ring(r));
+            }
+        }
+        EXPECT_EQ(area, total) << "level " << level;
+        EXPECT_EQ(tiles_count, level == 0 ? 4 : 5) << "level " << level;
+    }
+    // sorted by level, then by id.
+    for (size_t i = 1; i < tiles.size(); ++i) {
+        EXPECT_LT(std::make_pair(tiles[i - 1].tile.level, tiles[i - 1].tile.id.id),
+                  std::make_pair(tiles[i].tile.level, tiles[i].tile.id.id));
+    }
+}
+
+namespace {
+// Axis aligned square, clockwise as outer rings of shapefiles or
+// counter-clockwise as their holes.
+vector<p32> square(uint32_t x, uint32_t y, uint32_t size, bool clockwise) {
+    vector<p32> ring{p32(x, y), p32(x + size, y), p32(x + size, y + size), p32(x, y + size),
+                     p32(x, y)};
+    if (clockwise) {
+        std::reverse(ring.begin(), ring.end());
+    }
+    return ring;
+}
+
+double triangles_area(const map_compiler::LandsMesh &mesh) {
+    double area = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        const vector<p32> triangle{mesh.vertices[mesh.indices[i]],
+                                   mesh.vertices[mesh.indices[i + 1]],
+                                   mesh.vertices[mesh.indices[i + 2]],
+                                   mesh.vertices[mesh.indices[i]]};
+        area += std::abs(map_compiler::ring_signed_area2(triangle)) / 2;
+    }
+    return area;
+}
+} // namespace
+
+TEST(map_compiler_tests, polygon_holes) {
+    EXPECT_LT(map_compiler::ring_signed_area2(square(0, 0, 10, true)), 0);
+    EXPECT_EQ(map_compiler::ring_signed_area2(square(0, 0, gg::U32_MAX, false)),
+              2.0 * double(gg::U32_MAX) * double(gg::U32_MAX));
+
+    // One entity with two islands, each with a lake, and a lake outside of
+    // both of them. Rings are mixed up on purpose.
+    const uint32_t W = 1u << 31;
+    map_compiler::GeometryStore entity;
+    entity.add_ring(square(W + 200, W + 200, 100, true));
+    entity.add_ring(square(W - 10, W - 10, 20, false));
+    entity.add_ring(square(W + 500, W + 500, 10, false));
+    entity.add_ring(square(W - 50, W - 50, 100, true));
+    entity.add_ring(square(W + 250, W + 220, 20, false));
+    entity.finish_shape();
+
+    auto polygons = map_compiler::group_polygons(entity);
+    ASSERT_EQ(polygons.shapes_count(), 2);
+    ASSERT_EQ(polygons.rings_count(), 4);
+    EXPECT_EQ(polygons.shape_rings(0), std::make_pair(size_t(0), size_t(2)));
+    EXPECT_EQ(polygons.ring(0)[0], entity.ring(0)[0]);
+    EXPECT_EQ(polygons.ring(1)[0], entity.ring(4)[0]);
+    EXPECT_EQ(polygons.ring(2)[0], entity.ring(3)[0]);
+    EXPECT_EQ(polygons.ring(3)[0], entity.ring(1)[0]);
+
+    const double land = 2 * (100.0 * 100.0 - 20.0 * 20.0);
+    DebugCtx dctx;
+    EXPECT_EQ(triangles_area(map_compiler::compile_lands(polygons, dctx, std::nullopt, 2)), land);
+
+    // tile corner is in the middle of the lake of the second island, each
+    // piece of it gets a piece of the lake.
+    for (uint32_t level : {0u, 15u}) {
+        const uint32_t levels[] = {level};
+        double area = 0;
+        for (auto &t : map_compiler::slice_to_tiles(polygons, levels)) {
+            for (size_t s = 0; s < t.shapes.shapes_count(); ++s) {
+                EXPECT_EQ(t.shapes.shape_rings(s).second - t.shapes.shape_rings(s).first, 2);
+            }
+            area += triangles_area(map_compiler::compile_lands(
+                t.shapes, dctx, map_compiler::tile_clip_box(t.tile), 1));
+        }
+        EXPECT_EQ(area, land) << "level " << level;
+    }
+}
+
+// Holes cut by a tile seam keep an edge along the seam, right on the cut edge
+// of the outer ring. Triangulation of both sides must cover exactly the land.
+TEST(map_compiler_tests, hole_crossing_tile_seam) {
+    const uint32_t W = 1u << 31, Y = 1u << 20;
+    map_compiler::GeometryStore island;
+    island.add_ring(square(W - 1000, Y, 2000, true));
+    island.add_ring(square(W - 300, Y + 200, 600, false));
+    // diamond off the seam, so it is cut in the middle of its edges.
+    const uint32_t cx = W + 50, cy = Y + 1400, r = 200;
+    island.add_ring(vector<p32>{p32(cx, cy - r), p32(cx + r, cy), p32(cx, cy + r), p32(cx - r, cy),
+                                p32(cx, cy - r)});
+    island.finish_shape();
+
+    const double left = 1000.0 * 2000 - 300.0 * 600 - 150.0 * 150;
+    const double right = 1000.0 * 2000 - 300.0 * 600 - (2.0 * r * r - 150.0 * 150);
+    DebugCtx dctx;
+    for (uint32_t level : {0u, 15u}) {
+        const uint32_t levels[] = {level};
+        const auto tiles = map_compiler::slice_to_tiles(island, levels);
+        ASSERT_EQ(tiles.size(), 2) << "level " << level;
+        for (auto &t : tiles) {
+            ASSERT_EQ(t.shapes.shapes_count(), 1);
+            EXPECT_EQ(t.shapes.rings_count(), 3);
+            const auto box = map_compiler::tile_clip_box(t.tile);
+            const auto mesh = map_compiler::compile_lands(t.shapes, dctx, box, 1);
+            for (auto p : mesh.vertices) {
+                ASSERT_TRUE(p.x >= box.min_x && p.x <= box.max_x);
+                ASSERT_TRUE(p.y >= box.min_y && p.y <= box.max_y);
+            }
+            EXPECT_EQ(triangles_area(mesh), box.max_x <= W ? left : right) << "level " << level;
+        }
+    }
+}
+
+namespace {
+// Jagged ring around center, radius goes between r_min and r_max.
+vector<p32> noisy_ring(std::mt19937 &rng, double cx, double cy, double r_min, double r_max,
+                       int points) {
+    std::uniform_real_distribution<double> radius(r_min, r_max);
+    vector<p32> ring;
+    for (int i = 0; i < points; ++i) {
+        const double a = 2 * M_PI * i / points, r = radius(rng);
+        ring.emplace_back(uint32_t(cx + r * std::cos(a)), uint32_t(cy + r * std::sin(a)));
+    }
+    ring.push_back(ring.front());
+    return ring;
+}
+
+bool crosses(p32 a, p32 b, p32 c, p32 d) {
+    const auto orient = [](p32 p, p32 q, p32 r) {
+        const double v = (double(q.x) - p.x) * (double(r.y) - p.y) -
+                         (double(q.y) - p.y) * (double(r.x) - p.x);
+        return (v > 0) - (v < 0);
+    };
+    return orient(a, b, c) * orient(a, b, d) < 0 && orient(c, d, a) * orient(c, d, b) < 0;
+}
+} // namespace
+
+TEST(map_compiler_tests, simplify_keeps_rings_valid) {
+    std::mt19937 rng(42);
+    map_compiler::GeometryStore shapes;
+    for (int i = 0; i < 8; ++i) {
+        const double cx = 1e6 + i * 1e6;
+        // outer ring and a hole getting very close to it.
+        shapes.add_ring(noisy_ring(rng, cx, 1e6, 3e5, 4.5e5, 500));
+        shapes.add_ring(noisy_ring(rng, cx, 1e6, 1.5e5, 2.99e5, 300));
+        shapes.finish_shape();
+    }
+    {
+        // Land with a round bay and an island in it. Plain Douglas–Peucker
+        // replaces the bay shore with two chords, one of them cuts the island.
+        const auto pt = [](double x, double y) { return p32(1e7 + x * 114, 1e7 + y * 114); };
+        vector<p32> land = {pt(-2000, -2000), pt(2000, -2000), pt(2000, 0), pt(1000, 0)};
+        for (int deg = 10; deg < 180; deg += 10) {
+            land.push_back(pt(std::round(1000 * std::cos(deg * M_PI / 180)),
+                              std::round(-1000 * std::sin(deg * M_PI / 180))));
+        }
+        for (auto p : {pt(-1000, 0), pt(-2000, 0), pt(-2000, -2000)}) {
+            land.push_back(p);
+        }
+        shapes.add_ring(land);
+        shapes.add_ring(vector<p32>{pt(100, -600), pt(600, -600), pt(600, 600), pt(100, 600),
+                                    pt(100, -600)});
+        shapes.finish_shape();
+    }
+
+    const double tolerance = 4e4;
+    auto simplified = map_compiler::simplify_shapes(shapes, tolerance, 3);
+    ASSERT_EQ(simplified.shapes_count(), shapes.shapes_count());
+    EXPECT_LT(simplified.points_count(), shapes.points_count() / 2);
+    for (size_t s = 0; s < simplified.shapes_count(); ++s) {
+        auto [first_ring, last_ring] = simplified.shape_rings(s);
+        ASSERT_EQ(last_ring - first_ring, 2);
+        vector<std::pair<p32, p32>> segments;
+        for (size_t r = first_ring; r != last_ring; ++r) {
+            auto ring = simplified.ring(r);
+            ASSERT_EQ(ring.front(), ring.back());
+            for (size_t i = 0; i + 1 < ring.size(); ++i) {
+                segments.emplace_back(ring[i], ring[i + 1]);
+            }
+        }
+        for (size_t i = 0; i < segments.size(); ++i) {
+            for (size_t j = i + 1; j < segments.size(); ++j) {
+                ASSERT_FALSE(crosses(segments[i].first, segments[i].second, segments[j].first,
+                                     segments[j].second))
+                    << "shape " << s << " segments " << i << ", " << j;
+            }
+        }
+    }
+    // same result for any number of workers.
+    auto serial = map_compiler::simplify_shapes(shapes, tolerance, 1);
+    ASSERT_EQ(serial.points_count(), simplified.points_count());
+    EXPECT_TRUE(std::equal(serial.points().begin(), serial.points().end(),
+                           simplified.points().begin()));
+}
+
+TEST(map_compiler_tests, parallel_triangulation_matches_serial) {
+    std::mt19937 rng(7);
+    map_compiler::GeometryStore shapes;
+    for (int i = 0; i < 40; ++i) {
+        // sizes differ a lot so that big-first order differs from ring order.
+        shapes.add_ring(noisy_ring(rng, 1e6 + i * 1e6, 1e6, 3e5, 4.5e5, 10 + (i * 37) % 400));
+        shapes.finish_shape();
+    }
+
+    DebugCtx dctx;
+    auto serial = map_compiler::compile_lands(shapes, dctx, std::nullopt, 1);
+    EXPECT_FALSE(serial.indices.empty());
+    for (size_t workers : {2, 5, 16}) {
+        auto parallel = map_compiler::compile_lands(shapes, dctx, std::nullopt, workers);
+        EXPECT_EQ(parallel.indices, serial.indices) << workers << " workers";
+        EXPECT_EQ(parallel.vertices, serial.vertices) << workers << " workers";
+        EXPECT_EQ(parallel.aa_indices, serial.aa_indices) << workers << " workers";
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
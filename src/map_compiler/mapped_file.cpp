@@ -0,0 +1,72 @@
+#include "mapped_file.h"
+
+#include <common/log.h>
+#include <cstring>
+#include <fstream>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace map_compiler {
+
+MappedFile MappedFile::open(const fs::path &path) {
+    MappedFile file;
+
+#ifdef __linux__
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(
+            fmt::format("failed opening {}: {}({})", path, strerror(errno), errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        throw std::runtime_error(fmt::format("failed stat for {}", path));
+    }
+    if (st.st_size > 0) {
+        void *addr = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error(
+                fmt::format("failed mapping {}: {}({})", path, strerror(errno), errno));
+        }
+        file.m_data = static_cast<uint8_t *>(addr);
+        file.m_size = st.st_size;
+    }
+    ::close(fd); // mapping keeps its own reference to the file.
+#else
+    // todo: use MapViewOfFile on windows.
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        throw std::runtime_error(fmt::format("failed opening {}", path));
+    }
+    file.m_size = fs::file_size(path);
+    file.m_data = new uint8_t[file.m_size];
+    is.read(reinterpret_cast<char *>(file.m_data), file.m_size);
+#endif
+
+    return file;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+    std::swap(m_data, other.m_data);
+    std::swap(m_size, other.m_size);
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    if (!m_data) {
+        return;
+    }
+#ifdef __linux__
+    munmap(m_data, m_size);
+#else
+    delete[] m_data;
+#endif
+}
+
+} // namespace map_compiler
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+
+namespace map_compiler {
+
+// Whole file mapped into memory. Mapping is private (copy-on-write): pages can
+// be modified in memory but changes never reach the file.
+class MappedFile {
+  public:
+    // Throws std::runtime_error if file cannot be opened or mapped.
+    static MappedFile open(const fs::path &path);
+
+    MappedFile() = default;
+    MappedFile(MappedFile &&other) noexcept { *this = std::move(other); }
+    MappedFile &operator=(MappedFile &&other) noexcept;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    ~MappedFile();
+
+    uint8_t *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+  private:
+    uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace map_compiler
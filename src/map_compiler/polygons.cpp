@@ -0,0 +1,122 @@
+#include "polygons.h"
+
+#include <common/log.h>
+
+namespace map_compiler {
+
+namespace {
+#ifdef __SIZEOF_INT128__
+using area_acc_t = __int128;
+#else
+using area_acc_t = long double; // todo: exact accumulator for MSVC.
+#endif
+
+struct RingInfo {
+    size_t ring_idx;
+    double area; // absolute, doubled
+    uint32_t min_x, min_y, max_x, max_y;
+};
+
+RingInfo ring_info(const GeometryStore &shapes, size_t ring_idx, double area2) {
+    auto ring = shapes.ring(ring_idx);
+    RingInfo info{ring_idx, std::abs(area2), gg::U32_MAX, gg::U32_MAX, 0, 0};
+    for (auto &p : ring) {
+        info.min_x = std::min(info.min_x, p.x);
+        info.min_y = std::min(info.min_y, p.y);
+        info.max_x = std::max(info.max_x, p.x);
+        info.max_y = std::max(info.max_y, p.y);
+    }
+    return info;
+}
+
+bool bbox_contains(const RingInfo &outer, const RingInfo &inner) {
+    return outer.min_x <= inner.min_x && inner.max_x <= outer.max_x &&
+           outer.min_y <= inner.min_y && inner.max_y <= outer.max_y;
+}
+} // namespace
+
+double ring_signed_area2(span<const p32> ring) {
+    if (ring.size() < 3) {
+        return 0;
+    }
+    // relative to the first point, products need up to 65 bits so they are
+    // taken in the 128 bit accumulator.
+    const int64_t x0 = ring[0].x, y0 = ring[0].y;
+    area_acc_t acc = 0;
+    for (size_t i = 1; i + 1 < ring.size(); ++i) {
+        const int64_t ax = ring[i].x - x0, ay = ring[i].y - y0;
+        const int64_t bx = ring[i + 1].x - x0, by = ring[i + 1].y - y0;
+        acc += area_acc_t(ax) * by - area_acc_t(ay) * bx;
+    }
+    return static_cast<double>(acc);
+}
+
+bool point_in_ring(p32 p, span<const p32> ring) {
+    bool inside = false;
+    const double px = p.x, py = p.y;
+    for (size_t i = 0; i + 1 < ring.size(); ++i) {
+        const double ax = ring[i].x, ay = ring[i].y;
+        const double bx = ring[i + 1].x, by = ring[i + 1].y;
+        if ((ay > py) != (by > py)) {
+            const double x = ax + (py - ay) * (bx - ax) / (by - ay);
+            if (px < x) {
+                inside = !inside;
+            }
+        }
+    }
+    return inside;
+}
+
+GeometryStore group_polygons(const GeometryStore &shapes) {
+    GeometryStore res;
+    res.reserve(shapes.points_count(), shapes.rings_count(), shapes.rings_count());
+    group_polygons(shapes, res);
+    return res;
+}
+
+void group_polygons(const GeometryStore &shapes, GeometryStore &res) {
+    vector<RingInfo> outers, holes;
+    vector<vector<size_t>> outer_holes;
+    for (size_t shape_idx = 0; shape_idx < shapes.shapes_count(); ++shape_idx) {
+        auto [first_ring, last_ring] = shapes.shape_rings(shape_idx);
+        outers.clear();
+        holes.clear();
+        for (size_t r = first_ring; r != last_ring; ++r) {
+            const double area2 = ring_signed_area2(shapes.ring(r));
+            (area2 < 0 ? outers : holes).push_back(ring_info(shapes, r, area2));
+        }
+        if (outers.empty()) {
+            std::swap(outers, holes);
+        }
+
+        outer_holes.assign(outers.size(), {});
+        for (auto &hole : holes) {
+            // some vertex of the hole is strictly inside of its outer ring,
+            // first one is good enough for valid data.
+            const p32 probe = shapes.ring(hole.ring_idx)[0];
+            size_t best = outers.size();
+            for (size_t o = 0; o < outers.size(); ++o) {
+                if (bbox_contains(outers[o], hole) &&
+                    (best == outers.size() || outers[o].area < outers[best].area) &&
+                    point_in_ring(probe, shapes.ring(outers[o].ring_idx))) {
+                    best = o;
+                }
+            }
+            if (best == outers.size()) {
+                log_warn("dropping ring {}: hole outside of any outer ring", hole.ring_idx);
+                continue;
+            }
+            outer_holes[best].push_back(hole.ring_idx);
+        }
+
+        for (size_t o = 0; o < outers.size(); ++o) {
+            res.add_ring(shapes.ring(outers[o].ring_idx));
+            for (auto hole_idx : outer_holes[o]) {
+                res.add_ring(shapes.ring(hole_idx));
+            }
+            res.finish_shape();
+        }
+    }
+}
+
+} // namespace map_compiler
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <common/global.h>
+
+#include "geometry_store.h"
+
+namespace map_compiler {
+
+// Twice the signed area of closed ring, positive for counter-clockwise rings
+// (y axis goes north). Accumulated exactly in integers and converted to
+// double at the end, so the sign is reliable even for slivers.
+double ring_signed_area2(span<const p32> ring);
+
+// Even-odd test, points on the boundary may go either way.
+bool point_in_ring(p32 p, span<const p32> ring);
+
+// Splits every shape of the store into polygons: outer ring followed by its
+// holes. Shapefiles store outer rings clockwise and holes counter-clockwise;
+// each hole goes to the smallest outer ring containing it. If a shape has no
+// clockwise rings at all its rings are all taken as outer ones, holes without
+// outer ring are dropped.
+GeometryStore group_polygons(const GeometryStore &shapes);
+// Same, polygons are appended to out.
+void group_polygons(const GeometryStore &shapes, GeometryStore &out);
+
+} // namespace map_compiler
@@ -0,0 +1,135 @@
+#include "shp_reader.h"
+
+#include <common/log.h>
+#include <cstring>
+#include <gg/gg.h>
+#include <shapefil.h> // shapelib, for SHPT_* constants only.
+
+namespace map_compiler {
+
+namespace {
+constexpr size_t FILE_HEADER_SIZE = 100;
+constexpr size_t RECORD_HEADER_SIZE = 8;
+constexpr int32_t FILE_CODE = 9994;
+
+// Headers mix byte orders: file code, file and record lengths are big endian,
+// everything else is little endian. Data in the mapped file has no alignment
+// guarantees so values are assembled byte by byte, compilers turn this into a
+// single (possibly byte swapped) load.
+uint32_t read_be32(const uint8_t *p) {
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | uint32_t(p[3]);
+}
+uint32_t read_le32(const uint8_t *p) {
+    return uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | uint32_t(p[0]);
+}
+double read_le_double(const uint8_t *p) {
+    const uint64_t bits = uint64_t(read_le32(p + 4)) << 32 | read_le32(p);
+    double v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+} // namespace
+
+std::unique_ptr<ShpReader> ShpReader::open(const fs::path &path) {
+    std::unique_ptr<ShpReader> reader(new ShpReader());
+    reader->m_file = MappedFile::open(path);
+    reader->m_path = path;
+    const uint8_t *data = reader->m_file.data();
+    const size_t size = reader->m_file.size();
+
+    if (size < FILE_HEADER_SIZE || int32_t(read_be32(data)) != FILE_CODE) {
+        throw std::runtime_error(fmt::format("{} is not a shape file", path));
+    }
+    // file length is in 16 bit words.
+    const size_t file_length = std::min<size_t>(size, size_t(read_be32(data + 24)) * 2);
+    reader->m_shape_type = read_le32(data + 32);
+
+    for (size_t pos = FILE_HEADER_SIZE; pos + RECORD_HEADER_SIZE <= file_length;) {
+        const size_t content_length = size_t(read_be32(data + pos + 4)) * 2;
+        pos += RECORD_HEADER_SIZE;
+        if (pos + content_length > file_length) {
+            throw std::runtime_error(fmt::format("shape file {} is truncated: record {}", path,
+                                                 reader->m_records.size()));
+        }
+        reader->m_records.emplace_back(pos, content_length);
+        pos += content_length;
+    }
+
+    return reader;
+}
+
+std::pair<size_t, size_t> ShpReader::polygons_size() const {
+    size_t points = 0, parts = 0;
+    for (size_t record = 0; record < m_records.size(); ++record) {
+        if (auto poly = polygon(record)) {
+            points += poly->num_points;
+            parts += poly->num_parts;
+        }
+    }
+    return {points, parts};
+}
+
+std::optional<ShpReader::Polygon> ShpReader::polygon(size_t record) const {
+    auto [offset, length] = m_records.at(record);
+    const uint8_t *content = m_file.data() + offset;
+
+    const auto malformed = [&](const char *what) {
+        return std::runtime_error(
+            fmt::format("malformed record {} in shape file {}: {}", record, m_path, what));
+    };
+
+    if (length < 4) {
+        throw malformed("record is too short");
+    }
+    const int type = read_le32(content);
+    if (type == SHPT_NULL) {
+        return Polygon{nullptr, nullptr, 0, 0};
+    }
+    if (type != SHPT_POLYGON) {
+        return std::nullopt;
+    }
+
+    // type, bounding box, num parts, num points, parts, points.
+    constexpr size_t PARTS_OFFSET = 4 + 4 * 8 + 4 + 4;
+    if (length < PARTS_OFFSET) {
+        throw malformed("record is too short");
+    }
+    Polygon poly;
+    poly.num_parts = read_le32(content + 36);
+    poly.num_points = read_le32(content + 40);
+    poly.parts = content + PARTS_OFFSET;
+    poly.points = poly.parts + size_t(poly.num_parts) * 4;
+    if (PARTS_OFFSET + size_t(poly.num_parts) * 4 + size_t(poly.num_points) * 16 > length) {
+        throw malformed("parts or points run past the end of record");
+    }
+    return poly;
+}
+
+std::pair<uint32_t, uint32_t> ShpReader::part_range(const Polygon &polygon, size_t record,
+                                                    uint32_t part) const {
+    const uint32_t first = read_le32(polygon.parts + part * 4);
+    const uint32_t last =
+        part + 1 == polygon.num_parts ? polygon.num_points : read_le32(polygon.parts + part * 4 + 4);
+    if (first > last || last > polygon.num_points) {
+        throw std::runtime_error(fmt::format("malformed record {} in shape file {}: bad part {}",
+                                             record, m_path, part));
+    }
+    return {first, last};
+}
+
+void ShpReader::project_points(const Polygon &polygon, uint32_t first, uint32_t last, p32 *out,
+                               Scratch &scratch) {
+    const size_t n = last - first;
+    if (scratch.lon.size() < n) {
+        scratch.lon.resize(n);
+        scratch.lat.resize(n);
+    }
+    const uint8_t *src = polygon.points + size_t(first) * 16;
+    for (size_t i = 0; i < n; ++i, src += 16) {
+        scratch.lon[i] = read_le_double(src);
+        scratch.lat[i] = read_le_double(src + 8);
+    }
+    gg::mercator::project_batch(scratch.lon.data(), scratch.lat.data(), n, out);
+}
+
+} // namespace map_compiler
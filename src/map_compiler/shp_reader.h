@@ -0,0 +1,100 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+
+#include "geometry_store.h"
+#include "mapped_file.h"
+
+namespace map_compiler {
+
+// Reader of .shp files which works directly on the file mapped into memory.
+// Unlike SHPReadObject() it does not allocate anything per record: polygon
+// coordinates are projected straight from the mapped file into the caller's
+// buffer. Only plain polygon records are decoded, for everything else (Z/M
+// polygons, multipatches) read_polygon() returns false and caller is expected
+// to fall back to shapelib.
+//
+// Record offsets are collected on open() by walking record headers, after that
+// records can be read in any order and from any number of threads.
+//
+// https://www.esri.com/content/dam/esrisites/sitecore-archive/Files/Pdfs/library/whitepapers/pdfs/shapefile.pdf
+class ShpReader {
+  public:
+    // Per thread buffers for deinterleaving coordinates, grown on demand and
+    // reused between records.
+    struct Scratch {
+        vector<double> lon;
+        vector<double> lat;
+    };
+
+    // Throws std::runtime_error if file cannot be mapped or is malformed.
+    static std::unique_ptr<ShpReader> open(const fs::path &path);
+
+    ShpReader(const ShpReader &) = delete;
+    ShpReader &operator=(const ShpReader &) = delete;
+
+    // Shape type from the file header, one of SHPT_* values.
+    int shape_type() const { return m_shape_type; }
+    size_t records_count() const { return m_records.size(); }
+
+    // Points and parts of all records read_polygon() decodes, an upper bound of
+    // what it appends since rings only lose points on finishing. Throws like
+    // read_polygon() on malformed records.
+    std::pair<size_t, size_t> polygons_size() const;
+
+    // Appends record as a shape to the store. Each ring is projected into
+    // store.open_ring() and passed to finish_ring(store, record, part) which
+    // must finish or discard it. Returns false, leaving the store untouched,
+    // if record type is not supported. Throws std::runtime_error if record is
+    // malformed.
+    template <class FinishRing>
+    bool read_polygon(size_t record, GeometryStore &store, Scratch &scratch,
+                      FinishRing &&finish_ring) const;
+
+  private:
+    struct Polygon {
+        const uint8_t *parts;  // int32 [num_parts]
+        const uint8_t *points; // {double x, double y} [num_points]
+        uint32_t num_parts;
+        uint32_t num_points;
+    };
+
+    ShpReader() = default;
+
+    // nullopt if record is not a polygon.
+    std::optional<Polygon> polygon(size_t record) const;
+    // [first, last) range of points of polygon part, validated.
+    std::pair<uint32_t, uint32_t> part_range(const Polygon &polygon, size_t record,
+                                             uint32_t part) const;
+    static void project_points(const Polygon &polygon, uint32_t first, uint32_t last, p32 *out,
+                               Scratch &scratch);
+
+    MappedFile m_file;
+    fs::path m_path;
+    int m_shape_type = 0;
+    // Offsets of record contents (past record header) and their lengths in bytes.
+    vector<std::pair<uint64_t, uint32_t>> m_records;
+};
+
+template <class FinishRing>
+bool ShpReader::read_polygon(size_t record, GeometryStore &store, Scratch &scratch,
+                             FinishRing &&finish_ring) const {
+    auto poly = polygon(record);
+    if (!poly) {
+        return false;
+    }
+
+    store.reserve(store.points_count() + poly->num_points, store.rings_count() + poly->num_parts,
+                  store.shapes_count() + 1);
+    for (uint32_t part = 0; part < poly->num_parts; ++part) {
+        auto [first, last] = part_range(*poly, record, part);
+        store.resize_open_ring(last - first);
+        project_points(*poly, first, last, store.open_ring().data(), scratch);
+        finish_ring(store, record, part);
+    }
+    store.finish_shape();
+    return true;
+}
+
+} // namespace map_compiler
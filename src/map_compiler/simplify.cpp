@@ -0,0 +1,276 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <common/log.h>
+
+namespace map_compiler {
+
+namespace {
+double distance_to_segment(p32 p, p32 a, p32 b) {
+    const double dx = double(b.x) - a.x, dy = double(b.y) - a.y;
+    const double px = double(p.x) - a.x, py = double(p.y) - a.y;
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0 ? (px * dx + py * dy) / len2 : 0.0;
+    t = std::clamp(t, 0.0, 1.0);
+    return std::hypot(px - t * dx, py - t * dy);
+}
+
+// Index of the point in (first, last) farthest from segment [first, last].
+size_t farthest_point(span<const p32> ring, size_t first, size_t last, double &distance) {
+    size_t res = first;
+    distance = -1;
+    for (size_t i = first + 1; i < last; ++i) {
+        const double d = distance_to_segment(ring[i], ring[first], ring[last]);
+        if (d > distance) {
+            distance = d;
+            res = i;
+        }
+    }
+    return res;
+}
+
+void douglas_peucker(span<const p32> ring, double tolerance, vector<uint8_t> &keep) {
+    keep.assign(ring.size(), 0);
+    keep.front() = keep.back() = 1;
+    // ring is closed so the first split goes through the point farthest from
+    // ring[0] (distance to degenerate segment is distance to the point).
+    vector<std::pair<size_t, size_t>> stack = {{0, ring.size() - 1}};
+    while (!stack.empty()) {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        if (last - first < 2) {
+            continue;
+        }
+        double distance;
+        const size_t k = farthest_point(ring, first, last, distance);
+        if (distance > tolerance) {
+            keep[k] = 1;
+            stack.emplace_back(first, k);
+            stack.emplace_back(k, last);
+        }
+    }
+}
+
+// Sign of (b - a) x (c - a), exact: products of 32 bit differences do not fit
+// into int64 so their magnitudes are compared as uint64.
+int orientation(p32 a, p32 b, p32 c) {
+    const int64_t dx1 = int64_t(b.x) - a.x, dy1 = int64_t(b.y) - a.y;
+    const int64_t dx2 = int64_t(c.x) - a.x, dy2 = int64_t(c.y) - a.y;
+    const auto sign = [](int64_t v) { return (v > 0) - (v < 0); };
+    const int s1 = sign(dx1) * sign(dy2), s2 = sign(dy1) * sign(dx2);
+    if (s1 != s2) {
+        return s1 > s2 ? 1 : -1;
+    }
+    if (s1 == 0) {
+        return 0;
+    }
+    const uint64_t m1 = uint64_t(std::abs(dx1)) * uint64_t(std::abs(dy2));
+    const uint64_t m2 = uint64_t(std::abs(dy1)) * uint64_t(std::abs(dx2));
+    if (m1 == m2) {
+        return 0;
+    }
+    return (m1 > m2) == (s1 > 0) ? 1 : -1;
+}
+
+bool on_segment(p32 p, p32 a, p32 b) {
+    return std::min(a.x, b.x) <= p.x && p.x <= std::max(a.x, b.x) && std::min(a.y, b.y) <= p.y &&
+           p.y <= std::max(a.y, b.y);
+}
+
+// Touching counts as intersection too.
+bool segments_intersect(p32 a, p32 b, p32 c, p32 d) {
+    const int o1 = orientation(a, b, c), o2 = orientation(a, b, d);
+    const int o3 = orientation(c, d, a), o4 = orientation(c, d, b);
+    if (o1 * o2 < 0 && o3 * o4 < 0) {
+        return true;
+    }
+    return (o1 == 0 && on_segment(c, a, b)) || (o2 == 0 && on_segment(d, a, b)) ||
+           (o3 == 0 && on_segment(a, c, d)) || (o4 == 0 && on_segment(b, c, d));
+}
+
+struct Segment {
+    uint32_t ring;  // index in shape
+    uint32_t first; // original indices of end points
+    uint32_t last;
+    uint32_t ordinal; // position in simplified ring
+};
+
+// Marks segments which intersect any other non adjacent segment. Segments
+// are bucketed into a uniform grid, only segments sharing a cell are tested.
+void find_intersections(const vector<span<const p32>> &rings, const vector<Segment> &segments,
+                        const vector<uint32_t> &segments_per_ring, vector<uint8_t> &crossing) {
+    crossing.assign(segments.size(), 0);
+    if (segments.size() < 3) {
+        return;
+    }
+    const auto end_points = [&](const Segment &s) {
+        return std::make_pair(rings[s.ring][s.first], rings[s.ring][s.last]);
+    };
+
+    uint32_t min_x = gg::U32_MAX, min_y = gg::U32_MAX, max_x = 0, max_y = 0;
+    for (auto &s : segments) {
+        auto [a, b] = end_points(s);
+        min_x = std::min({min_x, a.x, b.x});
+        min_y = std::min({min_y, a.y, b.y});
+        max_x = std::max({max_x, a.x, b.x});
+        max_y = std::max({max_y, a.y, b.y});
+    }
+    const double extent = std::max<double>({double(max_x) - min_x, double(max_y) - min_y, 1.0});
+    const uint32_t cells = std::clamp<uint32_t>(std::sqrt(double(segments.size())), 1, 1024);
+    const double cell_size = extent / cells + 1;
+
+    vector<std::pair<uint32_t, uint32_t>> cell_segments; // (cell, segment)
+    for (uint32_t i = 0; i < segments.size(); ++i) {
+        auto [a, b] = end_points(segments[i]);
+        const uint32_t x0 = (std::min(a.x, b.x) - min_x) / cell_size;
+        const uint32_t x1 = (std::max(a.x, b.x) - min_x) / cell_size;
+        const uint32_t y0 = (std::min(a.y, b.y) - min_y) / cell_size;
+        const uint32_t y1 = (std::max(a.y, b.y) - min_y) / cell_size;
+        for (uint32_t y = y0; y <= y1; ++y) {
+            for (uint32_t x = x0; x <= x1; ++x) {
+                cell_segments.emplace_back(y * cells + x, i);
+            }
+        }
+    }
+    std::sort(cell_segments.begin(), cell_segments.end());
+
+    const auto adjacent = [&](const Segment &s, const Segment &t) {
+        if (s.ring != t.ring) {
+            return false;
+        }
+        const uint32_t n = segments_per_ring[s.ring];
+        return (s.ordinal + 1) % n == t.ordinal || (t.ordinal + 1) % n == s.ordinal;
+    };
+
+    for (size_t begin = 0; begin < cell_segments.size();) {
+        size_t end = begin;
+        while (end < cell_segments.size() && cell_segments[end].first == cell_segments[begin].first) {
+            ++end;
+        }
+        for (size_t i = begin; i < end; ++i) {
+            const Segment &s = segments[cell_segments[i].second];
+            auto [a, b] = end_points(s);
+            for (size_t j = i + 1; j < end; ++j) {
+                const Segment &t = segments[cell_segments[j].second];
+                if (adjacent(s, t)) {
+                    continue;
+                }
+                auto [c, d] = end_points(t);
+                if (segments_intersect(a, b, c, d)) {
+                    crossing[cell_segments[i].second] = 1;
+                    crossing[cell_segments[j].second] = 1;
+                }
+            }
+        }
+        begin = end;
+    }
+}
+
+void simplify_shape(const GeometryStore &shapes, size_t shape_idx, double tolerance,
+                    GeometryStore &out) {
+    auto [first_ring, last_ring] = shapes.shape_rings(shape_idx);
+    vector<span<const p32>> rings;
+    vector<vector<uint8_t>> keep(last_ring - first_ring);
+    for (size_t r = first_ring; r != last_ring; ++r) {
+        rings.push_back(shapes.ring(r));
+        douglas_peucker(rings.back(), tolerance, keep[r - first_ring]);
+    }
+
+    vector<Segment> segments;
+    vector<uint32_t> segments_per_ring(rings.size());
+    vector<uint8_t> crossing;
+    for (;;) {
+        segments.clear();
+        for (uint32_t r = 0; r < rings.size(); ++r) {
+            const size_t kept = std::count(keep[r].begin(), keep[r].end(), 1);
+            segments_per_ring[r] = 0;
+            if (kept < 4) {
+                continue; // ring collapsed and will be dropped.
+            }
+            uint32_t prev = 0;
+            for (uint32_t i = 1; i < rings[r].size(); ++i) {
+                if (keep[r][i]) {
+                    segments.push_back({r, prev, i, segments_per_ring[r]++});
+                    prev = i;
+                }
+            }
+        }
+
+        find_intersections(rings, segments, segments_per_ring, crossing);
+        bool refined = false;
+        for (size_t i = 0; i < segments.size(); ++i) {
+            const Segment &s = segments[i];
+            if (crossing[i] && s.last - s.first > 1) {
+                double distance;
+                keep[s.ring][farthest_point(rings[s.ring], s.first, s.last, distance)] = 1;
+                refined = true;
+            }
+        }
+        if (!refined) {
+            break;
+        }
+    }
+
+    // Ring 0 is the outer one, holes are meaningless without it so the whole
+    // polygon goes away if it collapses.
+    for (size_t r = 0; r < rings.size(); ++r) {
+        if (segments_per_ring[r] == 0) {
+            if (r == 0) {
+                break;
+            }
+            continue;
+        }
+        for (size_t i = 0; i < rings[r].size(); ++i) {
+            if (keep[r][i]) {
+                out.add_point(rings[r][i]);
+            }
+        }
+        auto ring = out.open_ring();
+        p32 *ring_end = gg::utils::eliminate_parallel_segments(ring.data(), ring.data() + ring.size());
+        out.resize_open_ring(ring_end - ring.data());
+        if (out.open_ring().size() < 4) {
+            out.discard_ring();
+            if (r == 0) {
+                break;
+            }
+        } else {
+            out.finish_ring();
+        }
+    }
+    out.finish_shape();
+}
+} // namespace
+
+GeometryStore simplify_shapes(const GeometryStore &shapes, double tolerance, size_t workers) {
+    const size_t shapes_count = shapes.shapes_count();
+    // Same scheduling as in load_shapes: shapes sizes differ by orders of
+    // magnitude, each one goes into its own slot to keep output deterministic.
+    vector<GeometryStore> simplified(shapes_count);
+    std::atomic<size_t> next_shape{0};
+    workers = std::clamp<size_t>(workers, 1, std::max<size_t>(shapes_count, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        for (size_t i = next_shape++; i < shapes_count; i = next_shape++) {
+            simplify_shape(shapes, i, tolerance, simplified[i]);
+        }
+    });
+
+    GeometryStore res;
+    size_t points_total = 0, rings_total = 0;
+    for (auto &s : simplified) {
+        points_total += s.points_count();
+        rings_total += s.rings_count();
+    }
+    res.reserve(points_total, rings_total, shapes_count);
+    for (auto &s : simplified) {
+        res.append(s);
+    }
+    log_debug("Simplified lands with tolerance {}: {} -> {} points, {} -> {} rings", tolerance,
+              shapes.points_count(), res.points_count(), shapes.rings_count(), res.rings_count());
+    return res;
+}
+
+double lod_tolerance(uint32_t next_level) { return std::ldexp(1.0, 21 - int(next_level)); }
+
+} // namespace map_compiler
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <common/global.h>
+#include <common/parallel.h>
+
+#include "geometry_store.h"
+
+namespace map_compiler {
+
+// Simplifies rings with Douglas–Peucker so that the outline moves by at most
+// `tolerance` units. Rings of a shape are kept free of intersections, both
+// self intersections and with other rings of the same shape: crossing
+// segments are refined with original points until they no longer cross, so
+// earcut gets valid polygons. Holes which collapse to less than a triangle
+// are dropped, as are whole polygons whose outer ring collapses. Shapes are
+// kept (possibly empty) so shape indices stay the same.
+GeometryStore simplify_shapes(const GeometryStore &shapes, double tolerance,
+                              size_t workers = parallel::default_concurrency());
+
+// Tolerance for lands of a level which stays on screen until the camera
+// zooms in far enough for `next_level` to be picked. Lands level L is picked
+// while its tiles are at least half of the window wide (see
+// camera::level_for_zoom), so for windows up to 2048 pixels a pixel is at most
+// 2^(21 - next_level) units there.
+double lod_tolerance(uint32_t next_level);
+
+} // namespace map_compiler
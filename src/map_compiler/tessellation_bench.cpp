@@ -0,0 +1,111 @@
+#include "earcut_p32.h"
+#include "map_compiler_lib.h"
+#include <benchmark/benchmark.h>
+#include <common/log.h>
+#include <cstdlib>
+#include <gg/corpus.h>
+#include <render_units/roads/tesselation.h>
+#include <render_units/roads_shader_aa/make_geometry.h>
+
+// Benchmarks of tessellation kernels: roads extrusion on synthetic polylines
+// (see gg/corpus.h) and earcut on synthetic rings and on Natural Earth lands,
+// which are read from $DATA_ROOT. Sizes are points per polyline or polygon.
+
+namespace {
+const double ROAD_WIDTH = 2000;
+
+template <class Settings> void BM_generate_geometry(benchmark::State &state) {
+    const auto polyline = gg::corpus::random_polyline(state.range(0), 1);
+    const auto capacity = roads::tesselation::required_capacity<Settings>(polyline);
+    // Preallocated as the render units do, so only tessellation is measured.
+    vector<p32> triangles(capacity.triangles_vertices);
+    vector<p32> outline(capacity.outline_points);
+    DebugCtx dctx;
+    for (auto _ : state) {
+        OutputWriter<p32> writer(triangles);
+        benchmark::DoNotOptimize(roads::tesselation::generate_geometry<Settings>(
+            polyline, writer, outline, ROAD_WIDTH, dctx));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.size());
+}
+BENCHMARK_TEMPLATE(BM_generate_geometry, roads::tesselation::DefaultRenderSettings)
+    ->RangeMultiplier(8)
+    ->Range(64, 32768);
+BENCHMARK_TEMPLATE(BM_generate_geometry, roads::tesselation::FirstPassSettings)
+    ->RangeMultiplier(8)
+    ->Range(64, 32768);
+BENCHMARK_TEMPLATE(BM_generate_geometry, roads::tesselation::AAPassSettings)
+    ->RangeMultiplier(8)
+    ->Range(64, 32768);
+
+void BM_make_geometry(benchmark::State &state) {
+    const auto polyline = gg::corpus::random_polyline(state.range(0), 1);
+    const auto capacity = roads_shader_aa::required_capacity(polyline);
+    vector<roads_shader_aa::AAVertex> vertices(capacity.vertices);
+    vector<uint32_t> indices(capacity.indices);
+    DebugCtx dctx;
+    for (auto _ : state) {
+        OutputWriter<roads_shader_aa::AAVertex> vertices_writer(vertices);
+        OutputWriter<uint32_t> indices_writer(indices);
+        benchmark::DoNotOptimize(roads_shader_aa::make_geometry(
+            polyline, ROAD_WIDTH, vertices_writer, indices_writer, dctx));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * polyline.size());
+}
+BENCHMARK(BM_make_geometry)->RangeMultiplier(8)->Range(64, 32768);
+
+void BM_earcut_synthetic_ring(benchmark::State &state) {
+    const vector<vector<p32>> polygon{gg::corpus::random_ring(state.range(0), 1)};
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mapbox::earcut(polygon));
+    }
+    state.SetItemsProcessed(state.iterations() * polygon[0].size());
+}
+BENCHMARK(BM_earcut_synthetic_ring)->RangeMultiplier(8)->Range(64, 32768);
+
+// Loaded once for all sizes, empty if there is no data.
+const map_compiler::GeometryStore &natural_earth_lands() {
+    static const map_compiler::GeometryStore shapes = [] {
+        const char *data_root = std::getenv("DATA_ROOT");
+        const auto path = fs::path(data_root ? data_root : "") / "natural_earth" / "ne_10m_land" /
+                          "ne_10m_land.shp";
+        return fs::exists(path) ? map_compiler::load_shapes(path) : map_compiler::GeometryStore{};
+    }();
+    return shapes;
+}
+
+// Real coastlines, the polygon (outer ring and holes) with the number of
+// points closest to the argument.
+void BM_earcut_natural_earth(benchmark::State &state) {
+    const auto &shapes = natural_earth_lands();
+    if (shapes.shapes_count() == 0) {
+        state.SkipWithError("no $DATA_ROOT/natural_earth/ne_10m_land/ne_10m_land.shp");
+        return;
+    }
+    const auto distance = [&](size_t shape_idx) {
+        const auto points = static_cast<int64_t>(shapes.shape_points(shape_idx).size());
+        return std::abs(points - state.range(0));
+    };
+    size_t best = 0;
+    for (size_t s = 1; s < shapes.shapes_count(); ++s) {
+        if (distance(s) < distance(best)) {
+            best = s;
+        }
+    }
+    vector<span<const p32>> polygon;
+    auto [first_ring, last_ring] = shapes.shape_rings(best);
+    for (size_t r = first_ring; r != last_ring; ++r) {
+        polygon.push_back(shapes.ring(r));
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mapbox::earcut(polygon));
+    }
+    state.counters["points"] = shapes.shape_points(best).size();
+    state.SetItemsProcessed(state.iterations() * shapes.shape_points(best).size());
+}
+BENCHMARK(BM_earcut_natural_earth)->RangeMultiplier(8)->Range(64, 32768);
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,225 @@
+#include "tile_clipper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <common/log.h>
+#include <functional>
+#include <map>
+
+#include "polygons.h"
+
+namespace map_compiler {
+
+namespace {
+struct pt64 {
+    int64_t x, y;
+};
+bool operator==(const pt64 &a, const pt64 &b) { return a.x == b.x && a.y == b.y; }
+bool operator!=(const pt64 &a, const pt64 &b) { return !(a == b); }
+
+enum class Edge { left, right, top, bottom };
+
+bool inside(pt64 p, Edge e, const ClipBox &box) {
+    switch (e) {
+    case Edge::left:
+        return p.x >= box.min_x;
+    case Edge::right:
+        return p.x <= box.max_x;
+    case Edge::top:
+        return p.y >= box.min_y;
+    case Edge::bottom:
+        return p.y <= box.max_y;
+    }
+    return false;
+}
+
+// Intersection of segment with the line of the edge, segment must cross it.
+pt64 intersect(pt64 a, pt64 b, Edge e, const ClipBox &box) {
+    if (std::tie(b.x, b.y) < std::tie(a.x, a.y)) {
+        std::swap(a, b);
+    }
+    // coordinates products do not fit into 64 bits, double keeps result
+    // within one unit which is all we need.
+    if (e == Edge::left || e == Edge::right) {
+        const int64_t x = e == Edge::left ? box.min_x : box.max_x;
+        const double t = double(x - a.x) / double(b.x - a.x);
+        return {x, a.y + std::llround(t * double(b.y - a.y))};
+    }
+    const int64_t y = e == Edge::top ? box.min_y : box.max_y;
+    const double t = double(y - a.y) / double(b.y - a.y);
+    return {a.x + std::llround(t * double(b.x - a.x)), y};
+}
+
+void clip_against(const vector<pt64> &in, Edge e, const ClipBox &box, vector<pt64> &out) {
+    out.clear();
+    const size_t n = in.size();
+    for (size_t i = 0; i < n; ++i) {
+        const pt64 prev = in[(i + n - 1) % n];
+        const pt64 cur = in[i];
+        const bool cur_inside = inside(cur, e, box);
+        if (cur_inside != inside(prev, e, box)) {
+            out.push_back(intersect(prev, cur, e, box));
+        }
+        if (cur_inside) {
+            out.push_back(cur);
+        }
+    }
+}
+
+uint32_t to_units(int64_t v) { return static_cast<uint32_t>(std::min<int64_t>(v, gg::U32_MAX)); }
+} // namespace
+
+ClipBox tile_clip_box(gg::tile_at_level_t tile) {
+    const gg::gbb_t bb = gg::tile_bb(tile);
+    return {bb.top_left.x, bb.top_left.y, int64_t(bb.top_left.x) + bb.width,
+            int64_t(bb.top_left.y) + bb.height};
+}
+
+size_t clip_ring(span<const p32> ring, const ClipBox &box, vector<p32> &out) {
+    assert(ring.size() >= 3 && ring.front() == ring.back());
+
+    int64_t min_x = ring[0].x, min_y = ring[0].y, max_x = ring[0].x, max_y = ring[0].y;
+    for (auto &p : ring) {
+        min_x = std::min<int64_t>(min_x, p.x);
+        min_y = std::min<int64_t>(min_y, p.y);
+        max_x = std::max<int64_t>(max_x, p.x);
+        max_y = std::max<int64_t>(max_y, p.y);
+    }
+    if (max_x < box.min_x || min_x > box.max_x || max_y < box.min_y || min_y > box.max_y) {
+        return 0;
+    }
+    if (min_x >= box.min_x && max_x <= box.max_x && min_y >= box.min_y && max_y <= box.max_y) {
+        out.insert(out.end(), ring.begin(), ring.end());
+        return ring.size();
+    }
+
+    // ring without closing point.
+    vector<pt64> a, b;
+    a.reserve(ring.size());
+    for (size_t i = 0; i + 1 < ring.size(); ++i) {
+        a.push_back({ring[i].x, ring[i].y});
+    }
+    for (Edge e : {Edge::left, Edge::right, Edge::top, Edge::bottom}) {
+        clip_against(a, e, box, b);
+        std::swap(a, b);
+        if (a.empty()) {
+            return 0;
+        }
+    }
+
+    // drop duplicates produced when ring touches the box boundary.
+    b.clear();
+    for (auto &p : a) {
+        if (b.empty() || b.back() != p) {
+            b.push_back(p);
+        }
+    }
+    while (b.size() > 1 && b.front() == b.back()) {
+        b.pop_back();
+    }
+    if (b.size() < 3) {
+        return 0;
+    }
+    const size_t first = out.size();
+    for (auto &p : b) {
+        out.emplace_back(to_units(p.x), to_units(p.y));
+    }
+    out.push_back(out[first]);
+    // exact, products of absolute coordinates lose small rings far from origin.
+    if (ring_signed_area2(span<const p32>(out.data() + first, b.size() + 1)) == 0) {
+        out.resize(first);
+        return 0; // only slivers along the boundary are left.
+    }
+    return b.size() + 1;
+}
+
+bool is_boundary_segment(p32 a, p32 b, const ClipBox &box) {
+    const auto on_vertical = [&](int64_t x) { return a.x == b.x && a.x == to_units(x); };
+    const auto on_horizontal = [&](int64_t y) { return a.y == b.y && a.y == to_units(y); };
+    return on_vertical(box.min_x) || on_vertical(box.max_x) || on_horizontal(box.min_y) ||
+           on_horizontal(box.max_y);
+}
+
+vector<TileShapes> slice_to_tiles(const GeometryStore &shapes, span<const uint32_t> levels) {
+    if (levels.empty()) {
+        return {};
+    }
+    uint64_t wanted_levels = 0;
+    for (auto level : levels) {
+        if (level > 15) {
+            throw std::runtime_error(fmt::format("tile level {} is out of range [0, 15]", level));
+        }
+        wanted_levels |= uint64_t(1) << level;
+    }
+    const uint32_t max_level = *std::max_element(levels.begin(), levels.end());
+
+    // keyed by level and tile id so iteration order is the output order.
+    std::map<std::pair<uint32_t, uint32_t>, GeometryStore> slots;
+
+    // Polygon is clipped ring by ring, outer ring first. Holes which miss the
+    // tile are dropped, a hole covering the whole tile leaves no land in it
+    // nor in any of its children.
+    using Polygon = vector<vector<p32>>;
+    std::function<void(const Polygon &, gg::tile_at_level_t)> slice =
+        [&](const Polygon &polygon, gg::tile_at_level_t tile) {
+            const ClipBox box = tile_clip_box(tile);
+            const double box_area2 =
+                2.0 * double(to_units(box.max_x) - to_units(box.min_x)) *
+                double(to_units(box.max_y) - to_units(box.min_y));
+            Polygon clipped(1);
+            if (clip_ring(polygon[0], box, clipped[0]) == 0) {
+                return;
+            }
+            for (size_t r = 1; r < polygon.size(); ++r) {
+                vector<p32> hole;
+                if (clip_ring(polygon[r], box, hole) == 0) {
+                    continue;
+                }
+                if (std::abs(ring_signed_area2(hole)) >= box_area2) {
+                    return;
+                }
+                clipped.push_back(std::move(hole));
+            }
+            if (wanted_levels & (uint64_t(1) << tile.level)) {
+                GeometryStore &store = slots[{tile.level, tile.id.id}];
+                for (auto &ring : clipped) {
+                    store.add_ring(ring);
+                }
+                store.finish_shape();
+            }
+            if (tile.level < max_level) {
+                for (auto child : gg::children_tiles(tile)) {
+                    slice(clipped, {child, tile.level + 1});
+                }
+            }
+        };
+
+    Polygon polygon;
+    for (size_t shape_idx = 0; shape_idx < shapes.shapes_count(); ++shape_idx) {
+        auto [first_ring, last_ring] = shapes.shape_rings(shape_idx);
+        if (first_ring == last_ring) {
+            continue;
+        }
+        polygon.clear();
+        for (size_t ring_idx = first_ring; ring_idx != last_ring; ++ring_idx) {
+            auto ring = shapes.ring(ring_idx);
+            polygon.emplace_back(ring.begin(), ring.end());
+        }
+        // level 0 already splits the world into 2x2 tiles, see gg::tile_bb.
+        for (uint16_t y = 0; y < 2; ++y) {
+            for (uint16_t x = 0; x < 2; ++x) {
+                slice(polygon, {gg::tile_id_t{x, y}, 0});
+            }
+        }
+    }
+
+    vector<TileShapes> res;
+    res.reserve(slots.size());
+    for (auto &[key, store] : slots) {
+        res.push_back({gg::tile_at_level_t{gg::tile_id_t{key.second}, key.first},
+                       std::move(store)});
+    }
+    return res;
+}
+
+} // namespace map_compiler
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+
+#include "geometry_store.h"
+
+namespace map_compiler {
+
+// Axis aligned box in world coordinates, bounds are inclusive. Coordinates are
+// 64 bit since tiles touching right or bottom edge of the world end at 2^32.
+struct ClipBox {
+    int64_t min_x, min_y, max_x, max_y;
+};
+
+ClipBox tile_clip_box(gg::tile_at_level_t tile);
+
+// Clips closed ring against the box with Sutherland–Hodgman. Result is
+// appended to `out` as a closed ring, returns number of points appended or 0
+// if nothing is left of the ring. Parts of a concave ring which are connected
+// only outside of the box stay connected by zero width edges along the box
+// boundary, earcut handles those fine.
+//
+// Intersections are computed from segment end points taken in canonical
+// order, so the same segment gets cut at the same point in both tiles sharing
+// the boundary and tiles meet without cracks.
+size_t clip_ring(span<const p32> ring, const ClipBox &box, vector<p32> &out);
+
+// True if segment lies on the boundary of the box, i.e. it was produced by
+// clipping and is not a part of the original coastline.
+bool is_boundary_segment(p32 a, p32 b, const ClipBox &box);
+
+struct TileShapes {
+    gg::tile_at_level_t tile;
+    GeometryStore shapes;
+};
+
+// Cuts polygons (outer ring first, then holes) along tile grid at each of
+// `levels`. Every polygon which crosses a tile becomes one polygon of that
+// tile: its clipped outer ring followed by clipped holes which reach into the
+// tile. Tiles without any geometry are skipped, result is sorted by level and
+// then by tile id.
+//
+// Rings are cut top-down: pieces clipped to a tile are clipped again to its
+// children, so each level only processes geometry of its parent tile.
+vector<TileShapes> slice_to_tiles(const GeometryStore &shapes, span<const uint32_t> levels);
+
+} // namespace map_compiler
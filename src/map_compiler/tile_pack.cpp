@@ -0,0 +1,132 @@
+#include "tile_pack.h"
+
+#include <common/default_init_allocator.h>
+#include <common/log.h>
+#include <cstring>
+#include <fstream>
+#include <render_units/roads_shader_aa/packed_vertex.h>
+
+namespace map_compiler::tile_pack {
+
+namespace {
+uint64_t align_up(uint64_t v) { return (v + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE; }
+
+struct PackWriter {
+    std::ofstream &os;
+    uint64_t pos = 0;
+
+    void pad_to_page() {
+        static const char zeros[PAGE_SIZE] = {};
+        const uint64_t aligned = align_up(pos);
+        os.write(zeros, aligned - pos);
+        pos = aligned;
+    }
+
+    template <class T, class A> Section write_section(const std::vector<T, A> &data) {
+        pad_to_page();
+        Section s{pos, data.size()};
+        os.write(reinterpret_cast<const char *>(data.data()), data.size() * sizeof(T));
+        pos += data.size() * sizeof(T);
+        return s;
+    }
+};
+} // namespace
+
+void write_tile_pack(const fs::path &path, const vector<PackTile> &tiles) {
+    auto tmp_path = path;
+    tmp_path += ".tmp";
+
+    {
+        std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!os) {
+            throw std::runtime_error(fmt::format("failed opening {} for writing: {}({})",
+                                                 tmp_path, strerror(errno), errno));
+        }
+
+        // header is written last when all offsets are known.
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.page_size = PAGE_SIZE;
+        header.vertex_size = sizeof(p32);
+        header.aa_vertex_size = sizeof(roads_shader_aa::PackedAAVertex);
+        header.tiles_count = tiles.size();
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+        PackWriter w{os, sizeof(header)};
+        vector<TileEntry> entries;
+        entries.reserve(tiles.size());
+        uninit_vector<roads_shader_aa::PackedAAVertex> aa_vertices;
+        for (auto &t : tiles) {
+            TileEntry e{};
+            e.tile_id = t.tile.id.id;
+            e.level = t.tile.level;
+            e.aa_box = roads_shader_aa::quantization_box(t.mesh.aa_vertices);
+            aa_vertices.resize(t.mesh.aa_vertices.size());
+            roads_shader_aa::pack_vertices(t.mesh.aa_vertices, e.aa_box, aa_vertices);
+            e.sections[SectionKind::vertices] = w.write_section(t.mesh.vertices);
+            e.sections[SectionKind::indices] = w.write_section(t.mesh.indices);
+            e.sections[SectionKind::aa_vertices] = w.write_section(aa_vertices);
+            e.sections[SectionKind::aa_indices] = w.write_section(t.mesh.aa_indices);
+            entries.emplace_back(e);
+        }
+        header.tiles_table_offset = w.write_section(entries).offset;
+
+        os.seekp(0);
+        os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if (!os) {
+            throw std::runtime_error(fmt::format("failed writing {}", tmp_path));
+        }
+    }
+
+    fs::rename(tmp_path, path);
+}
+
+std::unique_ptr<TilePack> TilePack::open(const fs::path &path) {
+    std::unique_ptr<TilePack> pack(new TilePack());
+
+    pack->m_file = MappedFile::open(path);
+    const uint8_t *data = pack->m_file.data();
+    const size_t size = pack->m_file.size();
+
+    if (size < sizeof(Header)) {
+        throw std::runtime_error(fmt::format("tile pack {} is truncated", path));
+    }
+    const auto &header = *reinterpret_cast<const Header *>(data);
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(fmt::format("{} is not a tile pack", path));
+    }
+    if (header.version != VERSION || header.page_size != PAGE_SIZE ||
+        header.vertex_size != sizeof(p32) ||
+        header.aa_vertex_size != sizeof(roads_shader_aa::PackedAAVertex)) {
+        throw std::runtime_error(
+            fmt::format("tile pack {} has incompatible version {} (expected {}), recompile it",
+                        path, header.version, VERSION));
+    }
+    if (header.tiles_table_offset + header.tiles_count * sizeof(TileEntry) > size) {
+        throw std::runtime_error(fmt::format("tile pack {} is truncated", path));
+    }
+    pack->m_tiles = span<const TileEntry>(
+        reinterpret_cast<const TileEntry *>(data + header.tiles_table_offset),
+        header.tiles_count);
+
+    const size_t element_sizes[SectionKind::sections_count] = {
+        sizeof(p32), sizeof(uint32_t), sizeof(roads_shader_aa::PackedAAVertex), sizeof(uint32_t)};
+    for (auto &t : pack->m_tiles) {
+        for (uint32_t k = 0; k < SectionKind::sections_count; ++k) {
+            if (t.sections[k].offset + t.sections[k].count * element_sizes[k] > size) {
+                throw std::runtime_error(fmt::format("tile pack {} is truncated", path));
+            }
+        }
+        pack->m_index.emplace(gg::tile_key(t.tile()), &t);
+    }
+
+    return pack;
+}
+
+const TileEntry *TilePack::find(gg::tile_at_level_t tile) const {
+    auto it = m_index.find(gg::tile_key(tile));
+    return it == m_index.end() ? nullptr : it->second;
+}
+
+} // namespace map_compiler::tile_pack
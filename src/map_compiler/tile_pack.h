@@ -0,0 +1,123 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+#include <unordered_map>
+
+#include "lands_compiler.h"
+#include "mapped_file.h"
+#include <render_units/roads_shader_aa/types.h>
+
+// Tile pack is a binary file produced offline by map_compiler which contains
+// pre-triangulated geometry keyed by tile. The file is designed to be mapped
+// into memory and handed to render units as is, without any parsing.
+//
+// Layout (all sections start on a page boundary):
+//
+//   +----------------------------+ 0
+//   | Header                     |
+//   +----------------------------+ page
+//   | tile 0 vertices            |
+//   | tile 0 indices             |
+//   | tile 0 aa vertices         |
+//   | tile 0 aa indices          |
+//   | ...                        |
+//   | tile N-1 aa indices        |
+//   +----------------------------+ header.tiles_table_offset
+//   | TileEntry[header.tiles_count]
+//   +----------------------------+
+//
+// AA vertices are stored packed (roads_shader_aa::PackedAAVertex) relative to
+// the quantization box kept in the tile's entry.
+//
+// Data is stored in native byte order of the machine which compiled the pack.
+namespace map_compiler::tile_pack {
+
+constexpr char MAGIC[8] = {'G', 'G', 'T', 'P', 'A', 'C', 'K', '\0'};
+// Bump this every time layout of the file or of the vertex types changes.
+constexpr uint32_t VERSION = 2;
+constexpr uint32_t PAGE_SIZE = 4096;
+
+struct Section {
+    uint64_t offset; // in bytes from beginning of the file.
+    uint64_t count;  // number of elements.
+};
+
+enum SectionKind : uint32_t { vertices, indices, aa_vertices, aa_indices, sections_count };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    // sizes of elements, just a cheap guard against layout changes not
+    // reflected in VERSION.
+    uint32_t vertex_size;
+    uint32_t aa_vertex_size;
+    uint32_t tiles_count;
+    uint32_t reserved;
+    uint64_t tiles_table_offset;
+};
+static_assert(sizeof(Header) == 40);
+
+struct TileEntry {
+    uint32_t tile_id; // gg::tile_id_t::id
+    uint32_t level;
+    Section sections[sections_count];
+    roads_shader_aa::QuantizationBox aa_box; // of the tile's aa vertices.
+    uint32_t reserved;
+
+    gg::tile_at_level_t tile() const { return {gg::tile_id_t{tile_id}, level}; }
+};
+static_assert(sizeof(TileEntry) == 8 + 16 * sections_count + 16);
+
+struct PackTile {
+    gg::tile_at_level_t tile;
+    LandsMesh mesh;
+};
+
+// Writes tiles into pack file. File is written into temporary file next to
+// the path and then renamed so readers never see partially written pack.
+void write_tile_pack(const fs::path &path, const vector<PackTile> &tiles);
+
+// Read only view of tile pack file mapped into memory.
+class TilePack {
+  public:
+    // Throws std::runtime_error if file cannot be opened or has unexpected format.
+    static std::unique_ptr<TilePack> open(const fs::path &path);
+
+    TilePack(const TilePack &) = delete;
+    TilePack &operator=(const TilePack &) = delete;
+
+    span<const TileEntry> tiles() const { return m_tiles; }
+    // Renderers look tiles up every frame, so it is a hash lookup.
+    const TileEntry *find(gg::tile_at_level_t tile) const;
+
+    // Memory is mapped privately (copy-on-write) so handing out mutable
+    // spans is safe, file on disk is never modified.
+    span<p32> vertices(const TileEntry &t) const { return section<p32>(t, SectionKind::vertices); }
+    span<uint32_t> indices(const TileEntry &t) const {
+        return section<uint32_t>(t, SectionKind::indices);
+    }
+    span<roads_shader_aa::PackedAAVertex> aa_vertices(const TileEntry &t) const {
+        return section<roads_shader_aa::PackedAAVertex>(t, SectionKind::aa_vertices);
+    }
+    span<uint32_t> aa_indices(const TileEntry &t) const {
+        return section<uint32_t>(t, SectionKind::aa_indices);
+    }
+
+    size_t size_bytes() const { return m_file.size(); }
+
+  private:
+    TilePack() = default;
+
+    template <class T> span<T> section(const TileEntry &t, SectionKind kind) const {
+        const Section &s = t.sections[kind];
+        return span<T>(reinterpret_cast<T *>(m_file.data() + s.offset), s.count);
+    }
+
+    MappedFile m_file;
+    span<const TileEntry> m_tiles;
+    std::unordered_map<uint64_t, const TileEntry *> m_index; // by gg::tile_key
+};
+
+} // namespace map_compiler::tile_pack
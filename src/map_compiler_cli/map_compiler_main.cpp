@@ -0,0 +1,99 @@
+#include <common/global.h>
+#include <common/log.h>
+#include <sstream>
+
+#include <lands_compiler.h>
+#include <map_compiler_lib.h>
+#include <simplify.h>
+#include <tile_clipper.h>
+#include <tile_pack.h>
+
+namespace {
+// Tiles of level L are 2^(31 - L) units wide, see gg::tile_bb. Every level is
+// simplified for the zooms until the next one, so gaps make coarse levels
+// heavier.
+const vector<uint32_t> DEFAULT_LEVELS = {0, 1, 2, 3, 4};
+
+std::optional<vector<uint32_t>> parse_levels(const std::string &arg) {
+    vector<uint32_t> levels;
+    std::stringstream ss(arg);
+    for (std::string item; std::getline(ss, item, ',');) {
+        char *end = nullptr;
+        const unsigned long level = std::strtoul(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || level > 15) {
+            return std::nullopt;
+        }
+        levels.push_back(level);
+    }
+    if (levels.empty()) {
+        return std::nullopt;
+    }
+    return levels;
+}
+} // namespace
+
+// Compiles lands shapefile into tile pack which render_demo can map into memory
+// instead of loading and triangulating shapes on every start. Lands are cut
+// along tile grid of each of the levels and every tile is triangulated on its
+// own. Levels form LOD pyramid: each one but the finest is simplified to the
+// pixel size at the most detailed zoom it is shown at.
+//
+// usage: map_compiler <lands.shp> <output.pack> [levels, e.g. 0,1,2,3,4]
+int main(int argc, char **argv) {
+    if (argc != 3 && argc != 4) {
+        log_err("usage: {} <lands.shp> <output.pack> [levels, e.g. 0,1,2,3,4]",
+                argc > 0 ? argv[0] : "map_compiler");
+        return -1;
+    }
+    const fs::path shapes_path = argv[1];
+    const fs::path pack_path = argv[2];
+    auto levels = argc == 4 ? parse_levels(argv[3]) : std::make_optional(DEFAULT_LEVELS);
+    if (!levels) {
+        log_err("invalid levels '{}', expected comma separated numbers in [0, 15]", argv[3]);
+        return -1;
+    }
+
+    try {
+        auto start_time = steady_clock::now();
+
+        DebugCtx dctx;
+        vector<map_compiler::tile_pack::PackTile> tiles;
+        auto shapes = map_compiler::load_shapes(shapes_path);
+        std::sort(levels->begin(), levels->end());
+        levels->erase(std::unique(levels->begin(), levels->end()), levels->end());
+        for (size_t i = 0; i < levels->size(); ++i) {
+            const uint32_t level = (*levels)[i];
+            std::optional<map_compiler::GeometryStore> simplified;
+            if (i + 1 < levels->size()) {
+                simplified = map_compiler::simplify_shapes(
+                    shapes, map_compiler::lod_tolerance((*levels)[i + 1]));
+            }
+            const uint32_t slice_levels[] = {level};
+            for (auto &t : map_compiler::slice_to_tiles(simplified ? *simplified : shapes,
+                                                        slice_levels)) {
+                tiles.push_back({t.tile, map_compiler::compile_lands(
+                                             t.shapes, dctx, map_compiler::tile_clip_box(t.tile))});
+            }
+        }
+        map_compiler::tile_pack::write_tile_pack(pack_path, tiles);
+
+        size_t vertices = 0, indices = 0, aa_vertices = 0, aa_indices = 0;
+        for (auto &t : tiles) {
+            vertices += t.mesh.vertices.size();
+            indices += t.mesh.indices.size();
+            aa_vertices += t.mesh.aa_vertices.size();
+            aa_indices += t.mesh.aa_indices.size();
+        }
+        log_debug("Written {}: {} tiles, {} vertices, {} indices, {} aa vertices, {} aa indices "
+                  "({}ms)",
+                  pack_path, tiles.size(), vertices, indices, aa_vertices, aa_indices,
+                  std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock::now() -
+                                                                        start_time)
+                      .count());
+    } catch (const std::exception &e) {
+        log_err("failed compiling map: {}", e.what());
+        return -1;
+    }
+
+    return 0;
+}
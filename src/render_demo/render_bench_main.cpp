@@ -0,0 +1,538 @@
+#include "common/global.h"
+#include "glad/glad.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+#include "common/gl_check.h"
+#include "common/log.h"
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/camera.h"
+#include "render_lib/frame_uniforms.h"
+#include "render_lib/gl_state.h"
+#include "render_lib/gpu_heap.h"
+#include "render_lib/profiler.h"
+#include "render_lib/render.h"
+#include "render_lib/shader_cache.h"
+#include "render_lib/tile_cache.h"
+#include "render_units/lands/lands.h"
+#include "render_units/roads/roads_unit.h"
+#include "render_units/roads_shader_aa/roads_shader_aa_unit.h"
+#include "scenes.h"
+
+namespace {
+const char *USAGE = "usage: {} [--scene lands|roads|aa] [--frames N] [--warmup N] [--size WxH] "
+                    "[--context surfaceless|pbuffer] [--save-hashes file] [--check-hashes file] "
+                    "[--profile file.csv|file.json]";
+
+struct Options {
+    vector<std::string> scenes; // all if empty.
+    size_t frames = 600;
+    size_t warmup = 10;
+    int width = 1280;
+    int height = 720;
+    std::string context = "surfaceless";
+    fs::path save_hashes;
+    fs::path check_hashes;
+    fs::path profile;
+};
+
+std::optional<Options> parse_options(int argc, char **argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (i + 1 == argc) {
+            return std::nullopt; // every option has a value.
+        }
+        const std::string value = argv[++i];
+        char *end = nullptr;
+        if (arg == "--scene") {
+            options.scenes.push_back(value);
+        } else if (arg == "--frames") {
+            options.frames = std::strtoul(value.c_str(), &end, 10);
+            if (*end != '\0' || options.frames == 0) {
+                return std::nullopt;
+            }
+        } else if (arg == "--warmup") {
+            options.warmup = std::strtoul(value.c_str(), &end, 10);
+            if (*end != '\0') {
+                return std::nullopt;
+            }
+        } else if (arg == "--size") {
+            if (std::sscanf(value.c_str(), "%dx%d", &options.width, &options.height) != 2 ||
+                options.width <= 0 || options.height <= 0) {
+                return std::nullopt;
+            }
+        } else if (arg == "--context") {
+            if (value != "surfaceless" && value != "pbuffer") {
+                return std::nullopt;
+            }
+            options.context = value;
+        } else if (arg == "--save-hashes") {
+            options.save_hashes = value;
+        } else if (arg == "--check-hashes") {
+            options.check_hashes = value;
+        } else if (arg == "--profile") {
+            options.profile = value;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return options;
+}
+
+void *gl_proc_address(const char *name) {
+    return reinterpret_cast<void *>(eglGetProcAddress(name));
+}
+
+// GL context of EGL without any window system, frames are drawn into
+// Framebuffer. "surfaceless" is the Mesa surfaceless platform: llvmpipe with
+// LIBGL_ALWAYS_SOFTWARE=1, a GPU render node otherwise. "pbuffer" is a pbuffer
+// of the default display (EGL_PLATFORM picks it), for drivers without that
+// platform.
+class OffscreenContext {
+  public:
+    static std::unique_ptr<OffscreenContext> create(const std::string &kind) {
+        auto res = std::unique_ptr<OffscreenContext>(new OffscreenContext());
+        if (kind == "surfaceless") {
+            const auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+            if (get_platform_display) {
+                res->m_display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                                      EGL_DEFAULT_DISPLAY, nullptr);
+            }
+        } else {
+            res->m_display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        EGLint major = 0, minor = 0;
+        if (res->m_display == EGL_NO_DISPLAY || !eglInitialize(res->m_display, &major, &minor)) {
+            log_err("EGL: no {} display: {:#x}", kind, eglGetError());
+            return nullptr;
+        }
+        const EGLint config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE,
+                                         EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint configs = 0;
+        if (!eglBindAPI(EGL_OPENGL_API) ||
+            !eglChooseConfig(res->m_display, config_attribs, &config, 1, &configs) ||
+            configs == 0) {
+            log_err("EGL {}.{}: no config for desktop GL: {:#x}", major, minor, eglGetError());
+            return nullptr;
+        }
+        // Same as render_demo asks GLFW for.
+        const EGLint context_attribs[] = {EGL_CONTEXT_MAJOR_VERSION,
+                                          3,
+                                          EGL_CONTEXT_MINOR_VERSION,
+                                          3,
+                                          EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                          EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                          EGL_NONE};
+        res->m_context =
+            eglCreateContext(res->m_display, config, EGL_NO_CONTEXT, context_attribs);
+        if (res->m_context == EGL_NO_CONTEXT) {
+            log_err("EGL: failed creating GL 3.3 core context: {:#x}", eglGetError());
+            return nullptr;
+        }
+        const char *extensions = eglQueryString(res->m_display, EGL_EXTENSIONS);
+        if (kind == "pbuffer" || !extensions ||
+            !std::strstr(extensions, "EGL_KHR_surfaceless_context")) {
+            const EGLint surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            res->m_surface = eglCreatePbufferSurface(res->m_display, config, surface_attribs);
+            if (res->m_surface == EGL_NO_SURFACE) {
+                log_err("EGL: failed creating pbuffer: {:#x}", eglGetError());
+                return nullptr;
+            }
+        }
+        if (!eglMakeCurrent(res->m_display, res->m_surface, res->m_surface, res->m_context)) {
+            log_err("EGL: failed making context current: {:#x}", eglGetError());
+            return nullptr;
+        }
+        return res;
+    }
+
+    ~OffscreenContext() {
+        if (m_display == EGL_NO_DISPLAY) {
+            return;
+        }
+        eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (m_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(m_display, m_surface);
+        }
+        if (m_context != EGL_NO_CONTEXT) {
+            eglDestroyContext(m_display, m_context);
+        }
+        eglTerminate(m_display);
+    }
+
+    OffscreenContext(const OffscreenContext &) = delete;
+    OffscreenContext &operator=(const OffscreenContext &) = delete;
+
+  private:
+    OffscreenContext() = default;
+
+    EGLDisplay m_display = EGL_NO_DISPLAY;
+    EGLContext m_context = EGL_NO_CONTEXT;
+    EGLSurface m_surface = EGL_NO_SURFACE;
+};
+
+struct CameraKey {
+    glm::vec2 focus_pos;
+    double zoom;
+    double rotation = 0;
+};
+
+// Camera at t in [0, 1] along keys evenly spread over the path. Zoom is
+// interpolated in log space, so zooming in goes at a steady pace.
+camera::Cam2d camera_at(span<const CameraKey> path, double t, glm::vec2 window_size) {
+    camera::Cam2d cam;
+    cam.window_size = window_size;
+    const double pos = std::clamp(t, 0.0, 1.0) * (path.size() - 1);
+    const size_t i = std::min(static_cast<size_t>(pos), path.size() - 2);
+    const double k = pos - i;
+    const CameraKey &a = path[i];
+    const CameraKey &b = path[i + 1];
+    cam.focus_pos = a.focus_pos + (b.focus_pos - a.focus_pos) * static_cast<float>(k);
+    cam.zoom = std::exp(std::log(a.zoom) + (std::log(b.zoom) - std::log(a.zoom)) * k);
+    cam.rotation = a.rotation + (b.rotation - a.rotation) * k;
+    return cam;
+}
+
+glm::vec2 lon_lat(double lon, double lat) {
+    return glm::vec2(gg::lon_to_x(lon), gg::lat_to_y(lat));
+}
+
+// Nearest rank of sorted samples.
+double percentile(const vector<double> &sorted, double p) {
+    const size_t rank = static_cast<size_t>(std::ceil(sorted.size() * p));
+    return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+// FNV-1a, the same pixels give the same hash on every run.
+uint64_t fnv1a(span<const uint8_t> data) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t b : data) {
+        hash ^= b;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Color target of all frames, so their size doesn't depend on the window.
+class Framebuffer {
+  public:
+    Framebuffer(int width, int height) : m_width(width), m_height(height) {
+        GL_CHECK(glGenRenderbuffers(1, &m_color));
+        GL_CHECK(glBindRenderbuffer(GL_RENDERBUFFER, m_color));
+        GL_CHECK(glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height));
+        GL_CHECK(glGenFramebuffers(1, &m_fbo));
+        GL_CHECK(glBindFramebuffer(GL_FRAMEBUFFER, m_fbo));
+        GL_CHECK(glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                           m_color));
+        m_complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        GL_CHECK(glViewport(0, 0, width, height));
+    }
+    ~Framebuffer() {
+        GL_CHECK(glDeleteFramebuffers(1, &m_fbo));
+        GL_CHECK(glDeleteRenderbuffers(1, &m_color));
+    }
+
+    Framebuffer(const Framebuffer &) = delete;
+    Framebuffer &operator=(const Framebuffer &) = delete;
+
+    bool complete() const { return m_complete; }
+
+    uint64_t hash() const {
+        vector<uint8_t> pixels(size_t(m_width) * m_height * 4);
+        GL_CHECK(glPixelStorei(GL_PACK_ALIGNMENT, 1));
+        GL_CHECK(glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data()));
+        return fnv1a(pixels);
+    }
+
+  private:
+    int m_width;
+    int m_height;
+    unsigned m_fbo = 0;
+    unsigned m_color = 0;
+    bool m_complete = false;
+};
+
+struct BenchScene {
+    std::string name;
+    vector<render::Render::layer_id> layers;
+    vector<CameraKey> path;
+};
+
+struct SceneReport {
+    vector<double> frame_ms; // sorted.
+    render::DrawStats draws;
+    size_t uploaded_bytes = 0;
+    uint64_t hash = 0;
+};
+
+// Lines of "<scene> <hash>".
+std::map<std::string, uint64_t> read_hashes(const fs::path &path) {
+    std::map<std::string, uint64_t> hashes;
+    std::ifstream is(path);
+    std::string scene, hash;
+    while (is >> scene >> hash) {
+        hashes[scene] = std::strtoull(hash.c_str(), nullptr, 16);
+    }
+    return hashes;
+}
+} // namespace
+
+// Draws scenes of render_demo along scripted camera paths into an offscreen
+// framebuffer and reports frame time percentiles, draws and uploads, so a
+// performance change can be compared against the same number before it.
+// Frame time is CPU time of the frame up to glFinish, so it includes GPU work.
+//
+// No display is needed, see OffscreenContext. With LIBGL_ALWAYS_SOFTWARE=1
+// frames are drawn by llvmpipe, which needs no GPU and gives the same pixels
+// on every run. The hash of the last frame of each scene is taken after
+// streaming has settled, --save-hashes keeps them as the reference and
+// --check-hashes fails when the pixels differ.
+//
+// Uses SHADERS_ROOT and DATA_ROOT as render_demo does.
+int main(int argc, char **argv) {
+    const auto options = parse_options(argc, argv);
+    if (!options) {
+        log_err(USAGE, argc > 0 ? argv[0] : "render_bench");
+        return -1;
+    }
+    const char *SHADERS_ROOT = std::getenv("SHADERS_ROOT");
+    if (!SHADERS_ROOT) {
+        log_err("SHADERS_ROOT env variable not set");
+        return -1;
+    }
+    const char *DATA_ROOT = std::getenv("DATA_ROOT");
+
+    auto context = OffscreenContext::create(options->context);
+    if (!context) {
+        return -1;
+    }
+    if (!gladLoadGLLoader(gl_proc_address)) {
+        log_err("Failed to initialize GLAD");
+        return -1;
+    }
+    log_debug("GL: {} | {}", reinterpret_cast<const char *>(glGetString(GL_RENDERER)),
+              reinterpret_cast<const char *>(glGetString(GL_VERSION)));
+
+    auto framebuffer = std::make_unique<Framebuffer>(options->width, options->height);
+    if (!framebuffer->complete()) {
+        log_err("offscreen framebuffer is not complete");
+        return -1;
+    }
+    auto streamer = std::make_unique<render::BufferStreamer>(
+        render::make_streaming_gl(gl_proc_address));
+    auto gpu_heap = std::make_unique<render::GpuHeap>();
+    auto frame_uniforms = std::make_unique<render::FrameUniforms>();
+    // Programs are compiled every run unless SHADERS_CACHE is set, compiling
+    // is not part of any frame.
+    auto shader_cache = std::make_unique<shader_program::ShaderCache>(
+        shader_program::make_program_gl(gl_proc_address),
+        SHADERS_ROOT, std::getenv("SHADERS_CACHE") ? std::getenv("SHADERS_CACHE") : "");
+
+    RoadsUnit roads;
+    lands::Lands lands;
+    roads_shader_aa::RoadsShaderAAUnit lands_aa;
+    if (!roads.load_shaders(*shader_cache) || !roads.make_buffers(*streamer, *gpu_heap) ||
+        !lands.load_shaders(*shader_cache) || !lands.make_buffers(*streamer, *gpu_heap) ||
+        !lands_aa.load_shaders(*shader_cache) || !lands_aa.make_buffers(*streamer, *gpu_heap)) {
+        log_err("failed initializing render units");
+        return -1;
+    }
+
+    const glm::vec2 roads_origin = lon_lat(23.0, 49.0);
+    // Fixed seed, so every run draws the same roads.
+    auto [roads_vertices, roads_indices, roads_dctx] =
+        generate_random_roads(v2(roads_origin.x, roads_origin.y), 1);
+    roads.set_indexed_data(roads_vertices, roads_indices);
+
+    DebugCtx lands_dctx;
+    auto world_lands = load_world_lands(DATA_ROOT ? DATA_ROOT : "", lands_dctx);
+    vector<uint32_t> lands_levels;
+    std::unique_ptr<LandsTileStreamer> lands_streamer;
+    std::unique_ptr<render::TileCache> lands_cache;
+    if (world_lands) {
+        if (world_lands->pack) {
+            lands_levels = pack_levels(*world_lands->pack);
+            lands_streamer = make_lands_streamer(*world_lands->pack);
+            render::TileCache::Budget budget;
+            budget.gpu_bytes = 256 * 1024 * 1024;
+            lands_cache = std::make_unique<render::TileCache>(
+                budget, [&](gg::tile_at_level_t tile) { lands.remove_tile(tile); });
+        } else {
+            lands.set_data(world_lands->vertices, world_lands->indices);
+        }
+        lands_aa.set_data(world_lands->aa_vertices, world_lands->aa_indices,
+                          world_lands->aa_batches);
+    } else {
+        log_warn("no lands in DATA_ROOT, lands scenes draw nothing");
+    }
+    streamer->end_frame();
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    auto profiler = std::make_unique<render::Profiler>(render::make_timer_gl(), options->frames);
+    auto renderer = std::make_unique<render::Render>(*profiler);
+    const auto roads_layer = renderer->add_layer("Roads", roads, 20);
+    const auto lands_layer = renderer->add_layer("Lands", lands, 30, [&](const camera::Cam2d &cam) {
+        if (lands_streamer) {
+            stream_lands_tiles(cam, *world_lands->pack, lands_levels, *lands_streamer,
+                               *lands_cache, lands);
+        }
+    });
+    const auto lands_aa_layer = renderer->add_layer("Lands AA", lands_aa, 40);
+
+    const vector<BenchScene> all_scenes = {
+        // From the whole world into Europe, then west along it.
+        {"lands",
+         {lands_layer, lands_aa_layer},
+         {{glm::vec2(gg::U32_MAX / 2, gg::U32_MAX / 2), 2e-9},
+          {lon_lat(23.0, 49.0), 6.7e-7},
+          {lon_lat(0.0, 50.0), 1.5e-6}}},
+        // Into random roads, turning.
+        {"roads",
+         {roads_layer},
+         {{roads_origin, 7.2e-7}, {roads_origin, 1.85e-4, 0.5}}},
+        // Outline of the Adriatic coast close up.
+        {"aa",
+         {lands_aa_layer},
+         {{lon_lat(12.3, 45.4), 4e-6}, {lon_lat(16.4, 43.5), 1.5e-5}, {lon_lat(19.0, 42.0), 4e-6}}},
+    };
+    vector<const BenchScene *> scenes;
+    for (auto &scene : all_scenes) {
+        scenes.push_back(&scene);
+    }
+    if (!options->scenes.empty()) {
+        scenes.clear();
+        for (auto &name : options->scenes) {
+            auto it = std::find_if(all_scenes.begin(), all_scenes.end(),
+                                   [&](const BenchScene &scene) { return scene.name == name; });
+            if (it == all_scenes.end()) {
+                log_err("unknown scene {}, expected lands, roads or aa", name);
+                return -1;
+            }
+            scenes.push_back(&*it);
+        }
+    }
+
+    const glm::vec2 window_size(options->width, options->height);
+    auto draw_frame = [&](const camera::Cam2d &cam) {
+        profiler->begin_frame();
+        frame_uniforms->update(cam);
+        GL_CHECK(glClearColor(0, 0, 0, 1));
+        GL_CHECK(glClear(GL_COLOR_BUFFER_BIT));
+        renderer->render_frame(cam);
+        streamer->end_frame();
+        GL_CHECK(glFinish());
+    };
+    auto streaming = [&] {
+        if (!lands_streamer) {
+            return false;
+        }
+        const auto stats = lands_streamer->stats();
+        return stats.queued + stats.loading > 0;
+    };
+
+    std::map<std::string, uint64_t> hashes;
+    fmt::print("{:<8}{:>8}{:>10}{:>10}{:>10}{:>10}{:>12}{:>16}{:>14}  {}\n", "scene", "frames",
+               "p50 ms", "p90 ms", "p99 ms", "max ms", "draws/frame", "vertices/frame",
+               "uploaded MB", "hash");
+    for (const BenchScene *scene : scenes) {
+        for (render::Render::layer_id id = 0; id < renderer->layers().size(); ++id) {
+            renderer->set_enabled(id, std::find(scene->layers.begin(), scene->layers.end(), id) !=
+                                          scene->layers.end());
+        }
+        for (size_t i = 0; i < options->warmup; ++i) {
+            draw_frame(camera_at(scene->path, 0, window_size));
+        }
+
+        SceneReport report;
+        render::reset_draw_stats();
+        const size_t uploaded_before = streamer->stats().bytes;
+        for (size_t i = 0; i < options->frames; ++i) {
+            const auto cam =
+                camera_at(scene->path, options->frames > 1 ? double(i) / (options->frames - 1) : 1,
+                          window_size);
+            const auto start = steady_clock::now();
+            draw_frame(cam);
+            const std::chrono::duration<double, std::milli> frame = steady_clock::now() - start;
+            report.frame_ms.push_back(frame.count());
+        }
+        report.draws = render::draw_stats();
+        report.uploaded_bytes = streamer->stats().bytes - uploaded_before;
+        std::sort(report.frame_ms.begin(), report.frame_ms.end());
+
+        // Tiles still streaming in would make the last frame differ between
+        // runs.
+        const auto last_cam = camera_at(scene->path, 1, window_size);
+        for (size_t i = 0; i < 10000 && streaming(); ++i) {
+            draw_frame(last_cam);
+        }
+        draw_frame(last_cam);
+        report.hash = framebuffer->hash();
+        hashes[scene->name] = report.hash;
+
+        const double frames = report.frame_ms.size();
+        fmt::print("{:<8}{:>8}{:>10.3f}{:>10.3f}{:>10.3f}{:>10.3f}{:>12.1f}{:>16.0f}{:>14.2f}  "
+                   "{:016x}\n",
+                   scene->name, report.frame_ms.size(), percentile(report.frame_ms, 0.5),
+                   percentile(report.frame_ms, 0.9), percentile(report.frame_ms, 0.99),
+                   report.frame_ms.back(), report.draws.draw_calls / frames,
+                   report.draws.vertices / frames, report.uploaded_bytes / 1e6, report.hash);
+    }
+
+    int res = 0;
+    if (!options->check_hashes.empty()) {
+        const auto expected = read_hashes(options->check_hashes);
+        for (auto &[scene, hash] : hashes) {
+            auto it = expected.find(scene);
+            if (it == expected.end()) {
+                log_warn("no reference hash of scene {} in {}", scene, options->check_hashes);
+            } else if (it->second != hash) {
+                log_err("scene {} differs from reference: {:016x} != {:016x}", scene, hash,
+                        it->second);
+                res = 1;
+            }
+        }
+    }
+    if (!options->save_hashes.empty()) {
+        std::ofstream os(options->save_hashes);
+        for (auto &[scene, hash] : hashes) {
+            os << fmt::format("{} {:016x}\n", scene, hash);
+        }
+        if (!os) {
+            log_err("failed writing hashes to {}", options->save_hashes);
+            res = 1;
+        }
+    }
+    if (!options->profile.empty()) {
+        std::ofstream os(options->profile);
+        options->profile.extension() == ".json" ? profiler->write_json(os)
+                                                : profiler->write_csv(os);
+        if (!os) {
+            log_err("failed writing profile to {}", options->profile);
+            res = 1;
+        }
+    }
+
+    // All own GL objects, the context must be alive.
+    renderer.reset();
+    profiler.reset();
+    lands_streamer.reset();
+    streamer.reset();
+    gpu_heap.reset();
+    shader_cache.reset();
+    frame_uniforms.reset();
+    framebuffer.reset();
+    return res;
+}
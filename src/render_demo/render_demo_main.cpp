@@ -9,6 +9,7 @@
 #include <glm/gtx/transform.hpp>
 
 #include "common/os.h"
+#include "common/output_writer.h"
 
 #include <algorithm>
 #include <cstdlib>
@@ -23,9 +24,18 @@
 #include "common/log.h"
 #include "gg/gg.h"
 #include "glfw_helpers.h"
+#include "scenes.h"
+#include "render_lib/buffer_streamer.h"
 #include "render_lib/camera.h"
 #include "render_lib/camera_control.h"
 #include "render_lib/camera_control_visuals.h"
+#include "render_lib/frame_uniforms.h"
+#include "render_lib/gl_state.h"
+#include "render_lib/gpu_heap.h"
+#include "render_lib/profiler.h"
+#include "render_lib/render.h"
+#include "render_lib/tile_cache.h"
+#include "render_lib/tile_streamer.h"
 #include "render_units/animatable_line/animatable_line.h"
 #include "render_units/crosshair/crosshair_unit.h"
 #include "render_units/lands/lands.h"
@@ -33,20 +43,19 @@
 #include "render_units/roads/roads_unit.h"
 #include "render_units/roads/tesselation.h"
 #include "render_units/roads_shader_aa/make_geometry.h"
+#include "render_units/roads_shader_aa/packed_vertex.h"
 #include "render_units/roads_shader_aa/roads_shader_aa_unit.h"
 #include "render_units/triangle/render_triangle.h"
 #include <type_traits>
 
 #include "render_lib/debug_ctx.h"
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
-#include <mapbox/earcut.hpp>
-
-#include <map_compiler_lib.h>
+#include <tile_pack.h>
 #include <render_lib/animations.h>
 
 using camera::Cam2d;
@@ -85,6 +94,18 @@ void update_fps_counter(GLFWwindow *window, float alternativeFps) {
     frame_count++;
 }
 
+// Stats of all profiler scopes to <temp>/gg_profile.{csv,json}.
+void save_profile(const render::Profiler &profiler, bool json) {
+    const auto path = fs::temp_directory_path() / (json ? "gg_profile.json" : "gg_profile.csv");
+    std::ofstream os(path);
+    json ? profiler.write_json(os) : profiler.write_csv(os);
+    if (!os) {
+        log_warn("failed writing profile to {}", path);
+        return;
+    }
+    log_debug("profile saved to {}", path);
+}
+
 void process_input(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
@@ -120,128 +141,6 @@ void print_coords_debug_info(const Cam2d &cam, double cx, double cy) {
     log_debug("Click: {},{} (x: {}, y:{})", lat, lon, x, y);
 }
 
-// Returns {vertices, indices, aa_vertices, aa_indices} for lands.
-std::optional<
-    std::tuple<vector<p32>, vector<uint32_t>, vector<roads_shader_aa::AAVertex>, vector<uint32_t>>>
-generate_lands_quads(std::string data_root_str, DebugCtx &dctx) {
-    vector<p32> vertices;
-    vector<uint32_t> indices;
-    vector<roads_shader_aa::AAVertex> aa_vertices(50'000'000);
-    vector<uint32_t> aa_indices(50'000'000);
-    size_t current_aa_vertices_offset = 0;
-    size_t current_aa_indiices_offset = 0;
-
-    std::chrono::steady_clock::duration total_earcut_time{0};
-    std::chrono::steady_clock::duration total_aa_time{0};
-
-    try {
-        auto lands_path =
-            fs::path(data_root_str) / "natural_earth" / "ne_10m_land" / "ne_10m_land.shp";
-
-        for (auto &shape : map_compiler::load_shapes(lands_path)) {
-            int parn_n = 0;
-            for (auto &part : shape) {
-                assert(part.front() == part.back());
-
-                // Convert part vertices into mapbox::earcut format which
-                // expects polygin defined as vector of vectors which means
-                // main polygon and holes.
-                auto start_time = std::chrono::steady_clock::now();
-                vector<vector<array<double, 2>>> earcut_polygon;
-                earcut_polygon.push_back({});
-                bool first = true;
-                const size_t M = vertices.size();
-                for (gg::gpt_t &pt : part) {
-                    earcut_polygon.back().push_back(
-                        {static_cast<double>(pt.x), static_cast<double>(pt.y)});
-                    vertices.emplace_back(pt);
-                }
-                for (auto idx : mapbox::earcut(earcut_polygon)) {
-                    indices.push_back(idx + M);
-                }
-                total_earcut_time += std::chrono::steady_clock::now() - start_time;
-
-                auto aa_start_time = std::chrono::steady_clock::now();
-                assert(indices.size() % 3 == 0);
-
-                { // debug
-                    auto pen = dctx.make_pen();
-                    auto it = std::begin(vertices) + M;
-                    pen.move_to(*it++);
-                    int k = 0;
-                    for (; it != std::end(vertices); ++it) {
-                        vector<Color> colors({colors::red, colors::green, colors::blue});
-                        auto c = colors[parn_n % colors.size()];
-                        c.r *= k / (double)M;
-                        c.g *= k / (double)M;
-                        c.b *= k / (double)M;
-                        pen.line_to(*it, c);
-                        k++;
-                    }
-                }
-                auto [aa_vertices_generated, aa_indices_generated] = roads_shader_aa::make_geometry(
-                    span(std::begin(vertices) + M, std::end(vertices)), 1.0, aa_vertices,
-                    current_aa_vertices_offset, aa_indices, current_aa_indiices_offset, dctx);
-
-                { // debug
-                    for (size_t i = current_aa_indiices_offset + 2;
-                         i < current_aa_indiices_offset + aa_indices_generated; ++i) {
-                        auto a = aa_vertices[aa_indices[i - 2]].coords;
-                        auto b = aa_vertices[aa_indices[i - 1]].coords;
-                        auto c = aa_vertices[aa_indices[i]].coords;
-
-                        vector<Color> colors({colors::red, colors::green, colors::blue});
-                        // dctx.add_line(a, b, colors[parn_n % colors.size()]);
-                        // dctx.add_line(b, c, colors[parn_n % colors.size()]);
-                        // dctx.add_line(c, a, colors[parn_n % colors.size()]);
-
-                        auto a_u = std::make_tuple(gg::mercator::unproject_lon(gg::x_to_lon(a.x)),
-                                                   gg::mercator::unproject_lat(gg::y_to_lat(a.y)));
-
-                        auto b_u = std::make_tuple(gg::mercator::unproject_lon(gg::x_to_lon(b.x)),
-                                                   gg::mercator::unproject_lat(gg::y_to_lat(b.y)));
-
-                        auto c_u = std::make_tuple(gg::mercator::unproject_lon(gg::x_to_lon(c.x)),
-                                                   gg::mercator::unproject_lat(gg::y_to_lat(c.y)));
-                    }
-                } // debug scope
-
-                current_aa_vertices_offset += aa_vertices_generated;
-                current_aa_indiices_offset += aa_indices_generated;
-
-                total_aa_time += std::chrono::steady_clock::now() - aa_start_time;
-                parn_n++;
-            } // parts
-
-        } // shapes
-    } catch (const std::exception &e) {
-        log_err("failed compiling lands: {}", e.what());
-        return std::nullopt;
-    }
-    log_debug("Lands Triangulation time: {}ms",
-              std::chrono::duration_cast<std::chrono::milliseconds>(total_earcut_time).count());
-    log_debug("Lands AA time: {}ms",
-              std::chrono::duration_cast<std::chrono::milliseconds>(total_aa_time).count());
-
-    if (current_aa_vertices_offset == aa_vertices.size()) {
-        log_warn("Lends: aa vertices truncated");
-    }
-    if (current_aa_indiices_offset == aa_indices.size()) {
-        log_warn("Lands: aa indices truncated");
-    }
-    aa_vertices.resize(current_aa_vertices_offset);
-    aa_indices.resize(current_aa_indiices_offset);
-
-    for (auto &v : aa_vertices) {
-        v.color[0] = 0.53;
-        v.color[1] = 0.54;
-        v.color[2] = 0.55;
-    }
-
-    return std::tuple{std::move(vertices), std::move(indices), std::move(aa_vertices),
-                      std::move(aa_indices)};
-}
-
 // Trying to reproduce a bug found during AA'ing lands.
 std::tuple<vector<roads_shader_aa::AAVertex>, vector<uint32_t>> generate_bug_scene() {
     vector<p32> points({p32(1596476416, 2683028992), p32(1699909504, 2703048448),
@@ -254,40 +153,21 @@ std::tuple<vector<roads_shader_aa::AAVertex>, vector<uint32_t>> generate_bug_sce
         p.y += gg::U32_MAX / 24;
     });
 
-    vector<roads_shader_aa::AAVertex> vertices(1'000'000);
-    vector<uint32_t> indices(1'000'000);
+    const auto capacity = roads_shader_aa::required_capacity(points);
+    vector<roads_shader_aa::AAVertex> vertices(capacity.vertices * 2);
+    vector<uint32_t> indices(capacity.indices * 2);
+    OutputWriter<roads_shader_aa::AAVertex> vertices_writer(vertices);
+    OutputWriter<uint32_t> indices_writer(indices);
 
     DebugCtx ctx;
-    size_t vertices_offset = 0;
-    size_t indicies_offset = 0;
-    auto [verices_num1, indices_num1] = roads_shader_aa::make_geometry(
-        points, 15, vertices, vertices_offset, indices, indicies_offset, ctx);
-    vertices_offset += verices_num1;
-    indicies_offset += indices_num1;
-
-    auto [verices_num2, indices_num2] = roads_shader_aa::make_geometry(
-        shifted_points, 15, vertices, vertices_offset, indices, indicies_offset, ctx);
-
-    vertices_offset += verices_num2;
-    indicies_offset += indices_num2;
-
-    vertices.resize(vertices_offset);
-    indices.resize(indicies_offset);
-
-    for (auto &v : vertices) {
-        v.color[0] = 0.83;
-        v.color[1] = 0.54;
-        v.color[2] = 0.55;
-    }
+    roads_shader_aa::make_geometry(points, 15, vertices_writer, indices_writer, ctx);
+    roads_shader_aa::make_geometry(shifted_points, 15, vertices_writer, indices_writer, ctx);
 
     return tuple{std::move(vertices), std::move(indices)};
 }
 
 std::tuple<vector<roads_shader_aa::AAVertex>, vector<uint32_t>, vector<p32>, DebugCtx>
 generate_test_scene2(v2 scene_origin, float zoom) {
-    vector<p32> all_roads_triangles(10'000'000); // todo: calculate size correctly
-    vector<roads_shader_aa::AAVertex> all_roads_aa_triangles(10'000'000);
-
     double scale = 1000;
     auto p1 = scene_origin;
     auto p2 = p1 + v2(10, 10) * scale;
@@ -295,28 +175,25 @@ generate_test_scene2(v2 scene_origin, float zoom) {
     auto p4 = p3 + v2(0, 20) * scale;
     vector<p32> road_one{from_v2(p1), from_v2(p2), from_v2(p3), from_v2(p4)};
 
-    const size_t vertex_count = (road_one.size() - 1) * 12;
-    span<p32> road_one_span(all_roads_triangles.data(), vertex_count);
-    vector<p32> outline(road_one.size() * 2);
+    using roads::tesselation::FirstPassSettings;
+    const auto capacity = roads::tesselation::required_capacity<FirstPassSettings>(road_one);
+    vector<p32> all_roads_triangles(capacity.triangles_vertices);
+    OutputWriter<p32> triangles_writer(all_roads_triangles);
+    vector<p32> outline(capacity.outline_points);
 
     DebugCtx ctx;
 
-    roads::tesselation::generate_geometry<roads::tesselation::FirstPassSettings>(
-        road_one, road_one_span, outline, 2000.0, ctx);
-    all_roads_triangles.resize(vertex_count);
+    roads::tesselation::generate_geometry<FirstPassSettings>(road_one, triangles_writer, outline,
+                                                             2000.0, ctx);
 
-    vector<roads_shader_aa::AAVertex> all_vertices(1000'000);
-    vector<uint32_t> all_indices(1000'000);
+    const auto aa_capacity = roads_shader_aa::required_capacity(outline);
+    vector<roads_shader_aa::AAVertex> all_vertices(aa_capacity.vertices);
+    vector<uint32_t> all_indices(aa_capacity.indices);
+    OutputWriter<roads_shader_aa::AAVertex> vertices_writer(all_vertices);
+    OutputWriter<uint32_t> indices_writer(all_indices);
 
     auto [verices_num, indices_num] =
-        roads_shader_aa::make_geometry(outline, 1.5, all_vertices, 0, all_indices, 0, ctx);
-    all_vertices.resize(verices_num);
-    all_indices.resize(indices_num);
-    for (auto &v : all_vertices) {
-        v.color[0] = 0.83;
-        v.color[1] = 0.54;
-        v.color[2] = 0.55;
-    }
+        roads_shader_aa::make_geometry(outline, 1.5, vertices_writer, indices_writer, ctx);
 
     log_debug("vertices number: {}", verices_num);
     log_debug("indices number: {}", indices_num);
@@ -339,9 +216,6 @@ generate_test_scene2(v2 scene_origin, float zoom) {
 
 std::tuple<vector<p32>, vector<ColoredVertex>, DebugCtx> generate_test_scene(v2 scene_origin) {
 
-    vector<p32> all_roads_triangles(10'000'000); // todo: calculate size correctly
-    vector<p32> all_roads_aa_triangles(10'000'000);
-
     double scale = 1000;
     auto p1 = scene_origin;
     auto p2 = p1 + v2(10, 10) * scale;
@@ -349,21 +223,25 @@ std::tuple<vector<p32>, vector<ColoredVertex>, DebugCtx> generate_test_scene(v2
     auto p4 = p3 + v2(0, 20) * scale;
     vector<p32> road_one{from_v2(p1), from_v2(p2), from_v2(p3), from_v2(p4)};
 
-    const size_t vertex_count = (road_one.size() - 1) * 12;
-    span<p32> road_one_span(all_roads_triangles.data(), vertex_count);
-    vector<p32> outline(road_one.size() * 2);
+    using roads::tesselation::AAPassSettings;
+    using roads::tesselation::FirstPassSettings;
+    const auto capacity = roads::tesselation::required_capacity<FirstPassSettings>(road_one);
+    vector<p32> all_roads_triangles(capacity.triangles_vertices);
+    OutputWriter<p32> triangles_writer(all_roads_triangles);
+    vector<p32> outline(capacity.outline_points);
 
     DebugCtx ctx;
 
-    roads::tesselation::generate_geometry<roads::tesselation::FirstPassSettings>(
-        road_one, road_one_span, outline, 2000.0, ctx);
+    roads::tesselation::generate_geometry<FirstPassSettings>(road_one, triangles_writer, outline,
+                                                             2000.0, ctx);
 
-    const size_t aa_vertex_count = (outline.size() - 1) * 12;
-    span<p32> aa_data_span(all_roads_aa_triangles.data(), aa_vertex_count);
+    const auto aa_capacity = roads::tesselation::required_capacity<AAPassSettings>(outline);
+    vector<p32> all_roads_aa_triangles(aa_capacity.triangles_vertices);
+    OutputWriter<p32> aa_triangles_writer(all_roads_aa_triangles);
 
     vector<p32> no_outline_for_aa_pass; // just fake placeholder.
-    roads::tesselation::generate_geometry<roads::tesselation::AAPassSettings>(
-        outline, aa_data_span, no_outline_for_aa_pass, 100,
+    roads::tesselation::generate_geometry<AAPassSettings>(
+        outline, aa_triangles_writer, no_outline_for_aa_pass, 100,
         ctx); // in world coordiantes try smth like 200.0
 
     // Given a road polyline, we need to generate vertices and
@@ -389,10 +267,7 @@ std::tuple<vector<p32>, vector<ColoredVertex>, DebugCtx> generate_test_scene(v2
     //  indices.push_back(index(v2))
     //  indices.push_back(index(v1))
 
-    all_roads_triangles.resize(vertex_count);
-    all_roads_aa_triangles.resize(aa_vertex_count);
-
-    vector<ColoredVertex> aa_data(aa_vertex_count);
+    vector<ColoredVertex> aa_data(all_roads_aa_triangles.size());
     const auto COLOR = Color{0.53, 0.54, 0.55, 1.0};
     const auto NOCOLOR = Color{1.0f, 1.0f, 1.0f, 1.0f}; // color of glClearCOLOR
     const vector<Color> AA_VERTEX_COLORS_PATTERN = {COLOR, NOCOLOR, NOCOLOR, NOCOLOR, COLOR, COLOR};
@@ -405,86 +280,6 @@ std::tuple<vector<p32>, vector<ColoredVertex>, DebugCtx> generate_test_scene(v2
     return std::tuple{all_roads_triangles, aa_data, ctx};
 }
 
-std::tuple<vector<p32>, DebugCtx> generate_random_roads(v2 scene_origin, float cam_zoom) {
-    DebugCtx dctx;
-
-    //
-    // Generate random polylines
-    //
-    const double k = 100.0;
-
-    vector<p32> all_roads_triangles(100'000'00); // todo: calculate size correctly
-    vector<p32> all_roads_aa_triangles(100'000'00);
-    size_t current_offset = 0;
-    size_t current_aa_offset = 0;
-
-    srand(clock());
-
-    std::chrono::steady_clock::duration tesselation_time;
-
-    for (int i = 0; i < 500; ++i) {
-        int random_segments_count = rand() % 30 + 30;
-        double random_vector_angle = ((rand() % 360) / 360.0) * 2 * M_PI;
-        const int scater = 60000;
-        v2 origin =
-            scene_origin + (v2(rand() % scater - (scater / 2), rand() % scater - (scater / 2)));
-        v2 prev_p = origin;
-
-        vector<p32> random_polyline = {from_v2(prev_p)};
-        for (int s = 0; s < random_segments_count; s++) {
-            double random_length = (double)(rand() % 100000 + 10000);
-            double random_angle_val = (rand() % 5 + 5);
-            if (rand() % 2 == 1) {
-                random_angle_val *= -1;
-            }
-            double random_angle = random_vector_angle + (random_angle_val / 360.0) * 2 * M_PI;
-            auto random_direction = normalized(v2(std::cos(random_angle), std::sin(random_angle)));
-            random_vector_angle = random_angle;
-            // log_debug("random_length: {}", random_length);
-            // log_debug("random_angle: {} ({})", random_angle,
-            //(random_angle / M_PI) * 180.0);
-
-            v2 p = prev_p + random_direction * random_length;
-
-            if (p.x < 0.0 || p.y < 0.0) {
-                log_warn("out of canvas. truncate road");
-                break;
-            }
-            // dctx.add_line(prev_p, p, colors::grey);
-            prev_p = p;
-
-            random_polyline.push_back(from_v2(p));
-        }
-        if (random_polyline.size() < 3) {
-            log_warn("two small road, skip");
-            continue;
-        }
-
-        const size_t one_road_triangles_vertex_count = (random_polyline.size() - 1) * 12;
-        span<p32> random_road_triangles_span(all_roads_triangles.data() + current_offset,
-                                             one_road_triangles_vertex_count);
-
-        current_offset += one_road_triangles_vertex_count;
-
-        vector<p32> outline_output(random_polyline.size() *
-                                   2); // outline must be have two lines per one segment.
-
-        auto tesselation_start_time = std::chrono::steady_clock::now();
-
-        roads::tesselation::generate_geometry<roads::tesselation::FirstPassSettings>(
-            random_polyline, random_road_triangles_span, outline_output, 2000.0, dctx);
-
-        tesselation_time += (std::chrono::steady_clock::now() - tesselation_start_time);
-    }
-
-    auto tesselation_time_ms =
-        std::chrono::duration_cast<std::chrono::milliseconds>(tesselation_time).count();
-    log_debug("Tesselation time: {}ms", tesselation_time_ms);
-
-    all_roads_triangles.resize(current_offset);
-    return std::tuple{all_roads_triangles, dctx};
-}
-
 struct Scene {
     Scene(
         std::string label, std::function<void()> on_activate = [] {},
@@ -503,14 +298,7 @@ struct Scene {
 };
 
 struct GuiState {
-    bool show_debug_lines = true;
-    bool show_world_bb = true;
-    bool show_lands = true;
-    bool show_lands_aa = true;
     bool camera_demo = false;
-    bool show_debug_scene = true;
-    bool show_roads = false;
-    bool show_animatable_line = false;
     float clear_color[4] = {0.0, 0.0, 0.0, 1.0};
     vector<Scene> scenes;
     const Scene *scene_selected = nullptr;
@@ -538,14 +326,7 @@ template <class ScenesUICb> void renderGui(GuiState &state, ScenesUICb &&scenes_
     }
 
     ImGui::ColorEdit4("Clear color", state.clear_color);
-    ImGui::Checkbox("Show debug lines", &state.show_debug_lines);
-    ImGui::Checkbox("Show world BB", &state.show_world_bb);
-    ImGui::Checkbox("Show Lands", &state.show_lands);
-    ImGui::Checkbox("Show Lands AA", &state.show_lands_aa);
     ImGui::Checkbox("Camera Demo", &state.camera_demo);
-    ImGui::Checkbox("Show Debug Scene", &state.show_debug_scene);
-    ImGui::Checkbox("Show Roads", &state.show_roads);
-    ImGui::Checkbox("Show Animatable Line", &state.show_animatable_line);
 
     scenes_ui_cb();
 
@@ -553,24 +334,15 @@ template <class ScenesUICb> void renderGui(GuiState &state, ScenesUICb &&scenes_
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
-using world_lands_scene_data_type =
-    std::tuple<vector<p32>, vector<uint32_t>, vector<roads_shader_aa::AAVertex>, vector<uint32_t>>;
-
-void loadWorldLandsScene(std::optional<world_lands_scene_data_type> &world_lands_scene_data,
+void loadWorldLandsScene(std::optional<WorldLandsSceneData> &world_lands_scene_data,
                          std::mutex &scene_mutex, DebugCtx &lands_dctx) {
     const auto DATA_ROOT_env = std::getenv("DATA_ROOT");
     if (!DATA_ROOT_env) {
         log_warn("No DATA_ROOT env var specified");
     }
     const auto data_root = std::string(DATA_ROOT_env ? DATA_ROOT_env : "");
-    auto maybe_lands = generate_lands_quads(data_root, lands_dctx);
-    if (maybe_lands) {
-        auto& [lands_points, lands_indices, aa_vertices, aa_indices] = *maybe_lands;
-        log_debug("lands points: {}", lands_points.size());
-        log_debug("lands indices: {}", lands_indices.size());
-        log_debug("lands aa points: {}", aa_vertices.size());
-        log_debug("lands aa indidices: {}", aa_indices.size());
 
+    if (auto maybe_lands = load_world_lands(data_root, lands_dctx)) {
         auto lock = std::unique_lock(scene_mutex);
         world_lands_scene_data = std::move(maybe_lands);
     } else {
@@ -662,6 +434,22 @@ int main() {
     glfwSwapInterval(0); // vsync
     glfwShowWindow(window);
 
+    // All render units upload their data through streamer into ranges of
+    // the heap.
+    auto streamer = std::make_unique<render::BufferStreamer>(
+        render::make_streaming_gl((void *(*)(const char *))glfwGetProcAddress));
+    auto gpu_heap = std::make_unique<render::GpuHeap>();
+    // Units share programs of the same sources, linked programs are saved
+    // for the next start.
+    const fs::path SHADERS_CACHE = std::getenv("SHADERS_CACHE")
+                                       ? fs::path(std::getenv("SHADERS_CACHE"))
+                                       : fs::temp_directory_path() / "gg_shaders_cache";
+    // Camera of the frame for all programs.
+    auto frame_uniforms = std::make_unique<render::FrameUniforms>();
+    auto shader_cache = std::make_unique<shader_program::ShaderCache>(
+        shader_program::make_program_gl((void *(*)(const char *))glfwGetProcAddress), SHADERS_ROOT,
+        SHADERS_CACHE);
+
     // Setup Platform/Renderer bindings
     ImGui_ImplGlfw_InitForOpenGL(window, true);
     ImGui_ImplOpenGL3_Init(NULL);
@@ -669,20 +457,20 @@ int main() {
     ImGui::StyleColorsLight();
 
     CrosshairUnit crosshair;
-    if (!crosshair.load_shaders(SHADERS_ROOT)) {
+    if (!crosshair.load_shaders(*shader_cache)) {
         log_err("failed loading crosshair shaders");
         return -1;
     }
 
     TriangleUnit triangle;
-    if (!triangle.load_shaders(SHADERS_ROOT)) {
+    if (!triangle.load_shaders(*shader_cache)) {
         log_err("failed loading triangle shaders");
         return -1;
     }
     triangle.upload_geometry();
 
     CameraControlVisuals cam_control_vis;
-    if (!cam_control_vis.init_render(SHADERS_ROOT)) {
+    if (!cam_control_vis.init_render(*shader_cache)) {
         glfwTerminate();
         return -1;
     }
@@ -695,40 +483,44 @@ int main() {
     // Roads
     //
     RoadsUnit roads;
-    if (!roads.load_shaders(SHADERS_ROOT)) {
+    if (!roads.load_shaders(*shader_cache)) {
         log_err("failed loading shaders for roads");
         return -1;
     }
-    if (!roads.make_buffers()) {
+    if (!roads.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed creating buffers for roads");
         return -1;
     }
     roads_shader_aa::RoadsShaderAAUnit roads_shaders_aa;
-    if (!roads_shaders_aa.load_shaders(SHADERS_ROOT)) {
+    if (!roads_shaders_aa.load_shaders(*shader_cache)) {
         log_err("failed loading shaders for roads_shaders_aa");
         return -1;
     }
-    if (!roads_shaders_aa.make_buffers()) {
+    if (!roads_shaders_aa.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed creating buffers roads_shaders_aa");
         return -1;
     }
-    auto [roads_data, dctx] = generate_random_roads(RANDOM_ROADS_SCENE_POSITION, cam.zoom);
-    roads.set_data(roads_data);
+    auto [roads_vertices, roads_indices, dctx] =
+        generate_random_roads(RANDOM_ROADS_SCENE_POSITION, clock());
+    roads.set_indexed_data(roads_vertices, roads_indices);
 
     //
     // Debug Scene
     //
     roads_shader_aa::RoadsShaderAAUnit debug_scene;
-    if (!debug_scene.load_shaders(SHADERS_ROOT)) {
+    if (!debug_scene.load_shaders(*shader_cache)) {
         log_err("failed loading shaders for debug_scene");
         return -1;
     }
-    if (!debug_scene.make_buffers()) {
+    if (!debug_scene.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed creating buffers debug_scene");
         return -1;
     }
     auto [vertices, indices] = generate_bug_scene();
-    debug_scene.set_data(vertices, indices);
+    auto bug_scene_mesh = roads_shader_aa::pack_aa_mesh(vertices, indices, 4);
+    debug_scene.set_data(bug_scene_mesh.vertices, bug_scene_mesh.indices, bug_scene_mesh.batches);
+    const Color bug_scene_palette[] = {Color{0.83, 0.54, 0.55}};
+    debug_scene.set_palette(bug_scene_palette);
 
     //
     // Lands
@@ -737,39 +529,46 @@ int main() {
     lands::Lands lands;
     // todo: refactor to call it polyline_aa.
     roads_shader_aa::RoadsShaderAAUnit lands_aa;
-    if (!lands_aa.load_shaders(SHADERS_ROOT)) {
+    if (!lands_aa.load_shaders(*shader_cache)) {
         log_err("failed loading shaders for lands_aa");
         return -1;
     }
-    if (!lands_aa.make_buffers()) {
+    if (!lands_aa.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed creating buffers lands_aa");
         return -1;
     }
 
-    if (!lands.load_shaders(SHADERS_ROOT)) {
+    if (!lands.load_shaders(*shader_cache)) {
         log_err("failed loading lands shaders");
         return -1;
     }
-    if (!lands.make_buffers()) {
+    if (!lands.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed making lands buffers");
         return -1;
     }
 
     std::mutex scene_mutex;
-    std::optional<world_lands_scene_data_type> world_lands_scene_data;
+    std::optional<WorldLandsSceneData> world_lands_scene_data;
+    // Tiled lands are streamed from pack, storage keeps it alive.
+    std::shared_ptr<void> lands_storage;
+    const map_compiler::tile_pack::TilePack *lands_pack = nullptr;
+    vector<uint32_t> lands_pack_levels; // ascending
+    std::unique_ptr<LandsTileStreamer> lands_streamer;
+    std::unique_ptr<render::TileCache> lands_cache;
+    int lands_cache_mb = 256;
 
     std::thread worldLandsSceneLoader(
         [&] { loadWorldLandsScene(world_lands_scene_data, scene_mutex, lands_dctx); });
 
     LinesUnit road_dbg_lines;
-    if (!road_dbg_lines.load_shaders(SHADERS_ROOT)) {
+    if (!road_dbg_lines.load_shaders(*shader_cache)) {
         log_err("failed initializing renderer for road_dbg_lines");
         glfwTerminate();
         return -1;
     }
 
     LinesUnit world_frame_lines;
-    if (!world_frame_lines.load_shaders(SHADERS_ROOT)) {
+    if (!world_frame_lines.load_shaders(*shader_cache)) {
         log_err("failed loading lines unit shaders for world frame");
         return -1;
     }
@@ -787,11 +586,11 @@ int main() {
     //
 
     animatable_line::AnimatableLine animatable_line;
-    if (!animatable_line.load_shaders(SHADERS_ROOT)) {
+    if (!animatable_line.load_shaders(*shader_cache)) {
         log_err("failed laoding animatable_line shaders");
         return -1;
     }
-    if (!animatable_line.make_buffers()) {
+    if (!animatable_line.make_buffers(*streamer, *gpu_heap)) {
         log_err("failed making animatable_line buffers");
         return -1;
     }
@@ -819,29 +618,51 @@ int main() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
+    // Layers back to front, ids are captured by scenes.
+    auto profiler = std::make_unique<render::Profiler>(render::make_timer_gl());
+    auto renderer = std::make_unique<render::Render>(*profiler);
+    renderer->add_layer("Triangle", triangle, 0);
+    const auto debug_lines_layer = renderer->add_layer("Debug lines", road_dbg_lines, 10);
+    const auto roads_layer = renderer->add_layer("Roads", roads, 20);
+    renderer->set_enabled(roads_layer, false);
+    const auto lands_layer = renderer->add_layer("Lands", lands, 30, [&](const camera::Cam2d &cam) {
+        if (lands_streamer) {
+            stream_lands_tiles(cam, *lands_pack, lands_pack_levels, *lands_streamer, *lands_cache,
+                               lands);
+        }
+    });
+    // Same program, scenes show one of them.
+    const auto lands_aa_layer = renderer->add_layer("Lands AA", lands_aa, 40);
+    const auto debug_scene_layer = renderer->add_layer("Debug scene", debug_scene, 40);
+    const auto world_bb_layer = renderer->add_layer("World BB", world_frame_lines, 50);
+    const auto animatable_line_layer = renderer->add_layer("Animatable line", animatable_line, 60);
+    renderer->set_enabled(animatable_line_layer, false);
+    const auto crosshair_layer = renderer->add_layer("Crosshair", crosshair, 100);
+    const auto gui_scope = profiler->add_scope("GUI");
+
     GuiState state;
 
     // Add scenes
     state.scenes.emplace_back("Random Roads", [&] {
         log_debug("Camera goes to random roads scene...");
-        state.show_lands = false;
-        state.show_lands_aa = false;
-        state.show_debug_scene = false;
-        state.show_world_bb = false;
-        state.show_debug_lines = false;
-        state.show_roads = true;
+        renderer->set_enabled(lands_layer, false);
+        renderer->set_enabled(lands_aa_layer, false);
+        renderer->set_enabled(debug_scene_layer, false);
+        renderer->set_enabled(world_bb_layer, false);
+        renderer->set_enabled(debug_lines_layer, false);
+        renderer->set_enabled(roads_layer, true);
         cam.focus_pos = glm::vec2(2421879040, 2732077056);
         animations_engine.animate(&cam.zoom, 0.000185, 1s,
                                   []() { log_debug("Camera goes to random roads scene... DONE"); });
     });
     state.scenes.emplace_back("Animatable line", [&] {
-        state.show_lands = false;
-        state.show_lands_aa = false;
-        state.show_debug_scene = false;
-        state.show_world_bb = false;
-        state.show_debug_lines = false;
-        state.show_roads = false;
-        state.show_animatable_line = true;
+        renderer->set_enabled(lands_layer, false);
+        renderer->set_enabled(lands_aa_layer, false);
+        renderer->set_enabled(debug_scene_layer, false);
+        renderer->set_enabled(world_bb_layer, false);
+        renderer->set_enabled(debug_lines_layer, false);
+        renderer->set_enabled(roads_layer, false);
+        renderer->set_enabled(animatable_line_layer, true);
         auto center = v2(al_vertices[0].coords) +
                       (v2(al_vertices[2].coords) - v2(al_vertices[0].coords)) / 2.0;
         cam.focus_pos = glm::vec2(center.x, center.y);
@@ -855,10 +676,22 @@ int main() {
             // Check for loaded scene
             auto lock = std::unique_lock(scene_mutex);
             if (world_lands_scene_data) {
-                auto &[lands_points, lands_indices, aa_vertices, aa_indices] =
-                    *world_lands_scene_data;
-                lands.set_data(lands_points, lands_indices);
-                lands_aa.set_data(aa_vertices, aa_indices);
+                if (world_lands_scene_data->pack) {
+                    lands_storage = world_lands_scene_data->storage;
+                    lands_pack = world_lands_scene_data->pack;
+                    lands_pack_levels = pack_levels(*lands_pack);
+                    lands_streamer = make_lands_streamer(*lands_pack);
+                    render::TileCache::Budget budget;
+                    budget.gpu_bytes = size_t(lands_cache_mb) * 1024 * 1024;
+                    lands_cache = std::make_unique<render::TileCache>(
+                        budget, [&](gg::tile_at_level_t tile) { lands.remove_tile(tile); });
+                } else {
+                    lands.set_data(world_lands_scene_data->vertices,
+                                   world_lands_scene_data->indices);
+                }
+                lands_aa.set_data(world_lands_scene_data->aa_vertices,
+                                  world_lands_scene_data->aa_indices,
+                                  world_lands_scene_data->aa_batches);
                 world_lands_scene_data.reset();
 
                 log_debug("There are {} debug lines for LANDS", lands_dctx.lines.size());
@@ -881,11 +714,11 @@ int main() {
 
                 state.scenes.emplace_back("World Lands", [&] {
                     log_debug("Camera goes to World Lands scene...");
-                    state.show_roads = false;
-                    state.show_debug_scene = false;
-                    state.show_world_bb = false;
-                    state.show_lands = true;
-                    state.show_lands_aa = true;
+                    renderer->set_enabled(roads_layer, false);
+                    renderer->set_enabled(debug_scene_layer, false);
+                    renderer->set_enabled(world_bb_layer, false);
+                    renderer->set_enabled(lands_layer, true);
+                    renderer->set_enabled(lands_aa_layer, true);
                     cam.zoom = 1.9830403292225845e-09;
                     cam.focus_pos = glm::vec2(gg::U32_MAX / 2, gg::U32_MAX / 2);
                     animations_engine.animate(&cam.zoom, 6.742621227902704e-07, 1s, []() {
@@ -921,50 +754,63 @@ int main() {
             }
         };
 
-        triangle.render_frame(cam);
+        profiler->begin_frame();
+        frame_uniforms->update(cam);
+        renderer->set_enabled(crosshair_layer, g_show_crosshair);
+        renderer->render_frame(cam);
         cam_control_vis.render(cam, cam_control);
+        const render::BindStats binds = render::bind_stats();
+        render::reset_bind_stats();
 
-        if (state.show_debug_lines) {
-            road_dbg_lines.render_frame(cam);
-        }
-
-        if (state.show_roads) {
-            roads.render_frame(cam);
-        }
-
-        if (state.show_lands) {
-            lands.render_frame(cam);
-        }
-
-        if (state.show_lands_aa) {
-            lands_aa.render_frame(cam);
-        }
-
-        if (state.show_world_bb) {
-            world_frame_lines.render_frame(cam);
-        }
-
-        if (state.show_debug_scene) {
-            debug_scene.render_frame(cam);
-        }
-
-        if (state.show_animatable_line) {
-            animatable_line.render_frame(cam);
-        }
-
-        if (g_show_crosshair) {
-            crosshair.render_frame(cam);
-        }
-
+        profiler->begin(gui_scope);
         renderGui(state, [&] {
-            if (state.show_animatable_line) {
+            renderer->render_gui();
+            if (renderer->enabled(animatable_line_layer)) {
                 animatable_line.render_gui();
             }
 
             cam_control.render_gui();
+            if (renderer->enabled(lands_layer)) {
+                ImGui::Text("Lands tiles drawn: %zu", lands.tiles_drawn());
+            }
+            if (lands_streamer) {
+                const auto stats = lands_streamer->stats();
+                ImGui::Text("Lands tiles: %zu uploaded, %zu queued, %zu loading",
+                            lands.tiles_count(), stats.queued, stats.loading);
+                const auto &cache_stats = lands_cache->stats();
+                ImGui::Text("Lands cache: %.1f MB, %zu hits, %zu misses, %zu evicted",
+                            cache_stats.gpu_bytes / 1e6, cache_stats.hits, cache_stats.misses,
+                            cache_stats.evictions);
+                if (ImGui::SliderInt("Lands cache MB", &lands_cache_mb, 16, 1024)) {
+                    auto budget = lands_cache->budget();
+                    budget.gpu_bytes = size_t(lands_cache_mb) * 1024 * 1024;
+                    lands_cache->set_budget(budget);
+                }
+            }
+            ImGui::Text("Binds: %zu programs, %zu vaos, %zu skipped", binds.program_binds,
+                        binds.vao_binds, binds.program_skips + binds.vao_skips);
+            const auto &shader_stats = shader_cache->stats();
+            ImGui::Text("Shaders: %zu programs, %zu compiled, %zu from binaries",
+                        shader_stats.programs, shader_stats.compiled, shader_stats.loaded);
+            const auto &heap_stats = gpu_heap->stats();
+            ImGui::Text("GPU heap: %.1f of %.1f MB in %zu buffers",
+                        heap_stats.allocated_bytes / 1e6, heap_stats.reserved_bytes / 1e6,
+                        heap_stats.blocks);
+            if (ImGui::CollapsingHeader("Profiler")) {
+                profiler->render_gui();
+                if (ImGui::Button("Save CSV")) {
+                    save_profile(*profiler, false);
+                }
+                ImGui::SameLine();
+                if (ImGui::Button("Save JSON")) {
+                    save_profile(*profiler, true);
+                }
+            }
         }); // Common GUI
+        profiler->end();
 
         glfwSwapBuffers(window);
+        streamer->end_frame();
 
         animations_engine.tick();
         cam_control.process_animations();
@@ -976,6 +822,14 @@ int main() {
         cam.window_size = glm::vec2{g_window_width, g_window_height};
     }
 
+    // All own GL objects, the context must be alive.
+    renderer.reset();
+    profiler.reset();
+    streamer.reset();
+    gpu_heap.reset();
+    shader_cache.reset();
+    frame_uniforms.reset();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,255 @@
+#include "scenes.h"
+
+#include <algorithm>
+#include <cmath>
+#include <common/log.h>
+#include <cstdlib>
+#include <lands_compiler.h>
+#include <map_compiler_lib.h>
+#include <render_lib/visible_tiles.h>
+#include <render_units/roads/tesselation.h>
+
+namespace {
+std::optional<map_compiler::LandsMesh> generate_lands_quads(std::string data_root_str,
+                                                            DebugCtx &dctx) {
+    try {
+        auto lands_path =
+            fs::path(data_root_str) / "natural_earth" / "ne_10m_land" / "ne_10m_land.shp";
+        return map_compiler::compile_lands(map_compiler::load_shapes(lands_path), dctx);
+    } catch (const std::exception &e) {
+        log_err("failed compiling lands: {}", e.what());
+        return std::nullopt;
+    }
+}
+
+// Lands tiles are streamed from the mapped pack as they get visible, AA outline
+// of the finest level is merged into one mesh: coarser levels are simplified
+// by less than a pixel at zooms they are shown at, so it matches all of them.
+// Every tile stays a batch with its own quantization box.
+std::optional<WorldLandsSceneData> load_lands_pack(const fs::path &pack_path) {
+    try {
+        struct PackStorage {
+            std::unique_ptr<map_compiler::tile_pack::TilePack> pack;
+            roads_shader_aa::PackedAAMesh aa_mesh;
+        };
+        auto storage = std::make_shared<PackStorage>();
+        storage->pack = map_compiler::tile_pack::TilePack::open(pack_path);
+        auto &pack = *storage->pack;
+        if (pack.tiles().empty()) {
+            log_err("lands pack {} has no tiles", pack_path);
+            return std::nullopt;
+        }
+
+        WorldLandsSceneData data;
+        data.pack = &pack;
+        uint32_t level = pack.tiles()[0].level;
+        for (auto &t : pack.tiles()) {
+            level = std::max(level, t.level);
+        }
+
+        auto &aa_mesh = storage->aa_mesh;
+        for (auto &t : pack.tiles()) {
+            if (t.level != level) {
+                continue;
+            }
+            auto aa_vertices = pack.aa_vertices(t);
+            auto aa_indices = pack.aa_indices(t);
+            aa_mesh.batches.push_back({t.aa_box, static_cast<uint32_t>(aa_mesh.indices.size()),
+                                       static_cast<uint32_t>(aa_indices.size()),
+                                       static_cast<int32_t>(aa_mesh.vertices.size())});
+            aa_mesh.vertices.insert(aa_mesh.vertices.end(), aa_vertices.begin(),
+                                    aa_vertices.end());
+            aa_mesh.indices.insert(aa_mesh.indices.end(), aa_indices.begin(), aa_indices.end());
+        }
+        data.aa_vertices = aa_mesh.vertices;
+        data.aa_indices = aa_mesh.indices;
+        data.aa_batches = aa_mesh.batches;
+        data.storage = storage;
+        return data;
+    } catch (const std::exception &e) {
+        log_err("failed loading lands pack: {}", e.what());
+        return std::nullopt;
+    }
+}
+} // namespace
+
+std::tuple<vector<p32>, vector<uint32_t>, DebugCtx> generate_random_roads(v2 scene_origin,
+                                                                         unsigned seed) {
+    DebugCtx dctx;
+
+    //
+    // Generate random polylines
+    //
+    const double k = 100.0;
+
+    srand(seed);
+
+    vector<vector<p32>> random_polylines;
+    for (int i = 0; i < 500; ++i) {
+        int random_segments_count = rand() % 30 + 30;
+        double random_vector_angle = ((rand() % 360) / 360.0) * 2 * M_PI;
+        const int scater = 60000;
+        v2 origin =
+            scene_origin + (v2(rand() % scater - (scater / 2), rand() % scater - (scater / 2)));
+        v2 prev_p = origin;
+
+        vector<p32> random_polyline = {from_v2(prev_p)};
+        for (int s = 0; s < random_segments_count; s++) {
+            double random_length = (double)(rand() % 100000 + 10000);
+            double random_angle_val = (rand() % 5 + 5);
+            if (rand() % 2 == 1) {
+                random_angle_val *= -1;
+            }
+            double random_angle = random_vector_angle + (random_angle_val / 360.0) * 2 * M_PI;
+            auto random_direction = normalized(v2(std::cos(random_angle), std::sin(random_angle)));
+            random_vector_angle = random_angle;
+            // log_debug("random_length: {}", random_length);
+            // log_debug("random_angle: {} ({})", random_angle,
+            //(random_angle / M_PI) * 180.0);
+
+            v2 p = prev_p + random_direction * random_length;
+
+            if (p.x < 0.0 || p.y < 0.0) {
+                log_warn("out of canvas. truncate road");
+                break;
+            }
+            // dctx.add_line(prev_p, p, colors::grey);
+            prev_p = p;
+
+            random_polyline.push_back(from_v2(p));
+        }
+        if (random_polyline.size() < 3) {
+            log_warn("two small road, skip");
+            continue;
+        }
+        random_polylines.push_back(std::move(random_polyline));
+    }
+
+    vector<span<const p32>> polylines(random_polylines.begin(), random_polylines.end());
+    vector<double> widths(polylines.size(), 2000.0);
+    vector<p32> all_roads_vertices;
+    vector<uint32_t> all_roads_indices;
+    vector<p32> all_outlines;
+
+    auto tesselation_start_time = std::chrono::steady_clock::now();
+    roads::tesselation::generate_geometry_indexed_batch<roads::tesselation::FirstPassSettings>(
+        polylines, widths, all_roads_vertices, all_roads_indices, all_outlines);
+    auto tesselation_time = std::chrono::steady_clock::now() - tesselation_start_time;
+
+    auto tesselation_time_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(tesselation_time).count();
+    log_debug("Tesselation time: {}ms, {} vertices, {} indices", tesselation_time_ms,
+              all_roads_vertices.size(), all_roads_indices.size());
+
+    return std::tuple{all_roads_vertices, all_roads_indices, dctx};
+}
+
+std::optional<WorldLandsSceneData> load_world_lands(const std::string &data_root, DebugCtx &dctx) {
+    // Prefer lands precompiled by map_compiler, fallback to compiling them from shapes.
+    std::optional<WorldLandsSceneData> maybe_lands;
+    const auto pack_path = fs::path(data_root) / "lands.pack";
+    if (fs::exists(pack_path)) {
+        maybe_lands = load_lands_pack(pack_path);
+    }
+    if (!maybe_lands) {
+        if (auto mesh = generate_lands_quads(data_root, dctx)) {
+            struct MeshStorage {
+                map_compiler::LandsMesh mesh;
+                roads_shader_aa::PackedAAMesh aa_mesh;
+            };
+            auto storage = std::make_shared<MeshStorage>();
+            storage->mesh = std::move(*mesh);
+            // same batches as tiles of the finest level of default pack.
+            storage->aa_mesh = roads_shader_aa::pack_aa_mesh(storage->mesh.aa_vertices,
+                                                             storage->mesh.aa_indices, 4);
+            maybe_lands = WorldLandsSceneData{nullptr,
+                                              storage->mesh.vertices,
+                                              storage->mesh.indices,
+                                              storage->aa_mesh.vertices,
+                                              storage->aa_mesh.indices,
+                                              storage->aa_mesh.batches,
+                                              storage};
+        }
+    }
+
+    if (maybe_lands) {
+        log_debug("lands tiles: {}", maybe_lands->pack ? maybe_lands->pack->tiles().size() : 0);
+        log_debug("lands points: {}", maybe_lands->vertices.size());
+        log_debug("lands indices: {}", maybe_lands->indices.size());
+        log_debug("lands aa points: {}", maybe_lands->aa_vertices.size());
+        log_debug("lands aa indidices: {}", maybe_lands->aa_indices.size());
+        log_debug("lands aa batches: {}", maybe_lands->aa_batches.size());
+    }
+    return maybe_lands;
+}
+
+vector<uint32_t> pack_levels(const map_compiler::tile_pack::TilePack &pack) {
+    vector<uint32_t> levels;
+    for (auto &t : pack.tiles()) {
+        levels.push_back(t.level);
+    }
+    std::sort(levels.begin(), levels.end());
+    levels.erase(std::unique(levels.begin(), levels.end()), levels.end());
+    return levels;
+}
+
+std::unique_ptr<LandsTileStreamer>
+make_lands_streamer(const map_compiler::tile_pack::TilePack &pack) {
+    return std::make_unique<LandsTileStreamer>([&pack](gg::tile_at_level_t tile) {
+        const auto *entry = pack.find(tile);
+        if (!entry) {
+            throw std::runtime_error("tile is not in the pack");
+        }
+        auto vertices = pack.vertices(*entry);
+        auto indices = pack.indices(*entry);
+        return LandsTilePayload{{vertices.begin(), vertices.end()},
+                                {indices.begin(), indices.end()}};
+    });
+}
+
+void stream_lands_tiles(const camera::Cam2d &cam, const map_compiler::tile_pack::TilePack &pack,
+                        span<const uint32_t> pack_levels, LandsTileStreamer &streamer,
+                        render::TileCache &cache, lands::Lands &lands) {
+    const uint32_t level = camera::closest_level(pack_levels, camera::level_for_zoom(cam));
+    const auto visible = camera::visible_tiles(cam, level);
+    vector<gg::tile_at_level_t> missing;
+    cache.begin_frame();
+    auto check = [&](gg::tile_at_level_t tile) {
+        if (!cache.touch(tile) && pack.find(tile)) {
+            missing.push_back(tile);
+            cache.touch_fallback(tile);
+        }
+    };
+    const size_t rect_tiles =
+        size_t(visible.max_x - visible.min_x + 1) * (visible.max_y - visible.min_y + 1);
+    if (rect_tiles <= pack.tiles().size()) {
+        for (uint32_t y = visible.min_y; y <= visible.max_y; ++y) {
+            for (uint32_t x = visible.min_x; x <= visible.max_x; ++x) {
+                check({gg::tile_id_t(static_cast<uint16_t>(x), static_cast<uint16_t>(y)), level});
+            }
+        }
+    } else {
+        for (auto &t : pack.tiles()) {
+            if (visible.contains(t.tile())) {
+                check(t.tile());
+            }
+        }
+    }
+
+    const auto to_units = [](float v) {
+        return static_cast<uint32_t>(std::clamp<double>(v, 0.0, gg::U32_MAX));
+    };
+    streamer.request(missing, p32(to_units(cam.focus_pos.x), to_units(cam.focus_pos.y)));
+    streamer.upload(
+        [&](gg::tile_at_level_t tile, LandsTilePayload &t) {
+            const size_t bytes =
+                t.vertices.size() * sizeof(p32) + t.indices.size() * sizeof(uint32_t);
+            // Before adding, so evicted tiles free heap ranges first. Tiles keep
+            // no CPU copy, pack pages belong to the OS page cache.
+            if (cache.insert(tile, 0, bytes)) {
+                lands.add_tile({tile, t.vertices, t.indices});
+            }
+            return bytes;
+        },
+        render::UploadBudget{});
+}
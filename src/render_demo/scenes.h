@@ -0,0 +1,60 @@
+#pragma once
+
+#include <common/global.h>
+#include <memory>
+#include <render_lib/camera.h>
+#include <render_lib/debug_ctx.h>
+#include <render_lib/tile_cache.h>
+#include <render_lib/tile_streamer.h>
+#include <render_units/lands/lands.h>
+#include <render_units/roads_shader_aa/packed_vertex.h>
+#include <string>
+#include <tile_pack.h>
+#include <tuple>
+
+// Scenes of render_demo, render_bench draws the same ones.
+
+// 500 random roads around scene_origin, the same ones for the same seed.
+std::tuple<vector<p32>, vector<uint32_t>, DebugCtx> generate_random_roads(v2 scene_origin,
+                                                                         unsigned seed);
+
+// Lands geometry ready for upload. Spans point into storage which keeps the
+// mesh or the mapped tile pack alive. Lands are either tiled and streamed
+// from pack or given by vertices and indices.
+struct WorldLandsSceneData {
+    const map_compiler::tile_pack::TilePack *pack = nullptr;
+    span<p32> vertices;
+    span<uint32_t> indices;
+    span<roads_shader_aa::PackedAAVertex> aa_vertices;
+    span<uint32_t> aa_indices;
+    span<roads_shader_aa::PackedAABatch> aa_batches;
+    std::shared_ptr<void> storage;
+};
+
+// Lands of <data_root>/lands.pack, or compiled from natural earth shapes in
+// data_root when there is no pack. Errors are logged.
+std::optional<WorldLandsSceneData> load_world_lands(const std::string &data_root,
+                                                    DebugCtx &dctx);
+
+// Lands tile copied out of the mapped pack by a streaming worker, so pages of
+// the pack are read off the render thread.
+struct LandsTilePayload {
+    vector<p32> vertices;
+    vector<uint32_t> indices;
+};
+
+using LandsTileStreamer = render::TileStreamer<LandsTilePayload>;
+
+// Levels of the pack, ascending.
+vector<uint32_t> pack_levels(const map_compiler::tile_pack::TilePack &pack);
+
+std::unique_ptr<LandsTileStreamer>
+make_lands_streamer(const map_compiler::tile_pack::TilePack &pack);
+
+// Requests visible tiles of the pack level fitting camera which lands miss
+// and uploads tiles loaded so far within the frame budget. Cache decides which
+// tiles stay in lands: visible ones and ancestors covering missing ones are
+// kept, the rest is evicted least recently seen first when budget runs out.
+void stream_lands_tiles(const camera::Cam2d &cam, const map_compiler::tile_pack::TilePack &pack,
+                        span<const uint32_t> pack_levels, LandsTileStreamer &streamer,
+                        render::TileCache &cache, lands::Lands &lands);
@@ -0,0 +1,226 @@
+#include <render_lib/buffer_streamer.h>
+
+#include <common/gl_check.h>
+#include <common/log.h>
+#include <cstring>
+
+// Not part of GL 3.3 headers.
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+namespace render {
+
+namespace {
+using buffer_storage_fn = void(APIENTRYP)(GLenum target, GLsizeiptr size, const void *data,
+                                          GLbitfield flags);
+
+class GlStreaming : public StreamingGl {
+  public:
+    explicit GlStreaming(buffer_storage_fn buffer_storage) : m_buffer_storage(buffer_storage) {}
+
+    bool has_buffer_storage() const override { return m_buffer_storage != nullptr; }
+
+    unsigned create_buffer() override {
+        unsigned buffer = 0;
+        GL_CHECK(glGenBuffers(1, &buffer));
+        return buffer;
+    }
+
+    void delete_buffer(unsigned buffer) override { GL_CHECK(glDeleteBuffers(1, &buffer)); }
+
+    uint8_t *create_persistent(unsigned buffer, size_t size) override {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        GL_CHECK(m_buffer_storage(GL_COPY_READ_BUFFER, size, nullptr, flags));
+        void *mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, flags);
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+        return static_cast<uint8_t *>(mapped);
+    }
+
+    void orphan(unsigned buffer, size_t size) override {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        GL_CHECK(glBufferData(GL_COPY_READ_BUFFER, size, nullptr, GL_STREAM_DRAW));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    uint8_t *map_range(unsigned buffer, size_t offset, size_t size) override {
+        // Ranges are never mapped twice between orphaning, so there is
+        // nothing to synchronize with.
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        void *mapped = glMapBufferRange(
+            GL_COPY_READ_BUFFER, offset, size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        return static_cast<uint8_t *>(mapped);
+    }
+
+    void unmap(unsigned buffer) override {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, buffer));
+        GL_CHECK(glUnmapBuffer(GL_COPY_READ_BUFFER));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    void copy(unsigned src, size_t src_offset, unsigned dst, size_t dst_offset,
+              size_t size) override {
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, src));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, dst));
+        GL_CHECK(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, src_offset,
+                                     dst_offset, size));
+        GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+        GL_CHECK(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+    }
+
+    sync_t fence() override { return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
+
+    WaitResult wait(sync_t sync) override {
+        const GLuint64 TIMEOUT_NS = 100'000'000;
+        switch (glClientWaitSync(static_cast<GLsync>(sync), GL_SYNC_FLUSH_COMMANDS_BIT,
+                                 TIMEOUT_NS)) {
+        case GL_ALREADY_SIGNALED:
+            return WaitResult::already_signaled;
+        case GL_CONDITION_SATISFIED:
+            return WaitResult::signaled;
+        case GL_TIMEOUT_EXPIRED:
+            log_warn("staging region is still in use after {}ms", TIMEOUT_NS / 1'000'000);
+            return WaitResult::failed;
+        default:
+            log_err("failed waiting for staging region fence: 0x{:X}", glGetError());
+            return WaitResult::failed;
+        }
+    }
+
+    void delete_sync(sync_t sync) override { glDeleteSync(static_cast<GLsync>(sync)); }
+
+  private:
+    buffer_storage_fn m_buffer_storage;
+};
+} // namespace
+
+std::unique_ptr<StreamingGl> make_streaming_gl(void *(*proc_address)(const char *)) {
+    buffer_storage_fn buffer_storage = nullptr;
+    const bool gl_4_4 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 4);
+    if (gl_4_4 || has_gl_extension("GL_ARB_buffer_storage")) {
+        buffer_storage = reinterpret_cast<buffer_storage_fn>(proc_address("glBufferStorage"));
+    }
+    return std::make_unique<GlStreaming>(buffer_storage);
+}
+
+BufferStreamer::BufferStreamer(std::unique_ptr<StreamingGl> gl, size_t region_size,
+                               size_t regions_count)
+    : m_gl(std::move(gl)), m_region_size(region_size), m_regions(regions_count) {
+    assert(region_size > 0 && regions_count > 0);
+    create_staging();
+}
+
+BufferStreamer::~BufferStreamer() {
+    for (auto &r : m_regions) {
+        if (r.fence) {
+            m_gl->delete_sync(r.fence);
+        }
+    }
+    m_gl->delete_buffer(m_staging);
+}
+
+void BufferStreamer::create_staging() {
+    m_staging = m_gl->create_buffer();
+    m_mapped = nullptr;
+    if (m_gl->has_buffer_storage()) {
+        m_mapped = m_gl->create_persistent(m_staging, m_region_size * m_regions.size());
+        if (!m_mapped) {
+            log_warn("persistent mapping failed, staging buffer falls back to orphaning");
+            m_gl->delete_buffer(m_staging); // storage is immutable once specified.
+            m_staging = m_gl->create_buffer();
+        }
+    }
+    if (!m_mapped) {
+        m_gl->orphan(m_staging, m_region_size * m_regions.size());
+    }
+}
+
+void BufferStreamer::replace_staging() {
+    // Deleting the buffer keeps its storage alive for the copies still
+    // reading it, same as orphaning, and none of the old fences matter.
+    for (auto &r : m_regions) {
+        if (r.fence) {
+            m_gl->delete_sync(r.fence);
+            r.fence = nullptr;
+        }
+    }
+    m_gl->delete_buffer(m_staging);
+    create_staging();
+    m_stats.orphans++;
+}
+
+void BufferStreamer::upload(unsigned dst, size_t dst_offset, span<const uint8_t> data) {
+    m_stats.uploads++;
+    m_stats.bytes += data.size();
+    while (!data.empty()) {
+        if (m_used == m_region_size) {
+            next_region();
+        }
+        const size_t n = std::min(data.size(), m_region_size - m_used);
+        const size_t staging_offset = m_current * m_region_size + m_used;
+        if (m_mapped) {
+            std::memcpy(m_mapped + staging_offset, data.data(), n);
+        } else {
+            uint8_t *mapped = m_gl->map_range(m_staging, staging_offset, n);
+            if (!mapped) {
+                log_err("failed mapping staging buffer, {} bytes are not uploaded", data.size());
+                return;
+            }
+            std::memcpy(mapped, data.data(), n);
+            m_gl->unmap(m_staging);
+        }
+        m_gl->copy(m_staging, staging_offset, dst, dst_offset, n);
+        m_used += n;
+        dst_offset += n;
+        data = data.subspan(n);
+    }
+}
+
+void BufferStreamer::end_frame() {
+    close_region();
+    if (m_used > 0) {
+        m_used = m_region_size; // next upload goes to the next region.
+    }
+}
+
+void BufferStreamer::close_region() {
+    // Without persistent mapping regions are not reused before orphaning,
+    // so they need no fences.
+    Region &region = m_regions[m_current];
+    if (m_mapped && m_used > 0 && !region.fence) {
+        region.fence = m_gl->fence();
+    }
+}
+
+void BufferStreamer::next_region() {
+    close_region();
+    m_current = (m_current + 1) % m_regions.size();
+    m_used = 0;
+    if (!m_mapped) {
+        if (m_current == 0) {
+            m_gl->orphan(m_staging, m_region_size * m_regions.size());
+            m_stats.orphans++;
+        }
+        return;
+    }
+    Region &region = m_regions[m_current];
+    if (!region.fence) {
+        return;
+    }
+    const auto result = m_gl->wait(region.fence);
+    m_gl->delete_sync(region.fence);
+    region.fence = nullptr;
+    if (result == StreamingGl::WaitResult::signaled) {
+        m_stats.fence_waits++;
+    } else if (result == StreamingGl::WaitResult::failed) {
+        log_warn("staging region may still be in use, replacing staging buffer");
+        replace_staging();
+    }
+}
+
+} // namespace render
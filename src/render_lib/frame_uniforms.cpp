@@ -0,0 +1,28 @@
+#include <render_lib/frame_uniforms.h>
+
+#include <common/gl_check.h>
+#include <render_lib/shader_program.h>
+
+namespace render {
+
+FrameUniforms::FrameUniforms() {
+    GL_CHECK(glGenBuffers(1, &m_buffer));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_buffer));
+    GL_CHECK(glBufferData(GL_UNIFORM_BUFFER, sizeof(Data), nullptr, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+    // Nothing else uses the binding point, it stays bound.
+    GL_CHECK(glBindBufferBase(GL_UNIFORM_BUFFER, shader_program::FRAME_BLOCK_BINDING, m_buffer));
+}
+
+FrameUniforms::~FrameUniforms() { GL_CHECK(glDeleteBuffers(1, &m_buffer)); }
+
+void FrameUniforms::update(const camera::Cam2d &cam) {
+    m_data.proj = cam.projection_maxtrix();
+    m_data.zoom = static_cast<float>(cam.zoom);
+    m_data.rotation = static_cast<float>(cam.rotation);
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, m_buffer));
+    GL_CHECK(glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Data), &m_data));
+    GL_CHECK(glBindBuffer(GL_UNIFORM_BUFFER, 0));
+}
+
+} // namespace render
@@ -0,0 +1,146 @@
+#include <render_lib/gpu_heap.h>
+
+#include <algorithm>
+#include <common/gl_check.h>
+#include <common/log.h>
+
+namespace render {
+
+RangeAllocator::RangeAllocator(size_t capacity) : m_capacity(capacity), m_free_bytes(capacity) {
+    if (capacity > 0) {
+        m_free.emplace(0, capacity);
+    }
+}
+
+optional<size_t> RangeAllocator::allocate(size_t size, size_t alignment) {
+    assert(size > 0 && alignment > 0);
+    for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+        const size_t start = it->first;
+        const size_t end = it->first + it->second;
+        const size_t aligned = (start + alignment - 1) / alignment * alignment;
+        if (aligned + size > end) {
+            continue;
+        }
+        // Alignment gap stays free.
+        m_free.erase(it);
+        if (aligned > start) {
+            m_free.emplace(start, aligned - start);
+        }
+        if (aligned + size < end) {
+            m_free.emplace(aligned + size, end - aligned - size);
+        }
+        m_free_bytes -= size;
+        return aligned;
+    }
+    return std::nullopt;
+}
+
+void RangeAllocator::release(size_t offset, size_t size) {
+    assert(size > 0 && offset + size <= m_capacity);
+    size_t start = offset;
+    size_t end = offset + size;
+    auto next = m_free.lower_bound(offset);
+    assert(next == m_free.end() || end <= next->first); // double release.
+    if (next != m_free.end() && next->first == end) {
+        end += next->second;
+        next = m_free.erase(next);
+    }
+    if (next != m_free.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= start);
+        if (prev->first + prev->second == start) {
+            start = prev->first;
+            m_free.erase(prev);
+        }
+    }
+    m_free.emplace(start, end - start);
+    m_free_bytes += size;
+}
+
+size_t RangeAllocator::largest_free() const {
+    size_t largest = 0;
+    for (auto &[offset, size] : m_free) {
+        largest = std::max(largest, size);
+    }
+    return largest;
+}
+
+GpuHeap::GpuHeap(size_t block_size) : m_block_size(block_size) { assert(block_size > 0); }
+
+GpuHeap::~GpuHeap() {
+    for (auto &b : m_blocks) {
+        GL_CHECK(glDeleteBuffers(1, &b.buffer));
+    }
+}
+
+GpuRange GpuHeap::allocate(size_t size, size_t alignment) {
+    if (size == 0) {
+        return {};
+    }
+    m_stats.allocations++;
+    m_stats.allocated_bytes += size;
+    if (size > m_block_size) {
+        Block &block = add_block(size, true);
+        return GpuRange{block.buffer, *block.allocator.allocate(size), size};
+    }
+    for (auto &b : m_blocks) {
+        if (b.dedicated) {
+            continue;
+        }
+        if (auto offset = b.allocator.allocate(size, alignment)) {
+            return GpuRange{b.buffer, *offset, size};
+        }
+    }
+    Block &block = add_block(m_block_size, false);
+    return GpuRange{block.buffer, *block.allocator.allocate(size, alignment), size};
+}
+
+bool GpuHeap::release(GpuRange &range) {
+    if (range.empty()) {
+        return false;
+    }
+    auto it = std::find_if(m_blocks.begin(), m_blocks.end(),
+                           [&](const Block &b) { return b.buffer == range.buffer; });
+    assert(it != m_blocks.end());
+    it->allocator.release(range.offset, range.size);
+    m_stats.allocations--;
+    m_stats.allocated_bytes -= range.size;
+    range = GpuRange{};
+
+    if (!it->allocator.empty()) {
+        return false;
+    }
+    // One empty shared block is kept for the next allocations.
+    const bool has_spare = std::any_of(m_blocks.begin(), m_blocks.end(), [&](const Block &b) {
+        return &b != &*it && !b.dedicated && b.allocator.empty();
+    });
+    if (it->dedicated || has_spare) {
+        delete_block(it - m_blocks.begin());
+        return true;
+    }
+    return false;
+}
+
+GpuHeap::Block &GpuHeap::add_block(size_t size, bool dedicated) {
+    unsigned buffer = 0;
+    GL_CHECK(glGenBuffers(1, &buffer));
+    // Copy target, binding an element array buffer would change the bound vao.
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, buffer));
+    GL_CHECK(glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+    m_stats.blocks++;
+    m_stats.reserved_bytes += size;
+    log_debug("gpu heap: new {}block of {} bytes, {} bytes reserved in total",
+              dedicated ? "dedicated " : "", size, m_stats.reserved_bytes);
+    return m_blocks.emplace_back(Block{buffer, RangeAllocator(size), dedicated});
+}
+
+void GpuHeap::delete_block(size_t index) {
+    Block &b = m_blocks[index];
+    m_stats.blocks--;
+    m_stats.reserved_bytes -= b.allocator.capacity();
+    GL_CHECK(glDeleteBuffers(1, &b.buffer));
+    m_blocks.erase(m_blocks.begin() + index);
+}
+
+} // namespace render
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+#include <memory>
+
+namespace render {
+
+// The part of OpenGL BufferStreamer needs, so it can run against a mock in
+// tests. Buffers are GL buffer names, syncs are GLsync.
+class StreamingGl {
+  public:
+    using sync_t = void *;
+    enum class WaitResult {
+        already_signaled, // returned without blocking.
+        signaled,
+        failed, // error or timeout, the GPU may still use what the fence guards.
+    };
+
+    virtual ~StreamingGl() = default;
+
+    // ARB_buffer_storage (or GL 4.4) is there, create_persistent can be used.
+    virtual bool has_buffer_storage() const = 0;
+    virtual unsigned create_buffer() = 0;
+    virtual void delete_buffer(unsigned buffer) = 0;
+    // Immutable storage mapped for writing persistently and coherently,
+    // nullptr on failure.
+    virtual uint8_t *create_persistent(unsigned buffer, size_t size) = 0;
+    // Gives buffer new storage of size bytes, commands still referencing old
+    // storage keep it alive until they are done.
+    virtual void orphan(unsigned buffer, size_t size) = 0;
+    // Unsynchronized write only mapping of the range, nullptr on failure.
+    virtual uint8_t *map_range(unsigned buffer, size_t offset, size_t size) = 0;
+    virtual void unmap(unsigned buffer) = 0;
+    virtual void copy(unsigned src, size_t src_offset, unsigned dst, size_t dst_offset,
+                      size_t size) = 0;
+    // Fence after all commands issued so far.
+    virtual sync_t fence() = 0;
+    // Blocks until the fence is signaled, for a bounded time.
+    virtual WaitResult wait(sync_t sync) = 0;
+    virtual void delete_sync(sync_t sync) = 0;
+};
+
+// Backend calling OpenGL of the current context. glBufferStorage is not part
+// of the GL 3.3 glad loader, so it is looked up with proc_address when the
+// context supports it.
+std::unique_ptr<StreamingGl> make_streaming_gl(void *(*proc_address)(const char *));
+
+// Uploads data to GPU buffers through a ring of staging regions instead of
+// glBufferSubData, which stalls when the driver has to wait for the
+// destination buffer or to copy large data at once. Data is written into the
+// current region and copied into the destination on GPU, a region closed
+// with a fence is reused only after the fence is signaled. With
+// ARB_buffer_storage the staging buffer is mapped persistently, otherwise it
+// is orphaned every time the ring wraps around. If waiting for a fence fails,
+// the persistent staging buffer is replaced, as it cannot be orphaned.
+//
+// Uploads bigger than a region are split, so the ring size bounds staging
+// memory, not uploads.
+class BufferStreamer {
+  public:
+    struct Stats {
+        size_t uploads = 0;
+        size_t bytes = 0;
+        size_t fence_waits = 0; // times waiting for a region blocked.
+        size_t orphans = 0;     // staging storage replaced, persistent one included.
+    };
+
+    static constexpr size_t DEFAULT_REGION_SIZE = 4 * 1024 * 1024;
+    static constexpr size_t DEFAULT_REGIONS_COUNT = 4;
+
+    explicit BufferStreamer(std::unique_ptr<StreamingGl> gl,
+                            size_t region_size = DEFAULT_REGION_SIZE,
+                            size_t regions_count = DEFAULT_REGIONS_COUNT);
+    ~BufferStreamer();
+
+    BufferStreamer(const BufferStreamer &) = delete;
+    BufferStreamer &operator=(const BufferStreamer &) = delete;
+
+    // Copies data into dst buffer at dst_offset bytes. Data can be freed once
+    // the call returns.
+    void upload(unsigned dst, size_t dst_offset, span<const uint8_t> data);
+    template <class T> void upload(unsigned dst, size_t dst_offset, span<const T> data) {
+        upload(dst, dst_offset,
+               span<const uint8_t>(reinterpret_cast<const uint8_t *>(data.data()),
+                                   data.size() * sizeof(T)));
+    }
+
+    // Closes the current region so uploads of the next frame start in a new
+    // one, call once per frame.
+    void end_frame();
+
+    bool persistent() const { return m_mapped != nullptr; }
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    struct Region {
+        StreamingGl::sync_t fence = nullptr;
+    };
+
+    void create_staging();
+    void replace_staging();
+    void close_region();
+    void next_region();
+
+    std::unique_ptr<StreamingGl> m_gl;
+    size_t m_region_size;
+    vector<Region> m_regions;
+    unsigned m_staging = 0;
+    uint8_t *m_mapped = nullptr; // persistent mapping of the whole ring.
+    size_t m_current = 0;        // region being filled.
+    size_t m_used = 0;           // bytes of the current region.
+    Stats m_stats;
+};
+
+} // namespace render
@@ -13,8 +13,8 @@ v2 from_glmvec2(glm::vec2 v) { return v2{v.x, v.y}; }
 struct CameraControlVisuals {
     LinesUnit lines; // todo: do nopt hold lines renderer here but only data.
 
-    bool init_render(string shaders_root) {
-        if (!this->lines.load_shaders(shaders_root)) {
+    bool init_render(shader_program::ShaderCache &shaders) {
+        if (!this->lines.load_shaders(shaders)) {
             log_err("failed loading shaders for camera control visuals");
             return false;
         }
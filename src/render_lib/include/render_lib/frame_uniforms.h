@@ -0,0 +1,47 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <render_lib/camera.h>
+
+namespace render {
+
+// Camera of the frame in one uniform buffer bound to
+// shader_program::FRAME_BLOCK_BINDING, so the projection is computed once per
+// frame instead of by every unit, and programs read it without a
+// glUniform call each. Shaders declare the block as
+//
+//   layout(std140) uniform Frame {
+//       mat4 proj;
+//       float zoom;
+//       float rotation;
+//   };
+class FrameUniforms {
+  public:
+    // std140 layout of the block.
+    struct Data {
+        glm::mat4 proj;
+        float zoom;
+        float rotation;
+        float padding[2];
+    };
+    static_assert(sizeof(Data) == 80, "must match std140 layout of the Frame block");
+
+    // Creates the buffer and binds it, the GL context must be current.
+    FrameUniforms();
+    // Deletes the buffer, the GL context must still be alive.
+    ~FrameUniforms();
+
+    FrameUniforms(const FrameUniforms &) = delete;
+    FrameUniforms &operator=(const FrameUniforms &) = delete;
+
+    // Call once per frame before units render.
+    void update(const camera::Cam2d &cam);
+
+    const Data &data() const { return m_data; }
+
+  private:
+    unsigned m_buffer = 0;
+    Data m_data{};
+};
+
+} // namespace render
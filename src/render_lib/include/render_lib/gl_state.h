@@ -0,0 +1,64 @@
+#pragma once
+
+#include <common/gl_check.h>
+#include <cstddef>
+
+namespace render {
+
+struct BindStats {
+    size_t program_binds = 0;
+    size_t program_skips = 0; // program was already bound.
+    size_t vao_binds = 0;
+    size_t vao_skips = 0;
+};
+
+struct DrawStats {
+    size_t draw_calls = 0; // a multi draw is one.
+    size_t vertices = 0;   // submitted, indices of indexed draws.
+};
+
+namespace detail {
+// Of the current context, there is only one.
+inline unsigned bound_program = 0;
+inline unsigned bound_vao = 0;
+inline BindStats bind_stats;
+inline DrawStats draw_stats;
+} // namespace detail
+
+// Program and vertex array binds go through these, so binding what is bound
+// already costs no GL call and units don't have to unbind after drawing.
+// Code binding them with GL directly must restore what it found, as ImGui
+// does.
+inline void use_program(unsigned program) {
+    if (program == detail::bound_program) {
+        detail::bind_stats.program_skips++;
+        return;
+    }
+    GL_CHECK(glUseProgram(program));
+    detail::bound_program = program;
+    detail::bind_stats.program_binds++;
+}
+
+inline void bind_vao(unsigned vao) {
+    if (vao == detail::bound_vao) {
+        detail::bind_stats.vao_skips++;
+        return;
+    }
+    GL_CHECK(glBindVertexArray(vao));
+    detail::bound_vao = vao;
+    detail::bind_stats.vao_binds++;
+}
+
+inline const BindStats &bind_stats() { return detail::bind_stats; }
+inline void reset_bind_stats() { detail::bind_stats = {}; }
+
+// Units count their draws right after issuing them.
+inline void count_draw(size_t vertices) {
+    detail::draw_stats.draw_calls++;
+    detail::draw_stats.vertices += vertices;
+}
+
+inline const DrawStats &draw_stats() { return detail::draw_stats; }
+inline void reset_draw_stats() { detail::draw_stats = {}; }
+
+} // namespace render
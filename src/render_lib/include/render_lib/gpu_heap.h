@@ -0,0 +1,93 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+#include <map>
+
+namespace render {
+
+// First fit allocator of ranges in [0, capacity), knows nothing about GL.
+// Free ranges are kept ordered by offset and merged with neighbours on
+// release.
+class RangeAllocator {
+  public:
+    explicit RangeAllocator(size_t capacity);
+
+    // Offset of size bytes, a multiple of alignment (which doesn't have to be
+    // a power of two). Nothing when no free range fits.
+    optional<size_t> allocate(size_t size, size_t alignment = 1);
+    // Range must have been returned by allocate() with the same size.
+    void release(size_t offset, size_t size);
+
+    size_t capacity() const { return m_capacity; }
+    size_t free_bytes() const { return m_free_bytes; }
+    size_t largest_free() const;
+    bool empty() const { return m_free_bytes == m_capacity; }
+
+  private:
+    size_t m_capacity;
+    size_t m_free_bytes;
+    std::map<size_t, size_t> m_free; // offset -> size, never adjacent.
+};
+
+// Part of a heap buffer.
+struct GpuRange {
+    unsigned buffer = 0;
+    size_t offset = 0; // bytes
+    size_t size = 0;   // bytes
+
+    bool empty() const { return size == 0; }
+};
+
+// Sub-allocates ranges of a few large GL buffers, so render units take as
+// much GPU memory as their data needs instead of reserving buffers for the
+// worst case. Requests bigger than block_size get a buffer of their own,
+// which is deleted once released.
+//
+// Vertex ranges should be aligned to the vertex size: offset / stride is then
+// usable as first vertex or base vertex with attributes pointing to the
+// start of the buffer, and a unit only has to respecify attributes when its
+// data moves to another buffer.
+class GpuHeap {
+  public:
+    struct Stats {
+        size_t blocks = 0;
+        size_t reserved_bytes = 0;  // of all GL buffers.
+        size_t allocated_bytes = 0; // handed out to units.
+        size_t allocations = 0;
+    };
+
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 16 * 1024 * 1024;
+
+    explicit GpuHeap(size_t block_size = DEFAULT_BLOCK_SIZE);
+    // Deletes all buffers, the GL context must still be alive.
+    ~GpuHeap();
+
+    GpuHeap(const GpuHeap &) = delete;
+    GpuHeap &operator=(const GpuHeap &) = delete;
+
+    // Empty range for size 0.
+    GpuRange allocate(size_t size, size_t alignment = sizeof(uint32_t));
+    // Does nothing for an empty range, range is emptied. True if the range's
+    // buffer was deleted, its name may then come back from allocate() for
+    // another buffer.
+    bool release(GpuRange &range);
+
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    struct Block {
+        unsigned buffer;
+        RangeAllocator allocator;
+        bool dedicated;
+    };
+
+    Block &add_block(size_t size, bool dedicated);
+    void delete_block(size_t index);
+
+    size_t m_block_size;
+    vector<Block> m_blocks;
+    Stats m_stats;
+};
+
+} // namespace render
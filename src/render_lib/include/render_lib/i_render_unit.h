@@ -5,4 +5,10 @@
 class IRenderUnit {
   public:
     virtual void render_frame(const camera::Cam2d &cam) = 0;
+
+    // Program and vertex array the unit draws with, 0 if unknown. Layers of
+    // the same z are drawn sorted by them, so units sharing a program or a
+    // vao bind it once.
+    virtual unsigned program() const { return 0; }
+    virtual unsigned vao() const { return 0; }
 };
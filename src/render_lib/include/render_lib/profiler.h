@@ -0,0 +1,128 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace render {
+
+// The part of OpenGL Profiler needs, so it can run headless. Queries are GL
+// query names.
+class TimerGl {
+  public:
+    virtual ~TimerGl() = default;
+
+    virtual unsigned create_query() = 0;
+    virtual void delete_query(unsigned query) = 0;
+    // GL_TIME_ELAPSED of commands issued between begin and end.
+    virtual void begin(unsigned query) = 0;
+    virtual void end() = 0;
+    // False while GPU is not done with the commands yet.
+    virtual bool result(unsigned query, uint64_t &ns) = 0;
+};
+
+// Timer queries of the current context, core since GL 3.3.
+std::unique_ptr<TimerGl> make_timer_gl();
+// Without GPU timing, for tests and contexts not supporting it.
+std::unique_ptr<TimerGl> make_null_timer_gl();
+
+// Times scopes of a frame on CPU and on GPU and keeps the last window samples
+// of each for min, avg and p99.
+//
+// GPU time of a scope is a GL_TIME_ELAPSED query. Each scope has a query per
+// frame of QUERY_FRAMES, a result is read back when its slot comes around
+// again, so timing never waits for GPU. If GPU is further behind, the scope
+// is not timed on GPU in that frame. GL can't nest time elapsed queries, so
+// neither can scopes.
+class Profiler {
+  public:
+    using scope_id = size_t;
+
+    static constexpr size_t QUERY_FRAMES = 2;
+
+    struct Summary {
+        double min = 0;
+        double avg = 0;
+        double p99 = 0;
+        size_t samples = 0; // in the window.
+    };
+
+    struct ScopeStats {
+        Summary cpu_ms;
+        Summary gpu_ms;
+        size_t count = 0; // times the scope ran, all time.
+    };
+
+    // Starts and ends a scope.
+    class Timer {
+      public:
+        Timer(Profiler &profiler, scope_id scope) : m_profiler(profiler) {
+            m_profiler.begin(scope);
+        }
+        ~Timer() { m_profiler.end(); }
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+      private:
+        Profiler &m_profiler;
+    };
+
+    explicit Profiler(std::unique_ptr<TimerGl> gl, size_t window = 300);
+    // Deletes queries, the GL context must still be alive.
+    ~Profiler();
+
+    Profiler(const Profiler &) = delete;
+    Profiler &operator=(const Profiler &) = delete;
+
+    scope_id add_scope(std::string name);
+    const std::string &name(scope_id scope) const { return m_scopes[scope].name; }
+
+    // Collects finished GPU timings and moves to queries of the next frame.
+    void begin_frame();
+    void begin(scope_id scope);
+    void end();
+    // CPU time measured elsewhere.
+    void record_cpu(scope_id scope, double ms);
+
+    ScopeStats stats(scope_id scope) const;
+
+    // Table of all scopes.
+    void render_gui() const;
+    // Stats of all scopes, a row or an object per scope.
+    void write_csv(std::ostream &os) const;
+    void write_json(std::ostream &os) const;
+
+  private:
+    // Last samples, a ring once it is full.
+    struct Series {
+        vector<double> values;
+        size_t next = 0;
+
+        void push(double value, size_t window);
+        Summary summary() const;
+    };
+
+    struct Scope {
+        std::string name;
+        Series cpu;
+        Series gpu;
+        size_t count = 0;
+        unsigned queries[QUERY_FRAMES] = {};
+        bool pending[QUERY_FRAMES] = {};
+        bool gpu_timed = false; // in the frame, by the running begin.
+    };
+
+    void collect(Scope &scope, size_t slot);
+
+    std::unique_ptr<TimerGl> m_gl;
+    size_t m_window;
+    vector<Scope> m_scopes;
+    size_t m_slot = 0;
+    optional<scope_id> m_running;
+    steady_clock::time_point m_start;
+};
+
+} // namespace render
@@ -1,21 +1,71 @@
 #pragma once
-#include <vector>
+
+#include <common/global.h>
+#include <functional>
+#include <string>
 
 #include "i_render_unit.h"
+#include "profiler.h"
 
 namespace render {
 
+// Draws render units as layers, back to front by z. Layers of the same z are
+// drawn sorted by program and vao of their units, so a program or vao shared
+// by several layers is bound once (units bind through use_program() and
+// bind_vao(), which skip what is bound). Such layers must not depend on
+// their order, layers which overlap get different z.
+//
+// Draw order is kept between frames and rebuilt only when it gets dirty: a
+// layer is added, enabled, disabled, moved, or its unit switches program or
+// vao.
+//
+// Every layer is a scope of the profiler, timed with its update.
 class Render {
-    std::vector<IRenderUnit *> m_units;
-
   public:
-    void add_unit(IRenderUnit *render_unit) { m_units.emplace_back(render_unit); }
+    using layer_id = size_t;
+    // Runs right before the layer is drawn while it is enabled, e.g. to
+    // stream data the camera needs.
+    using update_fn = std::function<void(const camera::Cam2d &)>;
+
+    struct Layer {
+        std::string name;
+        IRenderUnit *unit;
+        int z;
+        bool enabled = true;
+        update_fn update;
+        Profiler::scope_id scope;
+        // Of the unit when draw order was built.
+        unsigned program = 0;
+        unsigned vao = 0;
+    };
+
+    // Profiler must outlive the render.
+    explicit Render(Profiler &profiler);
+
+    Render(const Render &) = delete;
+    Render &operator=(const Render &) = delete;
+
+    // Unit must outlive the render.
+    layer_id add_layer(std::string name, IRenderUnit &unit, int z, update_fn update = {});
+    void set_enabled(layer_id layer, bool enabled);
+    bool enabled(layer_id layer) const { return m_layers[layer].enabled; }
+    void set_z(layer_id layer, int z);
+
+    void render_frame(const camera::Cam2d &cam);
+    // Checkbox of every layer with its average timings.
+    void render_gui();
+
+    const vector<Layer> &layers() const { return m_layers; }
+    // Enabled layers in the order they are drawn.
+    const vector<layer_id> &draw_order();
+
+  private:
+    void rebuild_order();
 
-    void render_frame() {
-        for (auto *unit : m_units) {
-            unit->render_frame();
-        }
-    }
+    Profiler &m_profiler;
+    vector<Layer> m_layers;
+    vector<layer_id> m_order;
+    bool m_order_dirty = true;
 };
 
-} // namespace render
\ No newline at end of file
+} // namespace render
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <common/global.h>
+#include <cstdint>
+#include <memory>
+#include <render_lib/shader_program.h>
+#include <unordered_map>
+
+namespace shader_program {
+
+// The part of OpenGL ShaderCache needs, so it can run against a mock in
+// tests. Programs are GL program names.
+class ProgramGl {
+  public:
+    virtual ~ProgramGl() = default;
+
+    // Vendor, renderer and version, binaries of one driver are not valid for
+    // another.
+    virtual std::string driver() const = 0;
+    // ARB_get_program_binary (or GL 4.1) is there and the driver has at
+    // least one binary format, get_binary and load_binary can be used.
+    virtual bool has_program_binary() const = 0;
+    // 0 on failure. Binaries of the program are retrievable when supported.
+    virtual unsigned compile(const std::string &name, const std::string &v_src,
+                             const std::string &f_src) = 0;
+    // False if the driver gives no binary.
+    virtual bool get_binary(unsigned program, uint32_t &format, vector<uint8_t> &binary) = 0;
+    // 0 if the driver rejects the binary, e.g. after a driver update.
+    virtual unsigned load_binary(uint32_t format, span<const uint8_t> binary) = 0;
+    // Of a program just compiled or loaded, see prepare_linked().
+    virtual ShaderProgram::locations_t prepare(unsigned program) = 0;
+    virtual void delete_program(unsigned program) = 0;
+};
+
+// Backend calling OpenGL of the current context. Program binary functions
+// are not part of the GL 3.3 glad loader, so they are looked up with
+// proc_address when the context supports them.
+std::unique_ptr<ProgramGl> make_program_gl(void *(*proc_address)(const char *));
+
+// Hands out shader programs of <shaders_root>/<shader_idname>.{vert,frag}.glsl
+// to render units. Programs are keyed by hash of their sources, so units
+// asking for the same program (or different bundles with the same sources)
+// share one GL program.
+//
+// Linked programs are saved as binaries to binaries_dir, in a subdirectory
+// per driver, and the next start loads them instead of compiling. A binary
+// the driver rejects is replaced by a freshly compiled one. Empty
+// binaries_dir keeps the cache within the process.
+class ShaderCache {
+  public:
+    struct Stats {
+        size_t programs = 0;
+        size_t hits = 0;     // get() of a program already in the process.
+        size_t compiled = 0; // from sources.
+        size_t loaded = 0;   // from binaries.
+        size_t rejected = 0; // binaries the driver didn't take.
+    };
+
+    ShaderCache(std::unique_ptr<ProgramGl> gl, std::filesystem::path shaders_root,
+                std::filesystem::path binaries_dir);
+    // Deletes all programs, the GL context must still be alive.
+    ~ShaderCache();
+
+    ShaderCache(const ShaderCache &) = delete;
+    ShaderCache &operator=(const ShaderCache &) = delete;
+
+    // nullptr if sources can't be read or compiled, errors are logged.
+    std::shared_ptr<ShaderProgram> get(const std::string &shader_idname);
+
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    // Program from saved binary, 0 if there is none or it is rejected.
+    unsigned load(const std::string &shader_idname, const std::filesystem::path &binary_path);
+    void save(unsigned program, const std::filesystem::path &binary_path);
+
+    std::unique_ptr<ProgramGl> m_gl;
+    std::filesystem::path m_shaders_root;
+    std::filesystem::path m_binaries_dir; // of this driver, empty if not persisted.
+    std::unordered_map<uint64_t, std::shared_ptr<ShaderProgram>> m_programs; // by sources hash
+    Stats m_stats;
+};
+
+} // namespace shader_program
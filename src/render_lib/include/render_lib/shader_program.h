@@ -1,12 +1,14 @@
+#include <cassert>
 #include <errno.h>
 #include <filesystem>
 #include <fstream>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <unordered_map>
 
 #include "common/log.h"
 #include "glad/glad.h"
+#include "render_lib/gl_state.h"
 
 #pragma once
 
@@ -15,104 +17,168 @@ namespace shader_program {
 namespace {
 // todo: use Expected.
 bool load_file_content(std::filesystem::path fpath, std::string &out_data) {
-    std::ifstream fs(fpath);
+    std::ifstream fs(fpath, std::ios::binary | std::ios::ate);
     if (!fs) {
         log_err("failed opening file: {}; error: {} ({})", fpath, strerror(errno), errno);
         return false;
     }
-    std::stringstream data_s;
-    data_s << fs.rdbuf();
-    out_data = data_s.str();
+    // Sized read straight into the string, no intermediate stream copy.
+    out_data.resize(static_cast<size_t>(fs.tellg()));
+    fs.seekg(0);
+    if (!fs.read(out_data.data(), out_data.size())) {
+        log_err("failed reading file: {}", fpath);
+        return false;
+    }
     return true;
 }
 } // namespace
 
+// Name and binding point of the uniform block with camera of the frame,
+// filled by render::FrameUniforms.
+constexpr const char *FRAME_BLOCK_NAME = "Frame";
+constexpr unsigned FRAME_BLOCK_BINDING = 0;
+
 struct ShaderProgram {
+    using locations_t = std::unordered_map<std::string, int>;
+
     unsigned id = ~0u;
 
-    ShaderProgram(unsigned id) : id(id) {}
+    ShaderProgram(unsigned id, locations_t locations = {})
+        : id(id), m_locations(std::move(locations)) {}
+
+    // Resolved once after linking, -1 for a uniform the program doesn't have
+    // (or the driver optimized out), as glGetUniformLocation. Arrays are
+    // found by name without [0].
+    int location(const std::string &name) const {
+        auto it = m_locations.find(name);
+        return it == m_locations.end() ? -1 : it->second;
+    }
 
     bool compile() { return false; }
 
+    // Stays bound after drawing, see render::use_program().
     void attach() {
         assert(this->id != ~0u);
-        glUseProgram(this->id);
+        render::use_program(this->id);
     }
-    void detach() { glUseProgram(0); }
 
     ShaderProgram(const ShaderProgram &) = delete;
     ShaderProgram &operator=(const ShaderProgram &) = delete;
+
+  private:
+    locations_t m_locations;
 };
 
+// Binds the frame uniform block of a linked program and returns locations of
+// its uniforms. Needed after every link or binary load, both reset block
+// bindings.
+inline ShaderProgram::locations_t prepare_linked(unsigned program_id) {
+    const unsigned frame_block = glGetUniformBlockIndex(program_id, FRAME_BLOCK_NAME);
+    if (frame_block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program_id, frame_block, FRAME_BLOCK_BINDING);
+    }
+
+    ShaderProgram::locations_t locations;
+    int count = 0;
+    glGetProgramiv(program_id, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; ++i) {
+        char name[256];
+        int length = 0, size = 0;
+        unsigned type = 0;
+        glGetActiveUniform(program_id, i, sizeof(name), &length, &size, &type, name);
+        std::string uniform(name, length);
+        if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0) {
+            uniform.resize(uniform.size() - 3);
+        }
+        const int location = glGetUniformLocation(program_id, name);
+        if (location >= 0) { // members of blocks have none.
+            locations.emplace(std::move(uniform), location);
+        }
+    }
+    return locations;
+}
+
 // We expect that shaders put in folder <fpath> and have a name like
 // <shader_idname>.vert.glsl, <shader_idname>.frag.glsl.
-inline std::unique_ptr<ShaderProgram> make_from_fs_bundle(std::string fpath,
-                                                          std::string shader_idname) {
+inline bool load_fs_bundle(std::string fpath, std::string shader_idname, std::string &v_shader_src,
+                           std::string &f_shader_src) {
     using path_t = std::filesystem::path;
-    auto base_path = path_t{fpath} / shader_idname;
-
-    std::string v_shader_src;
     if (!load_file_content(path_t{fpath} / (shader_idname + ".vert.glsl"), v_shader_src)) {
         log_err("failed loading file content of vertex shader for program: <{}>", shader_idname);
-        return nullptr;
+        return false;
     }
-
-    std::string f_shader_src;
     if (!load_file_content(path_t{fpath} / (shader_idname + ".frag.glsl"), f_shader_src)) {
         log_err("failed loading file content of fragment shader for program: <{}>", shader_idname);
-        return nullptr;
+        return false;
     }
+    return true;
+}
 
+inline unsigned compile_shader(unsigned type, const std::string &src,
+                               const std::string &shader_idname) {
+    unsigned shader_id = glCreateShader(type);
+    const char *src_cstr = src.c_str();
+    glShaderSource(shader_id, 1, &src_cstr, NULL);
+    glCompileShader(shader_id);
     int result = 0;
-    unsigned v_shader_id, f_shader_id;
-    {
-        v_shader_id = glCreateShader(GL_VERTEX_SHADER);
-        const char *v_shader_src_cstr = v_shader_src.c_str();
-        glShaderSource(v_shader_id, 1, &v_shader_src_cstr, NULL);
-        glCompileShader(v_shader_id);
-        glGetShaderiv(v_shader_id, GL_COMPILE_STATUS, &result);
-        if (!result) {
-            char details[1024];
-            glGetShaderInfoLog(v_shader_id, sizeof(details), NULL, details);
-            log_err("failed compiling vertex shader for program <{}>, compilation "
-                    "error:\n{}",
-                    shader_idname, details);
-            return nullptr;
-        }
+    glGetShaderiv(shader_id, GL_COMPILE_STATUS, &result);
+    if (!result) {
+        char details[1024];
+        glGetShaderInfoLog(shader_id, sizeof(details), NULL, details);
+        log_err("failed compiling {} shader for program <{}>, compilation error:\n{}",
+                type == GL_VERTEX_SHADER ? "vertex" : "fragment", shader_idname, details);
+        glDeleteShader(shader_id);
+        return 0;
     }
+    return shader_id;
+}
 
-    {
-        f_shader_id = glCreateShader(GL_FRAGMENT_SHADER);
-        const char *f_shader_src_cstr = f_shader_src.c_str();
-        glShaderSource(f_shader_id, 1, &f_shader_src_cstr, NULL);
-        glCompileShader(f_shader_id);
-        glGetShaderiv(f_shader_id, GL_COMPILE_STATUS, &result);
-        if (!result) {
-            char details[1024];
-            glGetShaderInfoLog(f_shader_id, sizeof(details), NULL, details);
-            log_err("failed compiling fragment shader for program <{}>, compilation "
-                    "error: {}",
-                    shader_idname, details);
-            return nullptr;
-        }
+// Compiles the sources and links them into program created by the caller, so
+// it can set program parameters before linking.
+inline bool compile_and_link(unsigned program_id, const std::string &v_shader_src,
+                             const std::string &f_shader_src, const std::string &shader_idname) {
+    unsigned v_shader_id = compile_shader(GL_VERTEX_SHADER, v_shader_src, shader_idname);
+    if (!v_shader_id) {
+        return false;
+    }
+    unsigned f_shader_id = compile_shader(GL_FRAGMENT_SHADER, f_shader_src, shader_idname);
+    if (!f_shader_id) {
+        glDeleteShader(v_shader_id);
+        return false;
     }
 
-    auto shader_program_id = glCreateProgram();
-    glAttachShader(shader_program_id, v_shader_id);
-    glAttachShader(shader_program_id, f_shader_id);
-    glLinkProgram(shader_program_id);
-    glGetProgramiv(shader_program_id, GL_LINK_STATUS, &result);
+    glAttachShader(program_id, v_shader_id);
+    glAttachShader(program_id, f_shader_id);
+    glLinkProgram(program_id);
+    // Flagged for deletion, freed with the program.
+    glDeleteShader(v_shader_id);
+    glDeleteShader(f_shader_id);
+
+    int result = 0;
+    glGetProgramiv(program_id, GL_LINK_STATUS, &result);
     if (!result) {
         char details[1024];
-        glGetProgramInfoLog(shader_program_id, sizeof(details), NULL, details);
+        glGetProgramInfoLog(program_id, sizeof(details), NULL, details);
         log_err("failed linking shader program <{}>:\n {}", shader_idname, details);
-        return nullptr;
+        return false;
     }
+    return true;
+}
 
-    glDeleteShader(v_shader_id);
-    glDeleteShader(f_shader_id);
-
-    return std::make_unique<ShaderProgram>(shader_program_id);
+// Compiles a new program every call, units get shared programs from
+// ShaderCache instead.
+inline std::unique_ptr<ShaderProgram> make_from_fs_bundle(std::string fpath,
+                                                          std::string shader_idname) {
+    std::string v_shader_src, f_shader_src;
+    if (!load_fs_bundle(fpath, shader_idname, v_shader_src, f_shader_src)) {
+        return nullptr;
+    }
+    auto shader_program_id = glCreateProgram();
+    if (!compile_and_link(shader_program_id, v_shader_src, f_shader_src, shader_idname)) {
+        glDeleteProgram(shader_program_id);
+        return nullptr;
+    }
+    return std::make_unique<ShaderProgram>(shader_program_id, prepare_linked(shader_program_id));
 }
 
-} // namespace shader_program
\ No newline at end of file
+} // namespace shader_program
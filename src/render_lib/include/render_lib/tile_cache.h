@@ -0,0 +1,86 @@
+#pragma once
+
+#include <common/global.h>
+#include <functional>
+#include <limits>
+#include <list>
+#include <unordered_map>
+
+namespace render {
+
+// Decides which tiles stay resident under CPU and GPU memory budgets. The
+// cache only does bookkeeping: the owner uploads tiles, reports their sizes
+// with insert() and frees them when evict callback is called.
+//
+// Every frame the owner calls begin_frame() and then touch() for each tile it
+// wants to draw. Tiles are evicted least recently touched first, tiles
+// touched in the current frame are never evicted, so budget is a hard
+// ceiling: a tile which doesn't fit without evicting visible ones is
+// rejected.
+class TileCache {
+  public:
+    struct Budget {
+        size_t cpu_bytes = std::numeric_limits<size_t>::max();
+        size_t gpu_bytes = std::numeric_limits<size_t>::max();
+    };
+
+    struct Stats {
+        size_t hits = 0;   // touch() of a cached tile.
+        size_t misses = 0; // touch() of a tile not in cache.
+        size_t evictions = 0;
+        size_t rejected = 0; // insert() which did not fit.
+        size_t tiles = 0;
+        size_t cpu_bytes = 0;
+        size_t gpu_bytes = 0;
+    };
+
+    // Called for every evicted tile, owner frees its memory.
+    using evict_fn = std::function<void(gg::tile_at_level_t)>;
+
+    TileCache(Budget budget, evict_fn evict);
+
+    void begin_frame();
+    // Marks tile used in this frame, true if it is cached.
+    bool touch(gg::tile_at_level_t tile);
+    // Marks the closest cached ancestor of a missing tile used, so it stays
+    // as fallback while the tile streams in. Counts neither hit nor miss.
+    optional<gg::tile_at_level_t> touch_fallback(gg::tile_at_level_t tile);
+    bool contains(gg::tile_at_level_t tile) const;
+
+    // Makes room for the tile and marks it used. False if it doesn't fit
+    // even after evicting all tiles not used in this frame, then the owner
+    // must drop it. Inserting a cached tile updates its sizes.
+    bool insert(gg::tile_at_level_t tile, size_t cpu_bytes, size_t gpu_bytes);
+    // Evicts tiles not used in this frame until cache fits the new budget.
+    void set_budget(Budget budget);
+
+    const Budget &budget() const { return m_budget; }
+    const Stats &stats() const { return m_stats; }
+
+  private:
+    struct Entry {
+        gg::tile_at_level_t tile;
+        size_t cpu_bytes;
+        size_t gpu_bytes;
+        uint64_t last_frame;
+    };
+    using lru_t = std::list<Entry>; // most recently used first.
+
+    void use(lru_t::iterator it);
+    bool fits(size_t cpu_bytes, size_t gpu_bytes) const;
+    // Evicts until extra bytes fit the budget. False without evicting
+    // anything if they don't fit even then, tiles of this frame are in the way.
+    bool make_room(size_t cpu_bytes, size_t gpu_bytes);
+    // Evicts tiles not used in this frame while extra bytes don't fit.
+    void evict_to_fit(size_t cpu_bytes, size_t gpu_bytes);
+    void erase(lru_t::iterator it);
+
+    Budget m_budget;
+    evict_fn m_evict;
+    uint64_t m_frame = 0;
+    lru_t m_lru;
+    std::unordered_map<uint64_t, lru_t::iterator> m_entries; // by gg::tile_key
+    Stats m_stats;
+};
+
+} // namespace render
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <common/global.h>
+#include <common/log.h>
+#include <common/parallel.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+namespace render {
+
+// Queue of many producers and one consumer which never blocks either side.
+// Producers push onto an intrusive stack with CAS, the consumer takes the
+// whole stack with one exchange. Nodes are never popped one by one, so there
+// is no ABA problem.
+template <class T> class CompletionQueue {
+  public:
+    CompletionQueue() = default;
+    ~CompletionQueue() { take_all(); }
+
+    CompletionQueue(const CompletionQueue &) = delete;
+    CompletionQueue &operator=(const CompletionQueue &) = delete;
+
+    void push(T value) {
+        Node *node = new Node{std::move(value), m_head.load(std::memory_order_relaxed)};
+        while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+        }
+    }
+
+    // Consumer only. Values pushed by one thread keep their order.
+    vector<T> take_all() {
+        Node *node = m_head.exchange(nullptr, std::memory_order_acquire);
+        vector<T> res;
+        while (node) {
+            res.push_back(std::move(node->value));
+            Node *next = node->next;
+            delete node;
+            node = next;
+        }
+        std::reverse(res.begin(), res.end());
+        return res;
+    }
+
+  private:
+    struct Node {
+        T value;
+        Node *next;
+    };
+    std::atomic<Node *> m_head{nullptr};
+};
+
+// Limits work upload() does in one frame.
+struct UploadBudget {
+    size_t bytes = 4 * 1024 * 1024;
+    steady_clock::duration time = 2ms;
+};
+
+// World units between centers of the tile and p.
+inline double tile_distance(gg::tile_at_level_t tile, p32 p) {
+    const gg::gbb_t bb = gg::tile_bb(tile);
+    const double cx = bb.top_left.x + bb.width / 2.0;
+    const double cy = bb.top_left.y + bb.height / 2.0;
+    return std::hypot(cx - p.x, cy - p.y);
+}
+
+// Loads tiles on a pool of worker threads and hands them to the render
+// thread in portions which fit a per-frame budget, so however much data
+// arrives at once a frame is never stalled by uploading it.
+//
+// request() and upload() are called by the render thread only. Payload is
+// whatever load function produces off the render thread: decoded or
+// tessellated geometry ready to be copied into GPU buffers.
+template <class Payload> class TileStreamer {
+  public:
+    // Runs on workers. Tiles whose loading throws are not loaded again.
+    using load_fn = std::function<Payload(gg::tile_at_level_t)>;
+    // Runs on the render thread, returns bytes uploaded.
+    using upload_fn = std::function<size_t(gg::tile_at_level_t, Payload &)>;
+
+    struct Stats {
+        size_t queued = 0;
+        size_t loading = 0;   // by workers or waiting for upload.
+        size_t completed = 0; // loaded or failed, not taken by upload() yet.
+        size_t failed = 0;
+        size_t uploaded = 0;
+        size_t uploaded_bytes = 0;
+    };
+
+    explicit TileStreamer(load_fn load,
+                          size_t workers = std::max<size_t>(parallel::default_concurrency() - 1, 1))
+        : m_load(std::move(load)) {
+        for (size_t i = 0; i < workers; ++i) {
+            m_workers.emplace_back([this] { work(); });
+        }
+    }
+
+    // Tiles being loaded are finished first.
+    ~TileStreamer() {
+        {
+            auto lock = std::unique_lock(m_mutex);
+            m_stop = true;
+        }
+        m_wakeup.notify_all();
+        for (auto &w : m_workers) {
+            w.join();
+        }
+    }
+
+    TileStreamer(const TileStreamer &) = delete;
+    TileStreamer &operator=(const TileStreamer &) = delete;
+
+    // Replaces queued requests with tiles, workers take the closest to focus
+    // first. Tiles already being loaded or waiting for upload are skipped, so
+    // the caller can request everything it misses every frame. Uploaded tiles
+    // are not tracked, they are loaded again if requested.
+    void request(span<const gg::tile_at_level_t> tiles, p32 focus) {
+        m_focus = focus;
+        vector<Request> queue;
+        queue.reserve(tiles.size());
+        {
+            auto lock = std::unique_lock(m_mutex);
+            for (auto t : tiles) {
+                const uint64_t key = gg::tile_key(t);
+                if (!m_loading.count(key) && !m_failed.count(key)) {
+                    queue.push_back({t, tile_distance(t, focus)});
+                }
+            }
+            // closest at the back.
+            std::sort(queue.begin(), queue.end(),
+                      [](const Request &a, const Request &b) { return a.distance > b.distance; });
+            m_queue = std::move(queue);
+        }
+        m_wakeup.notify_all();
+    }
+
+    // Uploads loaded tiles closest to the last requested focus first until
+    // budget is spent. At least one tile is uploaded when there is any, so
+    // tiles bigger than the budget arrive too. Returns tiles uploaded.
+    size_t upload(const upload_fn &upload, const UploadBudget &budget) {
+        collect();
+        // focus could have moved since tiles were loaded.
+        std::sort(m_ready.begin(), m_ready.end(), [this](const Loaded &a, const Loaded &b) {
+            return tile_distance(a.tile, m_focus) > tile_distance(b.tile, m_focus);
+        });
+        const auto start = steady_clock::now();
+        size_t bytes = 0;
+        size_t uploaded = 0;
+        while (!m_ready.empty() &&
+               (uploaded == 0 ||
+                (bytes < budget.bytes && steady_clock::now() - start < budget.time))) {
+            Loaded tile = std::move(m_ready.back());
+            m_ready.pop_back();
+            bytes += upload(tile.tile, *tile.payload);
+            uploaded++;
+            auto lock = std::unique_lock(m_mutex);
+            m_loading.erase(gg::tile_key(tile.tile));
+        }
+        m_stats.uploaded += uploaded;
+        m_stats.uploaded_bytes += bytes;
+        return uploaded;
+    }
+
+    Stats stats() const {
+        auto lock = std::unique_lock(m_mutex);
+        Stats res = m_stats;
+        res.queued = m_queue.size();
+        res.loading = m_loading.size();
+        res.failed = m_failed.size();
+        res.completed = m_completed_count;
+        return res;
+    }
+
+  private:
+    struct Request {
+        gg::tile_at_level_t tile;
+        double distance;
+    };
+
+    struct Loaded {
+        gg::tile_at_level_t tile;
+        optional<Payload> payload; // empty if loading failed.
+    };
+
+    void work() {
+        while (true) {
+            gg::tile_at_level_t tile;
+            {
+                auto lock = std::unique_lock(m_mutex);
+                m_wakeup.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                if (m_stop) {
+                    return;
+                }
+                tile = m_queue.back().tile;
+                m_queue.pop_back();
+                m_loading.insert(gg::tile_key(tile));
+            }
+            Loaded loaded{tile, std::nullopt};
+            try {
+                loaded.payload = m_load(tile);
+            } catch (const std::exception &e) {
+                log_err("failed loading tile {}:{}:{}: {}", tile.level, tile.id.x, tile.id.y,
+                        e.what());
+            }
+            // Counted first, collect() may take the tile as soon as it is
+            // pushed and decrement before an increment after the push.
+            m_completed_count++;
+            m_completed.push(std::move(loaded));
+        }
+    }
+
+    // Moves completed tiles to m_ready.
+    void collect() {
+        for (auto &c : m_completed.take_all()) {
+            m_completed_count--;
+            if (c.payload) {
+                m_ready.push_back(std::move(c));
+            } else {
+                auto lock = std::unique_lock(m_mutex);
+                m_loading.erase(gg::tile_key(c.tile));
+                m_failed.insert(gg::tile_key(c.tile));
+            }
+        }
+    }
+
+    load_fn m_load;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    bool m_stop = false;
+    vector<Request> m_queue;                // closest at the back.
+    std::unordered_set<uint64_t> m_loading; // taken by workers, not uploaded yet.
+    std::unordered_set<uint64_t> m_failed;
+
+    CompletionQueue<Loaded> m_completed;
+    std::atomic<size_t> m_completed_count{0}; // counted before the push.
+
+    // Render thread only.
+    vector<Loaded> m_ready; // closest at the back after sorting in upload().
+    p32 m_focus = p32(0, 0);
+    Stats m_stats;
+
+    vector<std::thread> m_workers; // last, so they start with everything initialized.
+};
+
+} // namespace render
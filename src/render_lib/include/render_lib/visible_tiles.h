@@ -0,0 +1,41 @@
+#pragma once
+
+#include <common/global.h>
+
+#include "camera.h"
+
+namespace camera {
+
+// Tiles of one level in [min_x, max_x] x [min_y, max_y].
+struct TileRect {
+    uint32_t level;
+    uint32_t min_x, min_y, max_x, max_y;
+
+    bool contains(gg::tile_at_level_t tile) const {
+        return tile.level == level && tile.id.x >= min_x && tile.id.x <= max_x &&
+               tile.id.y >= min_y && tile.id.y <= max_y;
+    }
+};
+
+// Tiles of `level` which intersect the view. For rotated camera bounding box
+// of the view in world coordinates is used, so result is conservative.
+TileRect visible_tiles(const Cam2d &cam, uint32_t level);
+
+// Tiles which together cover `visible` exactly once: tiles of visible.level,
+// except where no tile of `resident` lies below a coarser tile, which then
+// stands for all its visible descendants. Closest resident ancestor of a
+// result tile (itself included) is what is to be drawn for it. Work is
+// bounded by resident tiles rather than by the rect, for a fine level zoomed
+// out with few tiles loaded.
+void covering_tiles(const TileRect &visible, span<const gg::tile_at_level_t> resident,
+                    vector<gg::tile_at_level_t> &out);
+
+// Finest level whose tiles on screen are at least half of the larger window
+// side. Finer tiles cull tighter but cost more draw calls.
+uint32_t level_for_zoom(const Cam2d &cam);
+
+// Of ascending non-empty levels: wanted if it is there, otherwise the closest
+// coarser one, otherwise the coarsest.
+uint32_t closest_level(span<const uint32_t> levels, uint32_t wanted);
+
+} // namespace camera
@@ -0,0 +1,239 @@
+#include <render_lib/profiler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <common/gl_check.h>
+#include <fmt/format.h>
+#include <imgui/imgui.h>
+#include <numeric>
+
+namespace render {
+
+namespace {
+class GlTimer : public TimerGl {
+  public:
+    unsigned create_query() override {
+        unsigned query = 0;
+        GL_CHECK(glGenQueries(1, &query));
+        return query;
+    }
+
+    void delete_query(unsigned query) override { GL_CHECK(glDeleteQueries(1, &query)); }
+
+    void begin(unsigned query) override { GL_CHECK(glBeginQuery(GL_TIME_ELAPSED, query)); }
+
+    void end() override { GL_CHECK(glEndQuery(GL_TIME_ELAPSED)); }
+
+    bool result(unsigned query, uint64_t &ns) override {
+        GLint available = 0;
+        GL_CHECK(glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available));
+        if (!available) {
+            return false;
+        }
+        GLuint64 elapsed = 0;
+        GL_CHECK(glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed));
+        ns = elapsed;
+        return true;
+    }
+};
+
+// Queries which are never begun, so there are no results to read.
+class NullTimer : public TimerGl {
+  public:
+    unsigned create_query() override { return 0; }
+    void delete_query(unsigned) override {}
+    void begin(unsigned) override {}
+    void end() override {}
+    bool result(unsigned, uint64_t &) override { return false; }
+};
+
+// Quoted if it has to be, names are written by hand and may have commas.
+std::string csv_field(const std::string &s) {
+    if (s.find_first_of(",\"\n") == std::string::npos) {
+        return s;
+    }
+    std::string res = "\"";
+    for (char c : s) {
+        res += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return res + "\"";
+}
+
+std::string json_string(const std::string &s) {
+    std::string res = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            res += '\\';
+            res += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            res += fmt::format("\\u{:04x}", static_cast<int>(c));
+        } else {
+            res += c;
+        }
+    }
+    return res + "\"";
+}
+
+std::string json_summary(const Profiler::Summary &s) {
+    return fmt::format("{{\"min\": {:.4f}, \"avg\": {:.4f}, \"p99\": {:.4f}, \"samples\": {}}}",
+                       s.min, s.avg, s.p99, s.samples);
+}
+} // namespace
+
+std::unique_ptr<TimerGl> make_timer_gl() { return std::make_unique<GlTimer>(); }
+
+std::unique_ptr<TimerGl> make_null_timer_gl() { return std::make_unique<NullTimer>(); }
+
+void Profiler::Series::push(double value, size_t window) {
+    if (values.size() < window) {
+        values.push_back(value);
+        return;
+    }
+    values[next] = value;
+    next = (next + 1) % window;
+}
+
+Profiler::Summary Profiler::Series::summary() const {
+    Summary res;
+    res.samples = values.size();
+    if (values.empty()) {
+        return res;
+    }
+    vector<double> sorted = values;
+    // Nearest rank, the worst sample of the window up to 100 samples.
+    const size_t rank = static_cast<size_t>(std::ceil(sorted.size() * 0.99)) - 1;
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    res.p99 = sorted[rank];
+    res.min = *std::min_element(values.begin(), values.end());
+    res.avg = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+    return res;
+}
+
+Profiler::Profiler(std::unique_ptr<TimerGl> gl, size_t window)
+    : m_gl(std::move(gl)), m_window(std::max<size_t>(window, 1)) {}
+
+Profiler::~Profiler() {
+    for (auto &scope : m_scopes) {
+        for (unsigned query : scope.queries) {
+            m_gl->delete_query(query);
+        }
+    }
+}
+
+Profiler::scope_id Profiler::add_scope(std::string name) {
+    Scope &scope = m_scopes.emplace_back();
+    scope.name = std::move(name);
+    for (unsigned &query : scope.queries) {
+        query = m_gl->create_query();
+    }
+    return m_scopes.size() - 1;
+}
+
+void Profiler::collect(Scope &scope, size_t slot) {
+    uint64_t ns = 0;
+    if (scope.pending[slot] && m_gl->result(scope.queries[slot], ns)) {
+        scope.gpu.push(ns / 1e6, m_window);
+        scope.pending[slot] = false;
+    }
+}
+
+void Profiler::begin_frame() {
+    assert(!m_running && "scope is still running");
+    m_slot = (m_slot + 1) % QUERY_FRAMES;
+    for (auto &scope : m_scopes) {
+        // Oldest first, the slot of this frame was issued QUERY_FRAMES ago.
+        for (size_t i = 0; i < QUERY_FRAMES; ++i) {
+            collect(scope, (m_slot + i) % QUERY_FRAMES);
+        }
+    }
+}
+
+void Profiler::begin(scope_id id) {
+    assert(!m_running && "scopes can't nest");
+    Scope &scope = m_scopes[id];
+    // Slot still in flight, GPU is more than QUERY_FRAMES behind.
+    scope.gpu_timed = !scope.pending[m_slot];
+    if (scope.gpu_timed) {
+        m_gl->begin(scope.queries[m_slot]);
+    }
+    m_running = id;
+    m_start = steady_clock::now();
+}
+
+void Profiler::end() {
+    assert(m_running && "no scope is running");
+    const std::chrono::duration<double, std::milli> cpu = steady_clock::now() - m_start;
+    Scope &scope = m_scopes[*m_running];
+    if (scope.gpu_timed) {
+        m_gl->end();
+        scope.pending[m_slot] = true;
+    }
+    record_cpu(*m_running, cpu.count());
+    m_running.reset();
+}
+
+void Profiler::record_cpu(scope_id id, double ms) {
+    m_scopes[id].cpu.push(ms, m_window);
+    m_scopes[id].count++;
+}
+
+Profiler::ScopeStats Profiler::stats(scope_id id) const {
+    const Scope &scope = m_scopes[id];
+    return ScopeStats{scope.cpu.summary(), scope.gpu.summary(), scope.count};
+}
+
+void Profiler::render_gui() const {
+    constexpr ImGuiTableFlags flags =
+        ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders | ImGuiTableFlags_SizingFixedFit;
+    if (!ImGui::BeginTable("profiler", 7, flags)) {
+        return;
+    }
+    for (const char *column :
+         {"scope", "cpu min", "cpu avg", "cpu p99", "gpu min", "gpu avg", "gpu p99"}) {
+        ImGui::TableSetupColumn(column);
+    }
+    ImGui::TableHeadersRow();
+    for (scope_id id = 0; id < m_scopes.size(); ++id) {
+        const ScopeStats s = stats(id);
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(m_scopes[id].name.c_str());
+        for (const Summary *summary : {&s.cpu_ms, &s.gpu_ms}) {
+            for (double ms : {summary->min, summary->avg, summary->p99}) {
+                ImGui::TableNextColumn();
+                if (summary->samples) {
+                    ImGui::Text("%.3f", ms);
+                } else {
+                    ImGui::TextDisabled("-");
+                }
+            }
+        }
+    }
+    ImGui::EndTable();
+}
+
+void Profiler::write_csv(std::ostream &os) const {
+    os << "scope,cpu_min_ms,cpu_avg_ms,cpu_p99_ms,cpu_samples,"
+          "gpu_min_ms,gpu_avg_ms,gpu_p99_ms,gpu_samples\n";
+    for (scope_id id = 0; id < m_scopes.size(); ++id) {
+        const ScopeStats s = stats(id);
+        os << fmt::format("{},{:.4f},{:.4f},{:.4f},{},{:.4f},{:.4f},{:.4f},{}\n",
+                          csv_field(m_scopes[id].name), s.cpu_ms.min, s.cpu_ms.avg, s.cpu_ms.p99,
+                          s.cpu_ms.samples, s.gpu_ms.min, s.gpu_ms.avg, s.gpu_ms.p99,
+                          s.gpu_ms.samples);
+    }
+}
+
+void Profiler::write_json(std::ostream &os) const {
+    os << fmt::format("{{\"window\": {}, \"scopes\": [", m_window);
+    for (scope_id id = 0; id < m_scopes.size(); ++id) {
+        const ScopeStats s = stats(id);
+        os << fmt::format("{}\n  {{\"name\": {}, \"count\": {}, \"cpu_ms\": {}, \"gpu_ms\": {}}}",
+                          id ? "," : "", json_string(m_scopes[id].name), s.count,
+                          json_summary(s.cpu_ms), json_summary(s.gpu_ms));
+    }
+    os << "\n]}\n";
+}
+
+} // namespace render
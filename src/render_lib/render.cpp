@@ -0,0 +1,97 @@
+#include <render_lib/render.h>
+
+#include <algorithm>
+#include <imgui/imgui.h>
+#include <tuple>
+
+namespace render {
+
+Render::Render(Profiler &profiler) : m_profiler(profiler) {}
+
+Render::layer_id Render::add_layer(std::string name, IRenderUnit &unit, int z, update_fn update) {
+    Layer layer;
+    layer.name = std::move(name);
+    layer.unit = &unit;
+    layer.z = z;
+    layer.update = std::move(update);
+    layer.scope = m_profiler.add_scope(layer.name);
+    m_layers.push_back(std::move(layer));
+    m_order_dirty = true;
+    return m_layers.size() - 1;
+}
+
+void Render::set_enabled(layer_id layer, bool enabled) {
+    if (m_layers[layer].enabled != enabled) {
+        m_layers[layer].enabled = enabled;
+        m_order_dirty = true;
+    }
+}
+
+void Render::set_z(layer_id layer, int z) {
+    if (m_layers[layer].z != z) {
+        m_layers[layer].z = z;
+        m_order_dirty = true;
+    }
+}
+
+const vector<Render::layer_id> &Render::draw_order() {
+    for (auto &l : m_layers) {
+        // Units can switch programs on shader reload or vao on reupload.
+        if (l.enabled && (l.program != l.unit->program() || l.vao != l.unit->vao())) {
+            m_order_dirty = true;
+        }
+    }
+    if (m_order_dirty) {
+        rebuild_order();
+    }
+    return m_order;
+}
+
+void Render::rebuild_order() {
+    m_order.clear();
+    for (layer_id i = 0; i < m_layers.size(); ++i) {
+        Layer &l = m_layers[i];
+        if (l.enabled) {
+            l.program = l.unit->program();
+            l.vao = l.unit->vao();
+            m_order.push_back(i);
+        }
+    }
+    // Stable, so equal layers keep the order they were added in.
+    std::stable_sort(m_order.begin(), m_order.end(), [this](layer_id a, layer_id b) {
+        const Layer &la = m_layers[a];
+        const Layer &lb = m_layers[b];
+        return std::tie(la.z, la.program, la.vao) < std::tie(lb.z, lb.program, lb.vao);
+    });
+    m_order_dirty = false;
+}
+
+void Render::render_frame(const camera::Cam2d &cam) {
+    for (layer_id id : draw_order()) {
+        Layer &l = m_layers[id];
+        Profiler::Timer timer(m_profiler, l.scope);
+        if (l.update) {
+            l.update(cam);
+        }
+        l.unit->render_frame(cam);
+    }
+}
+
+void Render::render_gui() {
+    for (layer_id i = 0; i < m_layers.size(); ++i) {
+        Layer &l = m_layers[i];
+        bool enabled = l.enabled;
+        ImGui::PushID(static_cast<int>(i));
+        if (ImGui::Checkbox(l.name.c_str(), &enabled)) {
+            set_enabled(i, enabled);
+        }
+        if (enabled) {
+            ImGui::SameLine();
+            const Profiler::ScopeStats stats = m_profiler.stats(l.scope);
+            ImGui::TextDisabled("cpu %.2f ms, gpu %.2f ms", stats.cpu_ms.avg, stats.gpu_ms.avg);
+        }
+        ImGui::PopID();
+    }
+}
+
+} // namespace render
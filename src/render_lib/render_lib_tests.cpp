@@ -0,0 +1,1031 @@
+#include "common/log.h"
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/gpu_heap.h"
+#include "render_lib/profiler.h"
+#include "render_lib/render.h"
+#include "render_lib/shader_cache.h"
+#include "render_lib/tile_cache.h"
+#include "render_lib/tile_streamer.h"
+#include "render_lib/visible_tiles.h"
+#include "render_units/roads/tesselation.h"
+#include "render_units/roads_shader_aa/extrude_batch.h"
+#include "render_units/roads_shader_aa/make_geometry.h"
+#include "render_units/roads_shader_aa/packed_vertex.h"
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <gtest/gtest.h>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+
+namespace {
+using gg::simd::Isa;
+
+bool same_bits(v2 a, v2 b) { return std::memcmp(&a, &b, sizeof(v2)) == 0; }
+
+// GL which executes copies lazily, as GPU does: only when a fence after them
+// is waited for or on finish(). Staging memory overwritten before its copy
+// is executed ends up in the destination buffer.
+class MockStreamingGl : public render::StreamingGl {
+  public:
+    using storage_t = std::shared_ptr<vector<uint8_t>>;
+
+    MockStreamingGl(bool buffer_storage, bool persistent_fails = false)
+        : m_buffer_storage(buffer_storage), m_persistent_fails(persistent_fails) {}
+
+    bool has_buffer_storage() const override { return m_buffer_storage; }
+    unsigned create_buffer() override {
+        buffers[++m_last_buffer] = std::make_shared<vector<uint8_t>>();
+        return m_last_buffer;
+    }
+    void delete_buffer(unsigned buffer) override { buffers.erase(buffer); }
+    uint8_t *create_persistent(unsigned buffer, size_t size) override {
+        if (m_persistent_fails) {
+            return nullptr;
+        }
+        buffers[buffer]->resize(size);
+        return buffers[buffer]->data();
+    }
+    void orphan(unsigned buffer, size_t size) override {
+        buffers[buffer] = std::make_shared<vector<uint8_t>>(size);
+    }
+    uint8_t *map_range(unsigned buffer, size_t offset, size_t size) override {
+        EXPECT_LE(offset + size, buffers[buffer]->size());
+        return buffers[buffer]->data() + offset;
+    }
+    void unmap(unsigned) override {}
+    void copy(unsigned src, size_t src_offset, unsigned dst, size_t dst_offset,
+              size_t size) override {
+        m_commands.push_back({Copy{buffers[src], src_offset, dst, dst_offset, size}, 0});
+    }
+    sync_t fence() override {
+        fences_created++;
+        m_commands.push_back({{}, ++m_last_fence});
+        return reinterpret_cast<sync_t>(m_last_fence);
+    }
+    WaitResult wait(sync_t sync) override {
+        const auto fence = reinterpret_cast<uintptr_t>(sync);
+        const bool pending = std::any_of(m_commands.begin(), m_commands.end(),
+                                         [&](const Command &c) { return c.fence == fence; });
+        if (!pending) {
+            return WaitResult::already_signaled;
+        }
+        if (fail_waits) {
+            return WaitResult::failed;
+        }
+        while (m_commands.front().fence != fence) {
+            execute(m_commands.front());
+            m_commands.pop_front();
+        }
+        m_commands.pop_front();
+        return WaitResult::signaled;
+    }
+    void delete_sync(sync_t) override { fences_deleted++; }
+
+    void finish() {
+        for (; !m_commands.empty(); m_commands.pop_front()) {
+            execute(m_commands.front());
+        }
+    }
+
+    std::map<unsigned, storage_t> buffers;
+    size_t fences_created = 0;
+    size_t fences_deleted = 0;
+    bool fail_waits = false; // waits for pending fences fail, as on timeout.
+
+  private:
+    struct Copy {
+        storage_t src;
+        size_t src_offset;
+        unsigned dst;
+        size_t dst_offset, size;
+    };
+    struct Command {
+        Copy copy;
+        uintptr_t fence; // 0 for copies.
+    };
+
+    void execute(const Command &c) {
+        if (c.fence == 0) {
+            auto &dst = *buffers[c.copy.dst];
+            ASSERT_LE(c.copy.dst_offset + c.copy.size, dst.size());
+            std::memcpy(dst.data() + c.copy.dst_offset, c.copy.src->data() + c.copy.src_offset,
+                        c.copy.size);
+        }
+    }
+
+    bool m_buffer_storage, m_persistent_fails;
+    unsigned m_last_buffer = 0;
+    uintptr_t m_last_fence = 0;
+    std::deque<Command> m_commands;
+};
+
+// Binaries are the program's sources prefixed with the driver name, a driver
+// which doesn't match rejects them.
+class MockProgramGl : public shader_program::ProgramGl {
+  public:
+    explicit MockProgramGl(std::string driver) : m_driver(std::move(driver)) {}
+
+    std::string driver() const override { return m_driver; }
+    bool has_program_binary() const override { return true; }
+    unsigned compile(const std::string &, const std::string &v_src,
+                     const std::string &f_src) override {
+        compiled++;
+        programs[++m_last_program] = v_src + f_src;
+        return m_last_program;
+    }
+    bool get_binary(unsigned program, uint32_t &format, vector<uint8_t> &binary) override {
+        const std::string data = m_driver + programs.at(program);
+        format = 7;
+        binary.assign(data.begin(), data.end());
+        return true;
+    }
+    unsigned load_binary(uint32_t format, span<const uint8_t> binary) override {
+        const std::string data(binary.begin(), binary.end());
+        if (format != 7 || data.compare(0, m_driver.size(), m_driver) != 0) {
+            return 0;
+        }
+        programs[++m_last_program] = data.substr(m_driver.size());
+        return m_last_program;
+    }
+    shader_program::ShaderProgram::locations_t prepare(unsigned program) override {
+        return {{"program", program}};
+    }
+    void delete_program(unsigned program) override { programs.erase(program); }
+
+    std::map<unsigned, std::string> programs; // sources of live programs.
+    size_t compiled = 0;
+
+  private:
+    std::string m_driver;
+    unsigned m_last_program = 0;
+};
+
+// Timer queries whose results are set by the test, 0 until then.
+class MockTimerGl : public render::TimerGl {
+  public:
+    unsigned create_query() override { return ++m_last_query; }
+    void delete_query(unsigned query) override { deleted.push_back(query); }
+    void begin(unsigned query) override {
+        EXPECT_EQ(running, 0u);
+        running = query;
+    }
+    void end() override {
+        EXPECT_NE(running, 0u);
+        began.push_back(running);
+        running = 0;
+    }
+    bool result(unsigned query, uint64_t &ns) override {
+        auto it = results.find(query);
+        if (it == results.end()) {
+            return false;
+        }
+        ns = it->second;
+        results.erase(it);
+        return true;
+    }
+
+    std::map<unsigned, uint64_t> results; // of finished queries.
+    vector<unsigned> began;
+    vector<unsigned> deleted;
+    unsigned running = 0;
+
+  private:
+    unsigned m_last_query = 0;
+};
+
+// Unit which records the order it is drawn in.
+class MockUnit : public IRenderUnit {
+  public:
+    MockUnit(std::string name, vector<std::string> &drawn, unsigned program, unsigned vao = 0)
+        : name(std::move(name)), drawn(drawn), m_program(program), m_vao(vao) {}
+
+    void render_frame(const camera::Cam2d &) override { drawn.push_back(name); }
+    unsigned program() const override { return m_program; }
+    unsigned vao() const override { return m_vao; }
+
+    std::string name;
+    vector<std::string> &drawn;
+    unsigned m_program;
+    unsigned m_vao;
+};
+
+// Random uploads to two buffers, checked against the same writes done on CPU.
+void check_streamed_uploads(MockStreamingGl *gl, render::BufferStreamer &streamer) {
+    std::mt19937 rng(11);
+    vector<uint8_t> expected[2] = {vector<uint8_t>(4096), vector<uint8_t>(1000)};
+    unsigned buffers[2] = {gl->create_buffer(), gl->create_buffer()};
+    for (size_t k = 0; k < 2; ++k) {
+        gl->buffers[buffers[k]]->resize(expected[k].size());
+    }
+    for (size_t i = 0; i < 500; ++i) {
+        const size_t k = rng() % 2;
+        const size_t size = 1 + rng() % (i % 50 == 0 ? 1000 : 100);
+        const size_t offset = rng() % (expected[k].size() - size + 1);
+        vector<uint8_t> data(size);
+        for (auto &b : data) {
+            b = rng();
+        }
+        std::copy(data.begin(), data.end(), expected[k].begin() + offset);
+        streamer.upload<uint8_t>(buffers[k], offset, data);
+        if (rng() % 10 == 0) {
+            streamer.end_frame();
+        }
+    }
+    gl->finish();
+    EXPECT_EQ(*gl->buffers[buffers[0]], expected[0]);
+    EXPECT_EQ(*gl->buffers[buffers[1]], expected[1]);
+    EXPECT_EQ(streamer.stats().uploads, 500);
+}
+} // namespace
+
+TEST(render_lib_tests, miter_points_right_angle) {
+    vector<p32> polyline{p32(0, 0), p32(10, 0), p32(10, 10)};
+    for (auto kernel : {Isa::scalar, Isa::sse2, Isa::avx2}) {
+        v2 miter;
+        ASSERT_EQ(roads_shader_aa::miter_points(polyline, 1.0, &miter, kernel), 3);
+        EXPECT_NEAR(miter.x, 9.0, 1e-9);
+        EXPECT_NEAR(miter.y, 1.0, 1e-9);
+    }
+}
+
+// SIMD kernels repeat the scalar path operation by operation, so they must
+// agree to the last bit, including lanes of the tail and chunk boundaries.
+TEST(render_lib_tests, miter_points_kernels_match_scalar) {
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<uint32_t> step(1000, 200000);
+    std::uniform_real_distribution<double> turn(-2.5, 2.5);
+    for (size_t size : {3, 4, 5, 6, 7, 257, 258, 259, 1001}) {
+        // random walk away from the world origin, same scale as lands.
+        vector<p32> polyline;
+        double x = 1e9, y = 2e9, angle = 0;
+        for (size_t i = 0; i < size; ++i) {
+            polyline.emplace_back(uint32_t(x), uint32_t(y));
+            angle += turn(rng);
+            const double len = step(rng);
+            x += len * std::cos(angle);
+            y += len * std::sin(angle);
+        }
+
+        vector<v2> expected(size - 2);
+        const size_t expected_parallel =
+            roads_shader_aa::miter_points(polyline, 1.5, expected.data(), Isa::scalar);
+        for (auto kernel : {Isa::sse2, Isa::avx2}) {
+            vector<v2> result(size - 2);
+            EXPECT_EQ(roads_shader_aa::miter_points(polyline, 1.5, result.data(), kernel),
+                      expected_parallel);
+            for (size_t i = 0; i < result.size(); ++i) {
+                ASSERT_TRUE(same_bits(result[i], expected[i]))
+                    << "size " << size << " point " << i + 1 << ": " << result[i].x << ","
+                    << result[i].y << " vs " << expected[i].x << "," << expected[i].y;
+            }
+        }
+    }
+}
+
+TEST(render_lib_tests, miter_points_reports_parallel_segments) {
+    vector<p32> polyline;
+    for (uint32_t i = 0; i < 300; ++i) {
+        polyline.emplace_back(1000 + i * 10, 5000 + (i % 2) * 10);
+    }
+    // straight run in the middle of the second chunk.
+    polyline[270] = p32(polyline[269].x + 10, polyline[269].y);
+    polyline[271] = p32(polyline[270].x + 10, polyline[270].y);
+    for (auto kernel : {Isa::scalar, Isa::sse2, Isa::avx2}) {
+        vector<v2> miters(polyline.size() - 2);
+        EXPECT_EQ(roads_shader_aa::miter_points(polyline, 1.0, miters.data(), kernel), 270);
+    }
+}
+
+TEST(render_lib_tests, make_geometry_fills_required_capacity) {
+    vector<p32> polyline{p32(0, 0), p32(100, 0), p32(100, 100), p32(200, 150), p32(300, 100)};
+    const auto capacity = roads_shader_aa::required_capacity(polyline);
+    vector<roads_shader_aa::AAVertex> vertices(capacity.vertices);
+    vector<uint32_t> indices(capacity.indices);
+    OutputWriter<roads_shader_aa::AAVertex> vertices_writer(vertices);
+    OutputWriter<uint32_t> indices_writer(indices);
+    DebugCtx dctx;
+    auto [vertices_count, indices_count] =
+        roads_shader_aa::make_geometry(polyline, 2.0, vertices_writer, indices_writer, dctx);
+    EXPECT_EQ(vertices_count, capacity.vertices);
+    EXPECT_EQ(indices_count, capacity.indices);
+    for (size_t i = 0; i < vertices.size(); i += 2) {
+        EXPECT_EQ(vertices[i].coords, polyline[i / 2 + 1]);
+        EXPECT_EQ(vertices[i].is_outer, 0);
+        EXPECT_EQ(vertices[i + 1].is_outer, 1);
+    }
+}
+
+TEST(render_lib_tests, batch_tessellation_matches_serial) {
+    std::mt19937 rng(3);
+    std::uniform_int_distribution<uint32_t> coord(1'000'000, 2'000'000);
+    vector<vector<p32>> storage;
+    vector<double> widths;
+    for (size_t i = 0; i < 50; ++i) {
+        // sizes differ a lot, including ones too short to extrude.
+        vector<p32> polyline;
+        for (size_t k = 0; k < (i * 37) % 90; ++k) {
+            polyline.emplace_back(coord(rng), coord(rng));
+        }
+        storage.push_back(std::move(polyline));
+        widths.push_back(1.0 + i % 3);
+    }
+    vector<span<const p32>> polylines(storage.begin(), storage.end());
+
+    DebugCtx dctx;
+    // p32 default constructor leaves coordinates uninitialized.
+    const roads_shader_aa::AAVertex existing{p32(0, 0), 0, 0, {}};
+    vector<roads_shader_aa::AAVertex> expected_vertices(1, existing);
+    vector<uint32_t> expected_indices(1);
+    vector<p32> expected_triangles, expected_outlines;
+    using roads::tesselation::FirstPassSettings;
+    for (size_t i = 0; i < polylines.size(); ++i) {
+        const auto c = roads_shader_aa::required_capacity(polylines[i]);
+        vector<roads_shader_aa::AAVertex> vertices(c.vertices);
+        vector<uint32_t> indices(c.indices);
+        OutputWriter<roads_shader_aa::AAVertex> vertices_writer(vertices);
+        OutputWriter<uint32_t> indices_writer(indices);
+        if (polylines[i].size() >= 3) {
+            roads_shader_aa::make_geometry(polylines[i], widths[i], vertices_writer,
+                                           indices_writer, dctx);
+        }
+        // Every element compared below is written, none is left as allocated.
+        ASSERT_EQ(vertices_writer.size(), c.vertices);
+        ASSERT_EQ(indices_writer.size(), c.indices);
+        for (auto &idx : indices) {
+            idx += expected_vertices.size();
+        }
+        expected_vertices.insert(expected_vertices.end(), vertices.begin(), vertices.end());
+        expected_indices.insert(expected_indices.end(), indices.begin(), indices.end());
+
+        const auto rc = roads::tesselation::required_capacity<FirstPassSettings>(polylines[i]);
+        // Outline is written at positions, not appended, so it starts zeroed.
+        vector<p32> triangles(rc.triangles_vertices), outline(rc.outline_points, p32(0, 0));
+        OutputWriter<p32> triangles_writer(triangles);
+        if (polylines[i].size() >= 3) {
+            roads::tesselation::generate_geometry<FirstPassSettings>(
+                polylines[i], triangles_writer, outline, widths[i], dctx);
+        }
+        ASSERT_EQ(triangles_writer.size(), rc.triangles_vertices);
+        expected_triangles.insert(expected_triangles.end(), triangles.begin(), triangles.end());
+        expected_outlines.insert(expected_outlines.end(), outline.begin(), outline.end());
+    }
+
+    for (size_t workers : {1, 2, 7}) {
+        // appended after existing data.
+        vector<roads_shader_aa::AAVertex> vertices(1, existing);
+        vector<uint32_t> indices(1);
+        roads_shader_aa::make_geometry_batch(polylines, widths, vertices, indices, workers);
+        ASSERT_EQ(vertices.size(), expected_vertices.size());
+        for (size_t i = 0; i < vertices.size(); ++i) {
+            EXPECT_EQ(vertices[i].coords, expected_vertices[i].coords);
+            EXPECT_EQ(vertices[i].extent_vec, expected_vertices[i].extent_vec);
+        }
+        EXPECT_EQ(indices, expected_indices) << workers << " workers";
+
+        vector<p32> triangles, outlines;
+        roads::tesselation::generate_geometry_batch<FirstPassSettings>(polylines, widths,
+                                                                       triangles, outlines, workers);
+        EXPECT_EQ(triangles, expected_triangles) << workers << " workers";
+        EXPECT_EQ(outlines, expected_outlines) << workers << " workers";
+    }
+}
+
+TEST(render_lib_tests, indexed_tessellation_matches_triangles) {
+    std::mt19937 rng(5);
+    std::uniform_int_distribution<uint32_t> coord(1'000'000, 2'000'000);
+    vector<vector<p32>> storage;
+    for (size_t i = 0; i < 20; ++i) {
+        vector<p32> polyline;
+        for (size_t k = 0; k < (i * 13) % 40; ++k) {
+            polyline.emplace_back(coord(rng), coord(rng));
+        }
+        storage.push_back(std::move(polyline));
+    }
+    vector<span<const p32>> polylines(storage.begin(), storage.end());
+    vector<double> widths(polylines.size(), 100.0);
+
+    using roads::tesselation::FirstPassSettings;
+    vector<p32> triangles, outlines;
+    roads::tesselation::generate_geometry_batch<FirstPassSettings>(polylines, widths, triangles,
+                                                                   outlines, 1);
+    for (size_t workers : {1, 3}) {
+        vector<p32> vertices(1), indexed_outlines;
+        vector<uint32_t> indices;
+        roads::tesselation::generate_geometry_indexed_batch<FirstPassSettings>(
+            polylines, widths, vertices, indices, indexed_outlines, workers);
+        EXPECT_EQ(indexed_outlines, outlines);
+        ASSERT_EQ(indices.size(), triangles.size());
+        for (size_t i = 0; i < indices.size(); ++i) {
+            ASSERT_LT(indices[i], vertices.size());
+            ASSERT_EQ(vertices[indices[i]], triangles[i]) << "index " << i;
+        }
+        // only polyline points and their two offset points are stored.
+        size_t expected_vertices = 1;
+        for (auto polyline : polylines) {
+            expected_vertices += polyline.size() >= 3 ? 3 * polyline.size() : 0;
+        }
+        EXPECT_EQ(vertices.size(), expected_vertices);
+    }
+}
+
+TEST(render_lib_tests, half_float_conversion) {
+    using roads_shader_aa::float_to_half;
+    using roads_shader_aa::half_to_float;
+    // every finite half converts back to itself.
+    for (uint32_t h = 0; h < 0x10000; ++h) {
+        if ((h & 0x7c00) == 0x7c00) {
+            continue; // infinities and NaNs.
+        }
+        ASSERT_EQ(float_to_half(half_to_float(h)), h) << h;
+    }
+    EXPECT_EQ(float_to_half(1.0f), 0x3c00);
+    EXPECT_EQ(float_to_half(-2.0f), 0xc000);
+    EXPECT_EQ(float_to_half(1.0f + 1.0f / 4096), 0x3c00); // tie, rounds to even.
+    EXPECT_EQ(float_to_half(1e6f), 0x7c00);
+    EXPECT_EQ(float_to_half(65519.0f), 0x7bff);
+    EXPECT_NEAR(half_to_float(float_to_half(1.2345f)), 1.2345f, 1e-3);
+}
+
+TEST(render_lib_tests, pack_aa_mesh_keeps_geometry) {
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<uint32_t> step(1000, 2'000'000);
+    vector<vector<p32>> storage;
+    for (size_t i = 0; i < 10; ++i) {
+        // long walks crossing many level 4 tiles.
+        vector<p32> polyline;
+        uint32_t x = 500'000'000 + i * 300'000'000, y = 1'000'000'000;
+        for (size_t k = 0; k < 200; ++k) {
+            polyline.emplace_back(x += step(rng), y += step(rng));
+        }
+        storage.push_back(std::move(polyline));
+    }
+    vector<span<const p32>> polylines(storage.begin(), storage.end());
+    vector<double> widths(polylines.size(), 1.5);
+    vector<roads_shader_aa::AAVertex> vertices;
+    vector<uint32_t> indices;
+    roads_shader_aa::make_geometry_batch(polylines, widths, vertices, indices, 1);
+    vertices[3].style = 5;
+
+    const auto mesh = roads_shader_aa::pack_aa_mesh(vertices, indices, 4);
+    EXPECT_GT(mesh.batches.size(), 1);
+    EXPECT_LT(mesh.vertices.size(), vertices.size() * 2);
+    ASSERT_EQ(mesh.indices.size(), indices.size());
+
+    // batches go by tile of the first vertex of a triangle, in order of tiles.
+    vector<size_t> triangles(indices.size() / 3);
+    std::iota(triangles.begin(), triangles.end(), 0);
+    const auto tile_of = [&](size_t t) {
+        return gg::tile_id_by_pt(vertices[indices[t * 3]].coords, 4).id;
+    };
+    std::stable_sort(triangles.begin(), triangles.end(),
+                     [&](size_t a, size_t b) { return tile_of(a) < tile_of(b); });
+    using roads_shader_aa::PackedAAVertex;
+    size_t next_triangle = 0;
+    for (auto &batch : mesh.batches) {
+        EXPECT_EQ(batch.first_index, next_triangle * 3);
+        EXPECT_LE(batch.box.step, 4096.0f);
+        for (size_t i = 0; i < batch.indices_count; ++i) {
+            const auto &expected = vertices[indices[triangles[next_triangle + i / 3] * 3 + i % 3]];
+            const auto local_index = mesh.indices[batch.first_index + i];
+            const auto &packed = mesh.vertices[batch.base_vertex + local_index];
+            const p32 coords = roads_shader_aa::unpack_coords(packed, batch.box);
+            ASSERT_LE(std::abs(double(coords.x) - expected.coords.x), batch.box.step / 2 + 1);
+            ASSERT_LE(std::abs(double(coords.y) - expected.coords.y), batch.box.step / 2 + 1);
+            EXPECT_EQ(packed.style,
+                      expected.style | (expected.is_outer ? PackedAAVertex::OUTER_BIT : 0));
+            EXPECT_NEAR(roads_shader_aa::half_to_float(packed.extent_vec[0]),
+                        expected.extent_vec[0], 1e-3);
+            EXPECT_NEAR(roads_shader_aa::half_to_float(packed.extent_vec[1]),
+                        expected.extent_vec[1], 1e-3);
+        }
+        next_triangle += batch.indices_count / 3;
+    }
+    EXPECT_EQ(next_triangle, triangles.size());
+}
+
+TEST(render_lib_tests, buffer_streamer_persistent) {
+    auto gl = std::make_unique<MockStreamingGl>(true);
+    auto *mock = gl.get();
+    render::BufferStreamer streamer(std::move(gl), 64, 3);
+    EXPECT_TRUE(streamer.persistent());
+    check_streamed_uploads(mock, streamer);
+    EXPECT_GT(streamer.stats().fence_waits, 0);
+    EXPECT_EQ(streamer.stats().orphans, 0);
+    // at most one fence per region is alive.
+    EXPECT_LE(mock->fences_created - mock->fences_deleted, 3);
+}
+
+// Copies still pending read the old storage, so data survives a failed wait
+// only if the streamer stops writing there.
+TEST(render_lib_tests, buffer_streamer_failed_wait) {
+    auto gl = std::make_unique<MockStreamingGl>(true);
+    auto *mock = gl.get();
+    mock->fail_waits = true;
+    render::BufferStreamer streamer(std::move(gl), 64, 3);
+    check_streamed_uploads(mock, streamer);
+    EXPECT_TRUE(streamer.persistent());
+    EXPECT_GT(streamer.stats().orphans, 0);
+    EXPECT_EQ(streamer.stats().fence_waits, 0);
+    EXPECT_EQ(mock->fences_created, mock->fences_deleted + 1); // the last region's.
+}
+
+TEST(render_lib_tests, buffer_streamer_signaled_fences_are_not_waits) {
+    auto gl = std::make_unique<MockStreamingGl>(true);
+    auto *mock = gl.get();
+    render::BufferStreamer streamer(std::move(gl), 64, 3);
+    const unsigned dst = mock->create_buffer();
+    mock->buffers[dst]->resize(64);
+    const vector<uint8_t> data(64, 1);
+    for (size_t i = 0; i < 10; ++i) {
+        streamer.upload<uint8_t>(dst, 0, data);
+        streamer.end_frame();
+        mock->finish();
+    }
+    EXPECT_GT(mock->fences_deleted, 0);
+    EXPECT_EQ(streamer.stats().fence_waits, 0);
+    EXPECT_EQ(streamer.stats().orphans, 0);
+}
+
+TEST(render_lib_tests, buffer_streamer_orphaning) {
+    for (bool buffer_storage : {false, true}) {
+        // with buffer storage persistent mapping fails, streamer falls back.
+        auto gl = std::make_unique<MockStreamingGl>(buffer_storage, true);
+        auto *mock = gl.get();
+        render::BufferStreamer streamer(std::move(gl), 64, 3);
+        EXPECT_FALSE(streamer.persistent());
+        check_streamed_uploads(mock, streamer);
+        EXPECT_GT(streamer.stats().orphans, 0);
+        EXPECT_EQ(mock->fences_created, 0);
+    }
+}
+
+TEST(render_lib_tests, range_allocator_random) {
+    const size_t CAPACITY = 4096;
+    render::RangeAllocator allocator(CAPACITY);
+    vector<bool> used(CAPACITY, false);
+    vector<std::pair<size_t, size_t>> allocated; // offset, size
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; ++i) {
+        if (!allocated.empty() && rng() % 2) {
+            const size_t k = rng() % allocated.size();
+            auto [offset, size] = allocated[k];
+            allocator.release(offset, size);
+            std::fill(used.begin() + offset, used.begin() + offset + size, false);
+            allocated.erase(allocated.begin() + k);
+        } else {
+            const size_t size = 1 + rng() % 200;
+            const size_t alignment = 1 + rng() % 16; // not only powers of two.
+            auto offset = allocator.allocate(size, alignment);
+            if (!offset) {
+                continue;
+            }
+            ASSERT_EQ(*offset % alignment, 0);
+            ASSERT_LE(*offset + size, CAPACITY);
+            for (size_t b = *offset; b < *offset + size; ++b) {
+                ASSERT_FALSE(used[b]) << "byte " << b << " is allocated twice";
+                used[b] = true;
+            }
+            allocated.emplace_back(*offset, size);
+        }
+        ASSERT_EQ(allocator.free_bytes(), std::count(used.begin(), used.end(), false));
+    }
+    for (auto [offset, size] : allocated) {
+        allocator.release(offset, size);
+    }
+    // free ranges are merged back into one.
+    EXPECT_TRUE(allocator.empty());
+    EXPECT_EQ(allocator.largest_free(), CAPACITY);
+    EXPECT_EQ(allocator.allocate(CAPACITY), 0);
+    EXPECT_FALSE(allocator.allocate(1));
+}
+
+TEST(render_lib_tests, completion_queue_concurrent_push) {
+    const int PRODUCERS = 4;
+    const int VALUES = 20000;
+    render::CompletionQueue<std::pair<int, int>> queue; // producer, value
+    vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int v = 0; v < VALUES; ++v) {
+                queue.push({p, v});
+            }
+        });
+    }
+    vector<int> next(PRODUCERS, 0);
+    int received = 0;
+    while (received < PRODUCERS * VALUES) {
+        for (auto [p, v] : queue.take_all()) {
+            ASSERT_EQ(v, next[p]) << "values of producer " << p << " are reordered";
+            next[p]++;
+            received++;
+        }
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    EXPECT_TRUE(queue.take_all().empty());
+}
+
+TEST(render_lib_tests, tile_streamer_budget_and_order) {
+    // tiles of level 3 on a row, 100 bytes each.
+    vector<gg::tile_at_level_t> tiles;
+    for (uint16_t x = 0; x < 8; ++x) {
+        tiles.push_back({gg::tile_id_t(x, 0), 3});
+    }
+    const gg::tile_at_level_t broken{gg::tile_id_t(0, 1), 3};
+    tiles.push_back(broken);
+    std::atomic<int> loads = 0;
+    render::TileStreamer<vector<uint8_t>> streamer(
+        [&](gg::tile_at_level_t tile) {
+            loads++;
+            if (tile == broken) {
+                throw std::runtime_error("broken tile");
+            }
+            return vector<uint8_t>(100);
+        },
+        3);
+
+    // focus is at the right end of the row.
+    const p32 focus(gg::U32_MAX, 0);
+    streamer.request(tiles, focus);
+    // All of them are in the completion queue, so the first upload() orders
+    // every tile, not only ones which happened to arrive by then.
+    while (streamer.stats().completed < 9) {
+        std::this_thread::yield();
+    }
+
+    render::UploadBudget budget{250, 1h};
+    vector<uint16_t> uploaded_x;
+    auto upload = [&](gg::tile_at_level_t tile, vector<uint8_t> &data) {
+        uploaded_x.push_back(tile.id.x);
+        return data.size();
+    };
+    while (uploaded_x.size() < 8) {
+        const size_t before = uploaded_x.size();
+        // tiles not uploaded yet are requested again, nothing is loaded twice.
+        vector<gg::tile_at_level_t> missing;
+        for (auto t : tiles) {
+            if (std::find(uploaded_x.begin(), uploaded_x.end(), t.id.x) == uploaded_x.end() ||
+                t.id.y != 0) {
+                missing.push_back(t);
+            }
+        }
+        streamer.request(missing, focus);
+        const size_t n = streamer.upload(upload, budget);
+        // 3 tiles of 100 bytes go over 250 bytes budget, unless less are left.
+        if (n > 0) {
+            EXPECT_EQ(n, std::min<size_t>(3, 8 - before));
+        }
+    }
+    EXPECT_EQ(uploaded_x, (vector<uint16_t>{7, 6, 5, 4, 3, 2, 1, 0}));
+    EXPECT_EQ(loads, 9);
+
+    // too small budget still lets one tile through.
+    streamer.request(vector<gg::tile_at_level_t>{{gg::tile_id_t(0, 2), 3}}, focus);
+    while (streamer.upload(upload, render::UploadBudget{0, 0s}) == 0) {
+        std::this_thread::yield();
+    }
+    EXPECT_EQ(uploaded_x.size(), 9);
+
+    const auto stats = streamer.stats();
+    EXPECT_EQ(stats.failed, 1);
+    EXPECT_EQ(stats.loading, 0);
+    EXPECT_EQ(stats.completed, 0);
+    EXPECT_EQ(stats.uploaded, 9);
+    EXPECT_EQ(stats.uploaded_bytes, 900);
+}
+
+TEST(render_lib_tests, tile_cache_lru_eviction) {
+    vector<uint16_t> evicted;
+    render::TileCache::Budget budget;
+    budget.gpu_bytes = 300;
+    render::TileCache cache(budget, [&](gg::tile_at_level_t t) { evicted.push_back(t.id.x); });
+    auto tile = [](uint16_t x) { return gg::tile_at_level_t{gg::tile_id_t(x, 0), 4}; };
+
+    for (uint16_t x = 0; x < 3; ++x) {
+        cache.begin_frame();
+        EXPECT_TRUE(cache.insert(tile(x), 10, 100));
+    }
+    cache.begin_frame();
+    EXPECT_TRUE(cache.touch(tile(0)));
+    EXPECT_FALSE(cache.touch(tile(5)));
+    // 1 is least recently used now.
+    EXPECT_TRUE(cache.insert(tile(3), 10, 100));
+    EXPECT_EQ(evicted, (vector<uint16_t>{1}));
+
+    // Tiles of this frame are never evicted, so 4 doesn't fit.
+    EXPECT_TRUE(cache.touch(tile(2)));
+    EXPECT_FALSE(cache.insert(tile(4), 10, 100));
+    EXPECT_FALSE(cache.contains(tile(4)));
+    // Bigger than the whole budget.
+    cache.begin_frame();
+    EXPECT_FALSE(cache.insert(tile(4), 10, 301));
+    EXPECT_EQ(evicted, (vector<uint16_t>{1}));
+
+    // Growing a cached tile evicts others but not itself.
+    EXPECT_TRUE(cache.insert(tile(0), 10, 150));
+    EXPECT_EQ(evicted, (vector<uint16_t>{1, 3}));
+    EXPECT_TRUE(cache.contains(tile(0)));
+
+    cache.begin_frame();
+    EXPECT_TRUE(cache.touch(tile(2)));
+    budget.gpu_bytes = 100;
+    cache.set_budget(budget);
+    EXPECT_EQ(evicted, (vector<uint16_t>{1, 3, 0}));
+
+    const auto &stats = cache.stats();
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.evictions, 3);
+    EXPECT_EQ(stats.rejected, 2);
+    EXPECT_EQ(stats.tiles, 1);
+    EXPECT_EQ(stats.cpu_bytes, 10);
+    EXPECT_EQ(stats.gpu_bytes, 100);
+}
+
+TEST(render_lib_tests, tile_cache_rejected_insert_keeps_tiles) {
+    vector<uint16_t> evicted;
+    render::TileCache::Budget budget;
+    budget.gpu_bytes = 300;
+    render::TileCache cache(budget, [&](gg::tile_at_level_t t) { evicted.push_back(t.id.x); });
+    auto tile = [](uint16_t x) { return gg::tile_at_level_t{gg::tile_id_t(x, 0), 4}; };
+
+    cache.begin_frame();
+    EXPECT_TRUE(cache.insert(tile(0), 10, 100));
+    cache.begin_frame();
+    EXPECT_TRUE(cache.insert(tile(1), 10, 100));
+    EXPECT_TRUE(cache.insert(tile(2), 10, 100));
+    // Evicting 0 frees 100 bytes, not the 150 needed, 1 and 2 are in the way.
+    EXPECT_FALSE(cache.insert(tile(3), 10, 150));
+    EXPECT_TRUE(evicted.empty());
+    EXPECT_TRUE(cache.contains(tile(0)));
+    EXPECT_EQ(cache.stats().tiles, 3);
+    EXPECT_EQ(cache.stats().gpu_bytes, 300);
+    EXPECT_EQ(cache.stats().evictions, 0);
+    EXPECT_EQ(cache.stats().rejected, 1);
+    // Growing a cached tile is checked the same way.
+    EXPECT_FALSE(cache.insert(tile(2), 10, 250));
+    EXPECT_TRUE(evicted.empty());
+
+    // 100 bytes fit by evicting 0 only.
+    EXPECT_TRUE(cache.insert(tile(3), 10, 100));
+    EXPECT_EQ(evicted, (vector<uint16_t>{0}));
+}
+
+TEST(render_lib_tests, tile_cache_fallback_to_ancestor) {
+    render::TileCache cache({}, [](gg::tile_at_level_t) { FAIL() << "nothing to evict"; });
+    const gg::tile_at_level_t root{gg::tile_id_t(1, 2), 2};
+    ASSERT_TRUE(cache.insert(root, 0, 100));
+    const gg::tile_at_level_t tile{gg::tile_id_t(5, 11), 4};
+    EXPECT_FALSE(cache.touch(tile));
+    EXPECT_EQ(cache.touch_fallback(tile), root);
+    EXPECT_EQ(cache.touch_fallback({gg::tile_id_t(0, 0), 4}), std::nullopt);
+    EXPECT_EQ(cache.touch_fallback(root), std::nullopt);
+    EXPECT_EQ(cache.stats().hits, 0);
+    EXPECT_EQ(cache.stats().misses, 1);
+}
+
+TEST(render_lib_tests, covering_tiles_fall_back_to_ancestors) {
+    // All of level 0 is loaded and only one of the visible level 1 tiles.
+    vector<gg::tile_at_level_t> resident{{gg::tile_id_t(1, 1), 1}};
+    for (uint16_t y = 0; y < 2; ++y) {
+        for (uint16_t x = 0; x < 2; ++x) {
+            resident.push_back({gg::tile_id_t(x, y), 0});
+        }
+    }
+    const auto drawn_for = [&](gg::tile_at_level_t tile) {
+        while (std::none_of(resident.begin(), resident.end(), [&](gg::tile_at_level_t r) {
+            return gg::tile_key(r) == gg::tile_key(tile);
+        })) {
+            tile = gg::parent_tile(tile);
+        }
+        return gg::tile_key(tile);
+    };
+    const camera::TileRect visible{1, 0, 0, 2, 2};
+    vector<gg::tile_at_level_t> covering;
+    camera::covering_tiles(visible, resident, covering);
+
+    std::set<uint64_t> drawn;
+    for (auto tile : covering) {
+        drawn.insert(drawn_for(tile));
+    }
+    EXPECT_EQ(drawn, (std::set<uint64_t>{gg::tile_key(resident[0]), gg::tile_key(resident[1]),
+                                         gg::tile_key(resident[2]), gg::tile_key(resident[3]),
+                                         gg::tile_key(resident[4])}));
+    // Every visible tile is covered exactly once.
+    for (uint16_t y = 0; y <= 2; ++y) {
+        for (uint16_t x = 0; x <= 2; ++x) {
+            const auto covers = [&](gg::tile_at_level_t c) {
+                const uint32_t shift = 1 - c.level;
+                return c.id.x == x >> shift && c.id.y == y >> shift;
+            };
+            EXPECT_EQ(std::count_if(covering.begin(), covering.end(), covers), 1) << x << "," << y;
+        }
+    }
+
+    // Zoomed out on a fine level, only the loaded branch is walked down.
+    covering.clear();
+    camera::covering_tiles({12, 0, 0, 8191, 8191}, resident, covering);
+    EXPECT_EQ(covering.size(), 7);
+}
+
+TEST(render_lib_tests, shader_cache_dedup_and_binaries) {
+    const auto root = std::filesystem::temp_directory_path() / "render_lib_tests_shader_cache";
+    std::filesystem::remove_all(root);
+    auto write = [&](std::string name, std::string v_src, std::string f_src) {
+        std::filesystem::create_directories(root / "shaders" / name);
+        std::ofstream(root / "shaders" / name / (name + ".vert.glsl")) << v_src;
+        std::ofstream(root / "shaders" / name / (name + ".frag.glsl")) << f_src;
+    };
+    write("a", "v1", "f1");
+    write("b", "v1", "f1"); // same program as a.
+    write("c", "v1f", "1"); // same concatenation, different program.
+    auto make_cache = [&](std::string driver) {
+        auto gl = std::make_unique<MockProgramGl>(driver);
+        auto *res = gl.get();
+        auto cache = std::make_unique<shader_program::ShaderCache>(std::move(gl), root / "shaders",
+                                                                   root / "binaries");
+        return std::make_pair(res, std::move(cache));
+    };
+
+    {
+        auto [gl, cache] = make_cache("driver 1");
+        auto a = cache->get("a/a");
+        ASSERT_TRUE(a);
+        EXPECT_EQ(cache->get("b/b"), a);
+        auto c = cache->get("c/c");
+        ASSERT_TRUE(c);
+        EXPECT_NE(c->id, a->id);
+        EXPECT_EQ(c->location("program"), c->id);
+        EXPECT_EQ(c->location("missing"), -1);
+        EXPECT_EQ(cache->get("missing/missing"), nullptr);
+        EXPECT_EQ(gl->compiled, 2);
+        EXPECT_EQ(cache->stats().hits, 1);
+        cache.reset();
+        EXPECT_TRUE(gl->programs.empty()); // deleted with the cache.
+    }
+    {
+        // Next start loads both from binaries.
+        auto [gl, cache] = make_cache("driver 1");
+        EXPECT_EQ(gl->programs.at(cache->get("a/a")->id), "v1f1");
+        EXPECT_EQ(gl->programs.at(cache->get("c/c")->id), "v1f1");
+        EXPECT_EQ(gl->compiled, 0);
+        EXPECT_EQ(cache->stats().loaded, 2);
+    }
+    {
+        // Another driver keeps its binaries apart.
+        auto [gl, cache] = make_cache("driver 2");
+        cache->get("a/a");
+        EXPECT_EQ(gl->compiled, 1);
+        EXPECT_EQ(cache->stats().rejected, 0);
+    }
+    {
+        // Corrupted binary is rejected, compiled and saved again.
+        for (auto &dir : std::filesystem::directory_iterator(root / "binaries")) {
+            for (auto &file : std::filesystem::directory_iterator(dir)) {
+                std::ofstream(file.path(), std::ios::binary | std::ios::trunc) << "junk";
+            }
+        }
+        auto [gl, cache] = make_cache("driver 1");
+        cache->get("a/a");
+        EXPECT_EQ(cache->stats().rejected, 1);
+        EXPECT_EQ(gl->compiled, 1);
+        auto [gl2, cache2] = make_cache("driver 1");
+        cache2->get("a/a");
+        EXPECT_EQ(cache2->stats().loaded, 1);
+    }
+    {
+        // Size in the header beyond the end of the file is rejected too,
+        // without trying to allocate it.
+        for (auto &dir : std::filesystem::directory_iterator(root / "binaries")) {
+            for (auto &file : std::filesystem::directory_iterator(dir)) {
+                std::fstream fs(file.path(), std::ios::binary | std::ios::in | std::ios::out);
+                const uint64_t size = std::numeric_limits<uint64_t>::max() / 2;
+                fs.seekp(2 * sizeof(uint32_t));
+                fs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+            }
+        }
+        auto [gl, cache] = make_cache("driver 1");
+        EXPECT_TRUE(cache->get("a/a"));
+        EXPECT_EQ(cache->stats().rejected, 1);
+        EXPECT_EQ(gl->compiled, 1);
+    }
+    std::filesystem::remove_all(root);
+}
+
+TEST(render_lib_tests, render_layers_order) {
+    vector<std::string> drawn;
+    MockUnit top("top", drawn, 1), a("a", drawn, 2, 5), b("b", drawn, 1), c("c", drawn, 2, 4),
+        bottom("bottom", drawn, 3);
+    render::Profiler profiler(render::make_null_timer_gl());
+    render::Render render(profiler);
+    render.add_layer("top", top, 10);
+    size_t updates = 0;
+    const auto a_layer = render.add_layer("a", a, 0, [&](const camera::Cam2d &) {
+        updates++;
+        EXPECT_TRUE(std::find(drawn.begin(), drawn.end(), "a") == drawn.end()); // before draw.
+    });
+    render.add_layer("b", b, 0);
+    const auto c_layer = render.add_layer("c", c, 0);
+    render.add_layer("bottom", bottom, -5);
+
+    const camera::Cam2d cam;
+    auto frame = [&] {
+        drawn.clear();
+        render.render_frame(cam);
+        return drawn;
+    };
+    // z first, then by program and vao.
+    EXPECT_EQ(frame(), (vector<std::string>{"bottom", "b", "c", "a", "top"}));
+    EXPECT_EQ(updates, 1);
+
+    render.set_enabled(a_layer, false);
+    EXPECT_EQ(frame(), (vector<std::string>{"bottom", "b", "c", "top"}));
+    EXPECT_EQ(updates, 1); // disabled layers are not updated.
+    render.set_enabled(a_layer, true);
+
+    // Unit switching program is noticed without telling the render.
+    c.m_program = 0;
+    EXPECT_EQ(frame(), (vector<std::string>{"bottom", "c", "b", "a", "top"}));
+
+    render.set_z(c_layer, 20);
+    EXPECT_EQ(frame(), (vector<std::string>{"bottom", "b", "a", "top", "c"}));
+    EXPECT_EQ(profiler.stats(render.layers()[a_layer].scope).count, 3);
+    EXPECT_EQ(profiler.stats(render.layers()[c_layer].scope).count, 4);
+    EXPECT_EQ(profiler.stats(render.layers()[c_layer].scope).gpu_ms.samples, 0);
+}
+
+TEST(render_lib_tests, profiler_rolling_stats) {
+    auto gl_ptr = std::make_unique<MockTimerGl>();
+    MockTimerGl *gl = gl_ptr.get();
+    render::Profiler profiler(std::move(gl_ptr), 4);
+    const auto cpu = profiler.add_scope("cpu, only");
+    const auto gpu = profiler.add_scope("gpu");
+
+    // Window keeps the last 4 samples.
+    for (int ms = 1; ms <= 10; ++ms) {
+        profiler.record_cpu(cpu, ms);
+    }
+    auto stats = profiler.stats(cpu);
+    EXPECT_EQ(stats.count, 10);
+    EXPECT_EQ(stats.cpu_ms.samples, 4);
+    EXPECT_DOUBLE_EQ(stats.cpu_ms.min, 7);
+    EXPECT_DOUBLE_EQ(stats.cpu_ms.avg, 8.5);
+    EXPECT_DOUBLE_EQ(stats.cpu_ms.p99, 10);
+    EXPECT_EQ(stats.gpu_ms.samples, 0);
+
+    // Results are read when their slot comes around, a slot still in flight
+    // leaves the frame untimed on GPU.
+    for (size_t frame = 0; frame < 3; ++frame) {
+        profiler.begin_frame();
+        render::Profiler::Timer timer(profiler, gpu);
+    }
+    EXPECT_EQ(gl->began.size(), render::Profiler::QUERY_FRAMES);
+    EXPECT_EQ(profiler.stats(gpu).count, 3);
+    gl->results[gl->began[0]] = 2'000'000;
+    gl->results[gl->began[1]] = 4'000'000;
+    profiler.begin_frame();
+    stats = profiler.stats(gpu);
+    EXPECT_EQ(stats.gpu_ms.samples, 2);
+    EXPECT_DOUBLE_EQ(stats.gpu_ms.min, 2);
+    EXPECT_DOUBLE_EQ(stats.gpu_ms.avg, 3);
+    EXPECT_DOUBLE_EQ(stats.gpu_ms.p99, 4);
+    {
+        render::Profiler::Timer timer(profiler, gpu);
+    }
+    EXPECT_EQ(gl->began.size(), render::Profiler::QUERY_FRAMES + 1);
+
+    std::ostringstream csv;
+    profiler.write_csv(csv);
+    std::string line;
+    std::istringstream lines(csv.str());
+    std::getline(lines, line);
+    EXPECT_EQ(line.substr(0, 6), "scope,");
+    std::getline(lines, line);
+    EXPECT_EQ(line, "\"cpu, only\",7.0000,8.5000,10.0000,4,0.0000,0.0000,0.0000,0");
+    std::getline(lines, line);
+    // CPU times of timed scopes vary.
+    EXPECT_EQ(line.substr(0, 4), "gpu,");
+    EXPECT_EQ(line.substr(line.size() - 23), ",2.0000,3.0000,4.0000,2");
+
+    std::ostringstream json;
+    profiler.write_json(json);
+    EXPECT_NE(json.str().find("{\"name\": \"gpu\", \"count\": 4, \"cpu_ms\": {"),
+              std::string::npos);
+    EXPECT_NE(json.str().find("\"gpu_ms\": {\"min\": 2.0000, \"avg\": 3.0000, \"p99\": "
+                              "4.0000, \"samples\": 2}"),
+              std::string::npos);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
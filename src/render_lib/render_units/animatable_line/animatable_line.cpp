@@ -1,31 +1,58 @@
 #include "animatable_line.h"
 
 #include <common/gl_check.h>
-#include <glm/gtc/type_ptr.hpp>
 #include <imgui/imgui.h>
 
 namespace animatable_line {
-bool AnimatableLine::load_shaders(std::string shaders_root) {
-    auto shader =
-        shader_program::make_from_fs_bundle(shaders_root, "animatable_line/animatable_line");
+bool AnimatableLine::load_shaders(shader_program::ShaderCache &shaders) {
+    auto shader = shaders.get("animatable_line/animatable_line");
     if (!shader) {
         log_err("failed loading shader program for animatable line");
         return false;
     }
 
     m_shader = std::move(shader);
+    m_gamma_location = m_shader->location("gamma");
 
     return true;
 }
 
-bool AnimatableLine::make_buffers() {
+bool AnimatableLine::make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap) {
+    m_streamer = &streamer;
+    m_heap = &heap;
     GL_CHECK(glGenVertexArrays(1, &m_vao));
-    GL_CHECK(glGenBuffers(1, &m_vbo));
-    GL_CHECK(glGenBuffers(1, &m_ebo));
 
-    GL_CHECK(glBindVertexArray(m_vao));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, 100'000'000, NULL, GL_DYNAMIC_DRAW));
+    m_vertices_uploaded = 0;
+    m_indices_uploaded = 0;
+
+    return true;
+}
+
+void AnimatableLine::set_data(span<Vertex> vertices, span<uint32_t> indices) {
+    assert(m_vao != 0);
+
+    const unsigned old_vertex_buffer = m_vertices.buffer;
+    const unsigned old_index_buffer = m_indices.buffer;
+    bool deleted = m_heap->release(m_vertices);
+    deleted |= m_heap->release(m_indices);
+    m_vertices = m_heap->allocate(vertices.size() * sizeof(Vertex), sizeof(Vertex));
+    m_indices = m_heap->allocate(indices.size() * sizeof(uint32_t));
+    m_streamer->upload<Vertex>(m_vertices.buffer, m_vertices.offset, vertices);
+    m_streamer->upload<uint32_t>(m_indices.buffer, m_indices.offset, indices);
+
+    m_vertices_uploaded = vertices.size();
+    m_indices_uploaded = indices.size();
+    if (m_vertices.empty()) {
+        return;
+    }
+    // Nothing moved to another buffer, attributes are still valid.
+    if (!deleted && m_vertices.buffer == old_vertex_buffer &&
+        m_indices.buffer == old_index_buffer) {
+        return;
+    }
+
+    render::bind_vao(m_vao);
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vertices.buffer));
 
     static_assert(sizeof(p32) == sizeof(uint32_t) * 2); // todo: fix me.
     GL_CHECK(glVertexAttribPointer(0, 2, GL_UNSIGNED_INT, GL_FALSE, sizeof(Vertex),
@@ -38,36 +65,10 @@ bool AnimatableLine::make_buffers() {
 
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, 60'000'000, NULL, GL_DYNAMIC_DRAW));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.buffer));
     // DO NOT UNBIND EBO!
 
-    GL_CHECK(glBindVertexArray(0)); // unbind vao.
-
-    m_vertices_uploaded = 0;
-    m_indices_uploaded = 0;
-
-    return true;
-}
-
-void AnimatableLine::set_data(span<Vertex> vertices, span<uint32_t> indices) {
-    assert(m_vbo != 0);
-    assert(m_ebo != 0);
-
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(vertices[0]),
-                             vertices.data()));
-
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
-
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(indices[0]),
-                             indices.data()));
-
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-
-    m_vertices_uploaded = vertices.size();
-    m_indices_uploaded = indices.size();
+    render::bind_vao(0); // unbind vao.
 }
 
 void AnimatableLine::render_gui() {
@@ -76,28 +77,17 @@ void AnimatableLine::render_gui() {
 
 /*virtual*/
 void AnimatableLine::render_frame(const camera::Cam2d &cam) /*override*/ {
+    // Projection comes from the frame uniform block.
     m_shader->attach();
-    auto proj = cam.projection_maxtrix();
-    GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                                glm::value_ptr(proj)));
-    GL_CHECK(glUniform1f(glGetUniformLocation(m_shader->id, "scale"), (float)cam.zoom));
-
-    // Example how to pass uniform array.
-    unsigned data[100];
-    for (size_t i = 0; i < 100; ++i) {
-        data[i] = i * 10;
-    }
-
-    GL_CHECK(glUniform1uiv(glGetUniformLocation(m_shader->id, "data"), 100, &data[0]));
-    GL_CHECK(glUniform1f(glGetUniformLocation(m_shader->id, "gamma"), m_gamma));
-
-    // log_debug("drawing: {}", m_indices_uploaded);
+    GL_CHECK(glUniform1f(m_gamma_location, m_gamma));
 
-    GL_CHECK(glBindVertexArray(m_vao));
+    render::bind_vao(m_vao);
 
-    GL_CHECK(glDrawElements(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT, 0));
-    glBindVertexArray(0);
-    m_shader->detach();
+    // Attributes point to the start of the heap buffer.
+    GL_CHECK(glDrawElementsBaseVertex(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT,
+                                      (void *)m_indices.offset,
+                                      m_vertices.offset / sizeof(Vertex)));
+    render::count_draw(m_indices_uploaded);
 }
 
 } // namespace animatable_line
\ No newline at end of file
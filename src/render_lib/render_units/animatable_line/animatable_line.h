@@ -4,13 +4,15 @@
 #include "common/global.h"
 #include "common/log.h"
 #include "glad/glad.h"
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/gpu_heap.h"
 #include "render_lib/i_render_unit.h"
 #include <cstddef>
 #include <gg/gg.h>
 #include <tuple>
 #include <vector>
 
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 
 namespace animatable_line {
 
@@ -23,20 +25,27 @@ struct Vertex {
 class AnimatableLine : public IRenderUnit {
   public:
     AnimatableLine() : m_gamma(1.0) {}
-    bool load_shaders(std::string shaders_root);
+    bool load_shaders(shader_program::ShaderCache &shaders);
     void set_data(span<Vertex> vertices, span<uint32_t> indices);
-    bool make_buffers();
+    // Data is uploaded through streamer into ranges of heap, both must outlive
+    // the unit.
+    bool make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap);
     void render_gui();
     virtual void render_frame(const camera::Cam2d &cam) override;
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
 
   private:
     float m_gamma;
     unsigned m_vao = 0;
-    unsigned m_vbo = 0;
-    unsigned m_ebo = 0;
+    render::GpuRange m_vertices; // aligned to vertex size.
+    render::GpuRange m_indices;
+    render::BufferStreamer *m_streamer = nullptr;
+    render::GpuHeap *m_heap = nullptr;
 
     size_t m_vertices_uploaded = 0;
     size_t m_indices_uploaded = 0;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader;
+    int m_gamma_location = -1;
 };
 } // namespace animatable_line
\ No newline at end of file
@@ -3,7 +3,11 @@
 layout(location = 0) in vec2 coords;
 layout(location = 1) in float t;
 
-uniform mat4 proj;
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
 out float outT;
 
 void main() {
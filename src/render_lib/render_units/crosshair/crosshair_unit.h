@@ -8,16 +8,16 @@
 #include <tuple>
 #include <vector>
 
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 
 class CrosshairUnit : public IRenderUnit {
     unsigned m_vao = -1;
     unsigned m_vbo = -1;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader = nullptr;
 
   public:
-    bool load_shaders(std::string shaders_root) {
-        auto shader = shader_program::make_from_fs_bundle(shaders_root, "crosshair/crosshair");
+    bool load_shaders(shader_program::ShaderCache &shaders) {
+        auto shader = shaders.get("crosshair/crosshair");
         if (!shader) {
             log_err("failed loading shader program for triangle");
             return false;
@@ -26,6 +26,9 @@ class CrosshairUnit : public IRenderUnit {
         return true;
     }
 
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
+
     virtual void render_frame(const camera::Cam2d &camera) override {
         if (m_vao == -1) {
             float crosshair_vertices[] = {
@@ -43,18 +46,19 @@ class CrosshairUnit : public IRenderUnit {
             }
             glGenVertexArrays(1, &m_vao);
             glGenBuffers(1, &m_vbo);
-            glBindVertexArray(m_vao);
+            render::bind_vao(m_vao);
             glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
             glBufferData(GL_ARRAY_BUFFER, sizeof(crosshair_vertices), &crosshair_vertices[0],
                          GL_STATIC_DRAW);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
             glEnableVertexAttribArray(0);
             glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind
-            glBindVertexArray(0);             // unbind
+            render::bind_vao(0);              // unbind
         }
 
-        glUseProgram(m_shader->id);
-        glBindVertexArray(m_vao);
+        m_shader->attach();
+        render::bind_vao(m_vao);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        render::count_draw(6);
     }
 };
\ No newline at end of file
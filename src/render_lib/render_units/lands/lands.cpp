@@ -1,11 +1,12 @@
 #include "lands.h"
 #include <common/gl_check.h>
-#include <glm/gtc/type_ptr.hpp>
+#include <numeric>
+#include <render_lib/visible_tiles.h>
 
 namespace lands {
 
-bool Lands::load_shaders(std::string shaders_root) {
-    auto shader = shader_program::make_from_fs_bundle(shaders_root, "lands/lands");
+bool Lands::load_shaders(shader_program::ShaderCache &shaders) {
+    auto shader = shaders.get("lands/lands");
     if (!shader) {
         log_err("failed loading shader program for lands");
         return false;
@@ -14,46 +15,176 @@ bool Lands::load_shaders(std::string shaders_root) {
     return true;
 }
 
-void Lands::set_data(span<p32> vertices, span<uint32_t> indices) {
-    assert(m_vbo != 0);
-    assert(m_ebo != 0);
-
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
-    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(vertices[0]),
-                             vertices.data()));
+void Lands::point_vao(unsigned vertex_buffer, unsigned index_buffer) {
+    if (vertex_buffer == m_vao_vertex_buffer && index_buffer == m_vao_index_buffer) {
+        return;
+    }
+    m_vao_vertex_buffer = vertex_buffer;
+    m_vao_index_buffer = index_buffer;
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer));
+    GL_CHECK(glVertexAttribPointer(0, 2, GL_UNSIGNED_INT, GL_FALSE, sizeof(p32), (void *)0));
+    GL_CHECK(glEnableVertexAttribArray(0));
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer));
+    // DO NOT UNBIND EBO!
+}
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, indices.size() * sizeof(indices[0]),
-                             indices.data()));
+void Lands::release(render::GpuRange &range) {
+    const unsigned buffer = range.buffer;
+    if (m_heap->release(range) && (buffer == m_vao_vertex_buffer || buffer == m_vao_index_buffer)) {
+        // The name can come back for another buffer.
+        m_vao_vertex_buffer = 0;
+        m_vao_index_buffer = 0;
+    }
+}
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+void Lands::release_untiled() {
+    release(m_vertices);
+    release(m_indices);
+    m_vertices_uploaded = 0;
+    m_indices_uploaded = 0;
+}
 
+void Lands::set_data(span<p32> vertices, span<uint32_t> indices) {
+    assert(m_vao != 0);
+    set_tiles({});
+    m_vertices = m_heap->allocate(vertices.size() * sizeof(p32), sizeof(p32));
+    m_indices = m_heap->allocate(indices.size() * sizeof(uint32_t));
+    m_streamer->upload<p32>(m_vertices.buffer, m_vertices.offset, vertices);
+    m_streamer->upload<uint32_t>(m_indices.buffer, m_indices.offset, indices);
     m_vertices_uploaded = vertices.size();
     m_indices_uploaded = indices.size();
-}
+    if (m_vertices.empty()) {
+        return;
+    }
 
-bool Lands::make_buffers() {
-    GL_CHECK(glGenVertexArrays(1, &m_vao));
-    GL_CHECK(glGenBuffers(1, &m_vbo));
-    GL_CHECK(glGenBuffers(1, &m_ebo));
+    render::bind_vao(m_vao);
+    point_vao(m_vertices.buffer, m_indices.buffer);
+    render::bind_vao(0); // unbind vao.
+}
 
-    GL_CHECK(glBindVertexArray(m_vao));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, 20'000'000, NULL, GL_DYNAMIC_DRAW));
+void Lands::set_tiles(span<const TileData> tiles) {
+    release_untiled();
+    for (auto &[key, t] : m_tiles) {
+        release(t.range);
+    }
+    m_tiles.clear();
+    m_level_tiles.clear();
+    m_levels.clear();
+    m_tiles_drawn = 0;
+    for (auto &t : tiles) {
+        add_tile(t);
+    }
+}
 
-    GL_CHECK(glVertexAttribPointer(0, 2, GL_UNSIGNED_INT, GL_FALSE, sizeof(p32), (void *)0));
-    GL_CHECK(glEnableVertexAttribArray(0));
+void Lands::add_tile(const TileData &t) {
+    assert(m_vao != 0);
+    release_untiled();
+    remove_tile(t.tile);
+
+    const size_t vertices_bytes = t.vertices.size() * sizeof(p32);
+    TileRange r{t.tile, {}, static_cast<int32_t>(t.indices.size()), 0, 0};
+    // Indices right after vertices are aligned for uint32_t too.
+    r.range = m_heap->allocate(vertices_bytes + t.indices.size() * sizeof(uint32_t), sizeof(p32));
+    r.indices_offset = r.range.offset + vertices_bytes;
+    r.base_vertex = static_cast<int32_t>(r.range.offset / sizeof(p32));
+    m_streamer->upload(r.range.buffer, r.range.offset, t.vertices);
+    m_streamer->upload(r.range.buffer, r.indices_offset, t.indices);
+    m_tiles.emplace(gg::tile_key(t.tile), r);
+
+    if (m_level_tiles[t.tile.level]++ == 0) {
+        m_levels.insert(std::upper_bound(m_levels.begin(), m_levels.end(), t.tile.level),
+                        t.tile.level);
+    }
+}
 
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
+void Lands::remove_tile(gg::tile_at_level_t tile) {
+    auto it = m_tiles.find(gg::tile_key(tile));
+    if (it == m_tiles.end()) {
+        return;
+    }
+    release(it->second.range);
+    m_tiles.erase(it);
+    if (--m_level_tiles[tile.level] == 0) {
+        m_level_tiles.erase(tile.level);
+        m_levels.erase(std::find(m_levels.begin(), m_levels.end(), tile.level));
+    }
+}
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, 20'000'000, NULL, GL_DYNAMIC_DRAW));
-    // DO NOT UNBIND EBO!
+bool Lands::make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap) {
+    m_streamer = &streamer;
+    m_heap = &heap;
+    GL_CHECK(glGenVertexArrays(1, &m_vao));
+    return true;
+}
 
-    GL_CHECK(glBindVertexArray(0)); // unbind vao.
+const Lands::TileRange *Lands::find_drawn(gg::tile_at_level_t tile) const {
+    auto it = m_tiles.find(gg::tile_key(tile));
+    while (it == m_tiles.end() && tile.level > 0) {
+        tile = gg::parent_tile(tile);
+        it = m_tiles.find(gg::tile_key(tile));
+    }
+    if (it == m_tiles.end() || it->second.indices_count == 0) {
+        return nullptr;
+    }
+    return &it->second;
+}
 
-    return true;
+void Lands::draw_tiles(const camera::Cam2d &cam) {
+    const uint32_t level = camera::closest_level(m_levels, camera::level_for_zoom(cam));
+    const auto visible = camera::visible_tiles(cam, level);
+    m_visible.clear();
+    const size_t rect_tiles =
+        size_t(visible.max_x - visible.min_x + 1) * (visible.max_y - visible.min_y + 1);
+    if (rect_tiles <= m_tiles.size()) {
+        for (uint32_t y = visible.min_y; y <= visible.max_y; ++y) {
+            for (uint32_t x = visible.min_x; x <= visible.max_x; ++x) {
+                const gg::tile_id_t id(static_cast<uint16_t>(x), static_cast<uint16_t>(y));
+                if (const TileRange *t = find_drawn({id, level})) {
+                    m_visible.push_back(t);
+                }
+            }
+        }
+    } else {
+        // Few tiles loaded (startup, after eviction) or level is much finer
+        // than the view: walk down to visible tiles only under loaded ones.
+        m_resident.clear();
+        for (auto &[key, t] : m_tiles) {
+            m_resident.push_back(t.tile);
+        }
+        m_covering.clear();
+        camera::covering_tiles(visible, m_resident, m_covering);
+        for (gg::tile_at_level_t tile : m_covering) {
+            if (const TileRange *t = find_drawn(tile)) {
+                m_visible.push_back(t);
+            }
+        }
+    }
+    // Tiles missing the same ancestor share it.
+    std::sort(m_visible.begin(), m_visible.end(), [](const TileRange *a, const TileRange *b) {
+        return std::tie(a->range.buffer, a) < std::tie(b->range.buffer, b);
+    });
+    m_visible.erase(std::unique(m_visible.begin(), m_visible.end()), m_visible.end());
+    m_tiles_drawn = m_visible.size();
+
+    for (size_t first = 0; first < m_visible.size();) {
+        const unsigned buffer = m_visible[first]->range.buffer;
+        m_draw_counts.clear();
+        m_draw_offsets.clear();
+        m_draw_base_vertices.clear();
+        size_t i = first;
+        for (; i < m_visible.size() && m_visible[i]->range.buffer == buffer; ++i) {
+            m_draw_counts.push_back(m_visible[i]->indices_count);
+            m_draw_offsets.push_back(reinterpret_cast<const void *>(m_visible[i]->indices_offset));
+            m_draw_base_vertices.push_back(m_visible[i]->base_vertex);
+        }
+        point_vao(buffer, buffer);
+        GL_CHECK(glMultiDrawElementsBaseVertex(GL_TRIANGLES, m_draw_counts.data(), GL_UNSIGNED_INT,
+                                               m_draw_offsets.data(), m_draw_counts.size(),
+                                               m_draw_base_vertices.data()));
+        render::count_draw(std::accumulate(m_draw_counts.begin(), m_draw_counts.end(), size_t(0)));
+        first = i;
+    }
 }
 
 void Lands::render_frame(const camera::Cam2d &cam) {
@@ -66,13 +197,15 @@ void Lands::render_frame(const camera::Cam2d &cam) {
         return;
     }
     m_shader->attach();
-    auto proj = cam.projection_maxtrix();
-    glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                       glm::value_ptr(proj));
-    GL_CHECK(glBindVertexArray(m_vao));
-    GL_CHECK(glDrawElements(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT, 0));
-    GL_CHECK(glBindVertexArray(0));
-    m_shader->detach();
+    render::bind_vao(m_vao);
+    if (!m_tiles.empty()) {
+        draw_tiles(cam);
+    } else if (m_indices_uploaded > 0) {
+        GL_CHECK(glDrawElementsBaseVertex(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT,
+                                          (void *)m_indices.offset,
+                                          m_vertices.offset / sizeof(p32)));
+        render::count_draw(m_indices_uploaded);
+    }
 }
 
-} // namespace lands
\ No newline at end of file
+} // namespace lands
@@ -2,22 +2,94 @@
 
 #include "common/global.h"
 
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/gpu_heap.h"
 #include "render_lib/i_render_unit.h"
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
+
+#include <map>
+#include <unordered_map>
 
 namespace lands {
 class Lands : public IRenderUnit {
+  public:
+    // Geometry of one tile, indices are relative to the tile's vertices.
+    struct TileData {
+        gg::tile_at_level_t tile;
+        span<const p32> vertices;
+        span<const uint32_t> indices;
+    };
+
+  private:
+    // Tile geometry in one heap range: vertices followed by indices. Offsets
+    // are of the heap buffer.
+    struct TileRange {
+        gg::tile_at_level_t tile;
+        render::GpuRange range; // empty for a tile without geometry.
+        int32_t indices_count;
+        size_t indices_offset; // bytes
+        int32_t base_vertex;
+    };
+
     unsigned m_vao = 0;
-    unsigned m_vbo = 0;
-    unsigned m_ebo = 0;
+    unsigned m_vao_vertex_buffer = 0; // buffers m_vao points to.
+    unsigned m_vao_index_buffer = 0;
+    render::GpuRange m_vertices; // untiled data, aligned to vertex size.
+    render::GpuRange m_indices;
+    render::BufferStreamer *m_streamer = nullptr;
+    render::GpuHeap *m_heap = nullptr;
     size_t m_vertices_uploaded = 0;
     size_t m_indices_uploaded = 0;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader;
+
+    // Tiled mode, empty when data is set with set_data().
+    std::unordered_map<uint64_t, TileRange> m_tiles; // by gg::tile_key
+    std::map<uint32_t, size_t> m_level_tiles;        // tiles count by level.
+    vector<uint32_t> m_levels;                       // ascending, keys of m_level_tiles.
+    size_t m_tiles_drawn = 0;
+    // Kept to not allocate every frame.
+    vector<const TileRange *> m_visible;
+    vector<gg::tile_at_level_t> m_resident;
+    vector<gg::tile_at_level_t> m_covering;
+    vector<int32_t> m_draw_counts;
+    vector<const void *> m_draw_offsets;
+    vector<int32_t> m_draw_base_vertices;
+
+    // Releases a range, forgetting the vao's buffers if the heap deleted one.
+    void release(render::GpuRange &range);
+    void release_untiled();
+    // Points attributes and element buffer of the bound vao to heap buffers,
+    // attributes start at the beginning of vertex_buffer. Does nothing if the
+    // vao already points to them.
+    void point_vao(unsigned vertex_buffer, unsigned index_buffer);
+    // Tile to draw in place of tile: itself or, while it is not loaded, its
+    // closest loaded ancestor. Nothing if that has no geometry.
+    const TileRange *find_drawn(gg::tile_at_level_t tile) const;
+    // Draws visible tiles with one call per heap buffer.
+    void draw_tiles(const camera::Cam2d &cam);
 
   public:
-    bool load_shaders(std::string shaders_root);
+    bool load_shaders(shader_program::ShaderCache &shaders);
+    // Untiled data, drawn as a whole every frame.
     void set_data(span<p32> aa_vertex_data, span<uint32_t> aa_vertex_indices);
-    bool make_buffers();
+    // Tiled data, possibly of several levels. Each frame only tiles of the
+    // level fitting camera zoom which intersect the view are submitted, a
+    // missing one is covered by its closest loaded ancestor.
+    void set_tiles(span<const TileData> tiles);
+    // Adds one tile to tiled data (replaces it if it is there), so tiles can
+    // be streamed in as they are loaded.
+    void add_tile(const TileData &tile);
+    void remove_tile(gg::tile_at_level_t tile);
+    bool has_tile(gg::tile_at_level_t tile) const { return m_tiles.count(gg::tile_key(tile)); }
+    // Data is uploaded through streamer into ranges of heap, both must outlive
+    // the unit.
+    bool make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap);
     virtual void render_frame(const camera::Cam2d &cam) override;
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
+
+    size_t tiles_count() const { return m_tiles.size(); }
+    // Tiles submitted by the last render_frame(), 0 in untiled mode.
+    size_t tiles_drawn() const { return m_tiles_drawn; }
 };
-} // namespace lands
\ No newline at end of file
+} // namespace lands
@@ -4,7 +4,11 @@ layout(location = 1) in vec3 aColor;
 
 out vec3 myFragColor;
 
-uniform mat4 proj;
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
 
 void main() {
         //gl_Position = proj * vec4(aPos.x + sin(aPos.y), aPos.y + sin(aPos.x), 0.0, 1.0);
@@ -5,7 +5,7 @@
 #include "common/log.h"
 #include "glad/glad.h"
 #include "render_lib/i_render_unit.h"
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 #include <cstddef>
 #include <gg/gg.h>
 #include <tuple>
@@ -17,7 +17,7 @@ class LinesUnit : public IRenderUnit {
     unsigned m_vao = -1;
     unsigned m_vbo = -1;
     unsigned m_colors_vbo = -1;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader = nullptr;
     bool m_dirty = true;
 
   public:
@@ -53,7 +53,7 @@ class LinesUnit : public IRenderUnit {
         glGenVertexArrays(1, &m_vao);
         glGenBuffers(1, &m_vbo);
         glGenBuffers(1, &m_colors_vbo);
-        glBindVertexArray(m_vao);
+        render::bind_vao(m_vao);
 
         glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
         glBufferData(GL_ARRAY_BUFFER, m_geometry.size() * sizeof(m_geometry[0]), NULL,
@@ -69,7 +69,7 @@ class LinesUnit : public IRenderUnit {
         glEnableVertexAttribArray(1);
         glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind
 
-        glBindVertexArray(0); // unbind
+        render::bind_vao(0); // unbind
     }
 
     bool reupload_geometry() {
@@ -95,8 +95,8 @@ class LinesUnit : public IRenderUnit {
         return true;
     }
 
-    bool load_shaders(std::string shaders_root) {
-        auto shader = shader_program::make_from_fs_bundle(shaders_root, "lines/lines");
+    bool load_shaders(shader_program::ShaderCache &shaders) {
+        auto shader = shaders.get("lines/lines");
         if (!shader) {
             log_err("failed loading shader program for triangle");
             return false;
@@ -105,6 +105,9 @@ class LinesUnit : public IRenderUnit {
         return true;
     }
 
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
+
     virtual void render_frame(const camera::Cam2d &camera) override {
         if (!m_shader) {
             log_err("lines shader not ready");
@@ -116,11 +119,10 @@ class LinesUnit : public IRenderUnit {
                 return;
             m_dirty = false;
         }
-        GL_CHECK(glUseProgram(m_shader->id));
-        auto proj = camera.projection_maxtrix();
-        GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                                    glm::value_ptr(proj)));
-        GL_CHECK(glBindVertexArray(m_vao));
+        // Projection comes from the frame uniform block.
+        m_shader->attach();
+        render::bind_vao(m_vao);
         GL_CHECK(glDrawArrays(GL_LINES, 0, m_geometry.size() / 2));
+        render::count_draw(m_geometry.size() / 2);
     }
 };
@@ -2,7 +2,11 @@
 
 layout(location = 0) in vec2 aPos;
 
-uniform mat4 proj;
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
 
 
 void main() {
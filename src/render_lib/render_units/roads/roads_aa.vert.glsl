@@ -2,7 +2,11 @@
 layout(location = 0) in vec2 aPos;
 layout(location = 1) in vec4 vColor;
 
-uniform mat4 proj;
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
 
 out vec4 color;
  
@@ -1,13 +1,9 @@
 #include "roads_unit.h"
-//#include <glm/glm.hpp>
-#include <glm/gtc/type_ptr.hpp>
 
-namespace {
-const size_t RESERVED_VERTEX_DATA_SIZE = 100 * 1024 * 1024;
-}
+#include <limits>
 
-bool RoadsUnit::load_shaders(std::string shaders_root) {
-    auto shader = shader_program::make_from_fs_bundle(shaders_root, "roads/roads");
+bool RoadsUnit::load_shaders(shader_program::ShaderCache &shaders) {
+    auto shader = shaders.get("roads/roads");
     if (!shader) {
         log_err("failed loading shader program for roads");
         return false;
@@ -18,41 +14,64 @@ bool RoadsUnit::load_shaders(std::string shaders_root) {
     return true;
 }
 
-bool RoadsUnit::make_buffers() {
+bool RoadsUnit::make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap) {
+    m_streamer = &streamer;
+    m_heap = &heap;
     glGenVertexArrays(1, &m_vao);
-    glGenBuffers(1, &m_vbo);
-    glBindVertexArray(m_vao);
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    // Lets preallocate a bunch of data for rendering some number of roads.
-    // lets preallocate 10mb first.
-    // 10MB is 164k of 2d vertices
-    glBufferData(GL_ARRAY_BUFFER, RESERVED_VERTEX_DATA_SIZE, NULL, GL_DYNAMIC_DRAW);
+    return true;
+}
+
+void RoadsUnit::upload(span<const p32> vertex_data, span<const uint32_t> index_data) {
+    const unsigned old_vertex_buffer = m_vertices.buffer;
+    const unsigned old_index_buffer = m_indices.buffer;
+    bool deleted = m_heap->release(m_vertices);
+    deleted |= m_heap->release(m_indices);
+    m_vertices = m_heap->allocate(vertex_data.size() * sizeof(p32), sizeof(p32));
+    m_indices = m_heap->allocate(index_data.size() * sizeof(uint32_t));
+    m_streamer->upload(m_vertices.buffer, m_vertices.offset, vertex_data);
+    m_streamer->upload(m_indices.buffer, m_indices.offset, index_data);
+    m_vertices_uploaded = vertex_data.size();
+    m_indices_uploaded = index_data.size();
+    if (m_vertices.empty()) {
+        return;
+    }
+    // The vao already points to these buffers.
+    if (!deleted && m_vertices.buffer == old_vertex_buffer &&
+        m_indices.buffer == old_index_buffer) {
+        return;
+    }
+
+    render::bind_vao(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertices.buffer);
     static_assert(sizeof(p32) == sizeof(uint32_t) * 2); // todo: fix me.
     glVertexAttribPointer(0, 2, GL_UNSIGNED_INT, GL_FALSE, sizeof(uint32_t) * 2, (void *)0);
     glEnableVertexAttribArray(0);
-    glBindVertexArray(0);
-
-    return true;
+    // element buffer binding is part of vao state.
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.buffer);
+    render::bind_vao(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
 
-void RoadsUnit::set_data(span<p32> vertex_data) {
-    auto upload_start_time = std::chrono::steady_clock::now();
+void RoadsUnit::set_data(span<p32> vertex_data) { upload(vertex_data, {}); }
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, vertex_data.size() * sizeof(vertex_data[0]),
-                    vertex_data.data());
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind
-    m_vertices_uploaded = vertex_data.size();
+void RoadsUnit::set_indexed_data(span<const p32> vertex_data, span<const uint32_t> index_data) {
+    assert(index_data.size() % 3 == 0);
+    assert(vertex_data.size() <= std::numeric_limits<uint32_t>::max());
+    upload(vertex_data, index_data);
 }
 
 /*virtual*/
 void RoadsUnit::render_frame(const camera::Cam2d &cam) /*override*/ {
     m_shader->attach();
-    auto proj = cam.projection_maxtrix();
-    glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                       glm::value_ptr(proj));
-    glBindVertexArray(m_vao);
-    glDrawArrays(GL_TRIANGLES, 0, m_vertices_uploaded);
-    glBindVertexArray(0);
-    m_shader->detach();
+    render::bind_vao(m_vao);
+    // Attributes point to the start of the heap buffer.
+    const GLint first_vertex = m_vertices.offset / sizeof(p32);
+    if (m_indices_uploaded) {
+        glDrawElementsBaseVertex(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT,
+                                 (void *)m_indices.offset, first_vertex);
+        render::count_draw(m_indices_uploaded);
+    } else {
+        glDrawArrays(GL_TRIANGLES, first_vertex, m_vertices_uploaded);
+        render::count_draw(m_vertices_uploaded);
+    }
 }
@@ -4,13 +4,15 @@
 #include "common/global.h"
 #include "common/log.h"
 #include "glad/glad.h"
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/gpu_heap.h"
 #include "render_lib/i_render_unit.h"
 #include <cstddef>
 #include <gg/gg.h>
 #include <tuple>
 #include <vector>
 
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 
 struct ColoredVertex {
     ColoredVertex() {}
@@ -21,16 +23,32 @@ struct ColoredVertex {
 
 class RoadsUnit : public IRenderUnit {
     unsigned m_vao = 0;
-    unsigned m_vbo = 0;
+    render::GpuRange m_vertices; // aligned to vertex size.
+    render::GpuRange m_indices;
+    render::BufferStreamer *m_streamer = nullptr;
+    render::GpuHeap *m_heap = nullptr;
 
     size_t m_vertices_uploaded = 0;
+    size_t m_indices_uploaded = 0; // 0 means m_vertices holds plain triangles.
     size_t m_aa_vertices_uploaded = 0;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader = nullptr;
-    std::unique_ptr<shader_program::ShaderProgram> m_aa_shader = nullptr;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    std::shared_ptr<shader_program::ShaderProgram> m_aa_shader = nullptr;
     // This unit is not going to own its resources directly?
+
+    void upload(span<const p32> vertex_data, span<const uint32_t> index_data);
+
   public:
-    bool load_shaders(std::string shaders_root);
+    bool load_shaders(shader_program::ShaderCache &shaders);
     void set_data(span<p32> vertex_data);
-    bool make_buffers(); // todo: should not be part of interface.
+    // Output of roads::tesselation::generate_geometry_indexed, drawn with
+    // glDrawElements. The index range is as big as index_data, which is
+    // required_indexed_capacity() of the tessellated polylines, nothing is
+    // reserved up front.
+    void set_indexed_data(span<const p32> vertex_data, span<const uint32_t> index_data);
+    // Data is uploaded through streamer into ranges of heap, both must outlive
+    // the unit. todo: should not be part of interface.
+    bool make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap);
     virtual void render_frame(const camera::Cam2d &cam) override;
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
 };
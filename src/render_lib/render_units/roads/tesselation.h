@@ -1,6 +1,11 @@
 #include "common/global.h"
+#include "common/output_writer.h"
+#include "common/parallel.h"
 #include "render_lib/debug_ctx.h"
 #include "render_lib/i_render_unit.h"
+#include <atomic>
+#include <limits>
+#include <tuple>
 
 namespace roads::tesselation {
 
@@ -24,6 +29,22 @@ struct AAPassSettings {
     const static bool GenerateOutline = false;
 };
 
+// Exact size of generate_geometry output for polyline.
+struct Capacity {
+    size_t triangles_vertices; // 6 per quad, a quad per segment and side.
+    size_t outline_points;     // one per point and side, 0 without outline.
+};
+
+template <class Settings = DefaultRenderSettings>
+Capacity required_capacity(span<const p32> polyline) {
+    if (polyline.size() < 3) {
+        return {0, 0};
+    }
+    const size_t sides = Settings::GenerateBothSides ? 2 : 1;
+    return {6 * sides * (polyline.size() - 1),
+            Settings::GenerateOutline ? sides * polyline.size() : 0};
+}
+
 /*
  For each vertex of polyline find normalized vector that bisects angle
  between them, this would give us volume for road. tip: this probably
@@ -42,56 +63,12 @@ struct AAPassSettings {
  https://math.stackexchange.com/questions/1460994/calculating-geometry-for-a-polyline-of-a-given-thickness
   */
 
-template <class Settings = DefaultRenderSettings>
-static std::vector<p32> generate_geometry(span<p32> polyline, span<p32> triangles_output,
-                                          span<p32> outline_output, double width, DebugCtx &ctx) {
-    // to draw by two points, we need to have some special handling
-    // which I have not implemented yet.
-    assert(polyline.size() > 2);
-    if (polyline.size() < 3) {
-        log_warn("line with less than 3 points");
-        return {{}};
-    }
-
-    // hopefully it is inlinable and thus compatible with optimizations
-    auto on_outline_point = [i = 0u, &outline_output, size = polyline.size()](v2 d, v2 e) mutable {
-        if constexpr (Settings::GenerateOutline) {
-            outline_output[i].x = d.x;
-            outline_output[i].y = d.y;
-            if constexpr (Settings::GenerateBothSides) {
-                outline_output[size * 2 - i - 1].x = e.x;
-                outline_output[size * 2 - i - 1].y = e.y;
-            }
-            i++;
-        }
-    };
-
-    auto on_triange = [i = 0u, &triangles_output](v2 p1, v2 p2, v2 p3, v2 p4) mutable {
-        if ((i + 5) >= triangles_output.size()) {
-            log_err("fatal: check fialed: ({}) >= {}", i + 5, triangles_output.size());
-        }
-        assert((i + 5) < triangles_output.size());
-        // generate two triangles per one quad, 6 vertex total, for using ebo we
-        // could just emit four points clockwise.
-
-        triangles_output[i + 0].x = p1.x;
-        triangles_output[i + 0].y = p1.y;
-        triangles_output[i + 1].x = p2.x;
-        triangles_output[i + 1].y = p2.y;
-        triangles_output[i + 2].x = p3.x;
-        triangles_output[i + 2].y = p3.y;
-
-        triangles_output[i + 3].x = p3.x;
-        triangles_output[i + 3].y = p3.y;
-        triangles_output[i + 4].x = p4.x;
-        triangles_output[i + 4].y = p4.y;
-        triangles_output[i + 5].x = p1.x;
-        triangles_output[i + 5].y = p1.y;
-
-        i += 6;
-    };
-    double FACTOR = 1000.0;
-
+// Walks polyline and calls on_offset_point(k, d, e) for each point k which
+// got its offset points: d on the main side and e on the other one (only
+// with GenerateBothSides). Points with parallel adjacent segments are skipped.
+template <class Settings, class OnOffsetPoint>
+static void offset_points(span<const p32> polyline, double width, DebugCtx &ctx,
+                          OnOffsetPoint &&on_offset_point) {
     // Process polyline by overving 3 adjacent vertices
     v2 prev_d, prev_e;
     for (size_t i = 2; i < polyline.size(); ++i) {
@@ -150,14 +127,7 @@ static std::vector<p32> generate_geometry(span<p32> polyline, span<p32> triangle
                 prev_e = p1 + -t1;
             }
 
-            on_outline_point(prev_d, prev_e);
-        }
-
-        // generate two triangles epr one side: (p1, prev_d, d) and (p1, d, p2).
-        on_triange(p1, prev_d, d, p2);
-
-        if constexpr (Settings::GenerateBothSides) {
-            on_triange(p1, prev_e, e, p2);
+            on_offset_point(i - 2, prev_d, prev_e);
         }
 
         if constexpr (Settings::GenerateDebugGeometry) {
@@ -169,7 +139,7 @@ static std::vector<p32> generate_geometry(span<p32> polyline, span<p32> triangle
             }
         }
 
-        on_outline_point(d, e);
+        on_offset_point(i - 1, d, e);
 
         prev_d = d;
         prev_e = e;
@@ -180,25 +150,246 @@ static std::vector<p32> generate_geometry(span<p32> polyline, span<p32> triangle
     auto p2 = polyline[polyline.size() - 1];
     v2 a{p1, p2};
     v2 perp_a = normalized(v2{-a.y, a.x}) * width;
-    v2 d = p2 + perp_a;
-    v2 e = p2 + -perp_a;
+    on_offset_point(polyline.size() - 1, p2 + perp_a, p2 + -perp_a);
+}
+
+// Triangles are appended to triangles_output, outline goes to outline_output
+// which must hold required_capacity().outline_points points.
+template <class Settings = DefaultRenderSettings>
+static std::vector<p32> generate_geometry(span<const p32> polyline,
+                                          OutputWriter<p32> &triangles_output,
+                                          span<p32> outline_output, double width, DebugCtx &ctx) {
+    // to draw by two points, we need to have some special handling
+    // which I have not implemented yet.
+    assert(polyline.size() > 2);
+    if (polyline.size() < 3) {
+        log_warn("line with less than 3 points");
+        return {{}};
+    }
+
+    // hopefully it is inlinable and thus compatible with optimizations
+    auto on_outline_point = [i = 0u, &outline_output, size = polyline.size()](v2 d, v2 e) mutable {
+        if constexpr (Settings::GenerateOutline) {
+            assert(outline_output.size() >= (Settings::GenerateBothSides ? 2 : 1) * size);
+            outline_output[i].x = d.x;
+            outline_output[i].y = d.y;
+            if constexpr (Settings::GenerateBothSides) {
+                outline_output[size * 2 - i - 1].x = e.x;
+                outline_output[size * 2 - i - 1].y = e.y;
+            }
+            i++;
+        }
+    };
+
+    auto on_triange = [&triangles_output](v2 p1, v2 p2, v2 p3, v2 p4) {
+        // generate two triangles per one quad, 6 vertex total, see
+        // generate_geometry_indexed() for the EBO variant.
+        auto quad = triangles_output.append(6);
+
+        quad[0].x = p1.x;
+        quad[0].y = p1.y;
+        quad[1].x = p2.x;
+        quad[1].y = p2.y;
+        quad[2].x = p3.x;
+        quad[2].y = p3.y;
+
+        quad[3].x = p3.x;
+        quad[3].y = p3.y;
+        quad[4].x = p4.x;
+        quad[4].y = p4.y;
+        quad[5].x = p1.x;
+        quad[5].y = p1.y;
+    };
+
+    v2 prev_d, prev_e;
+    offset_points<Settings>(polyline, width, ctx, [&](size_t k, v2 d, v2 e) {
+        if (k > 0) {
+            // generate two triangles per side: (p1, prev_d, d) and (d, p2, p1).
+            v2 p1 = polyline[k - 1];
+            v2 p2 = polyline[k];
+            on_triange(p1, prev_d, d, p2);
+            if constexpr (Settings::GenerateBothSides) {
+                on_triange(p1, prev_e, e, p2);
+            }
+        }
+        on_outline_point(d, e);
+        prev_d = d;
+        prev_e = e;
+    });
 
-    on_outline_point(d, e);
-    on_triange(p1, prev_d, d, p2);
+    return {{}};
+}
+
+// Exact size of generate_geometry_indexed output for polyline.
+struct IndexedCapacity {
+    size_t vertices; // polyline point and its offset point per side.
+    size_t indices;  // 6 per quad, a quad per segment and side.
+};
 
-    if constexpr (Settings::GenerateBothSides) {
-        on_triange(p1, prev_e, e, p2);
+template <class Settings = DefaultRenderSettings>
+IndexedCapacity required_indexed_capacity(span<const p32> polyline) {
+    if (polyline.size() < 3) {
+        return {0, 0};
     }
+    const size_t sides = Settings::GenerateBothSides ? 2 : 1;
+    return {(1 + sides) * polyline.size(), 6 * sides * (polyline.size() - 1)};
+}
 
-    if constexpr (Settings::GenerateDebugGeometry) {
-        // ctx.add_line(p1, p2, colors::black); // original polyline
-        // ctx.add_line(prev_d, d, colors::blue);
-        // if constexpr (Settings::GenerateBothSides) {
-        //   ctx.add_line(prev_e, e, colors::blue);
-        // }
+// Same triangles as generate_geometry() emits, but each polyline point and
+// its offset points are written to vertices_output once, interleaved as
+// (p, d[, e]), and quads reference them by indices, so neighbouring quads
+// share an edge. Indices start at 0 at the beginning of vertices_output
+// storage, rebase them when concatenating. Returns written vertices and
+// indices count.
+template <class Settings = DefaultRenderSettings>
+static std::tuple<size_t, size_t>
+generate_geometry_indexed(span<const p32> polyline, OutputWriter<p32> &vertices_output,
+                          OutputWriter<uint32_t> &indices_output, span<p32> outline_output,
+                          double width, DebugCtx &ctx) {
+    assert(polyline.size() > 2);
+    if (polyline.size() < 3) {
+        log_warn("line with less than 3 points");
+        return {0, 0};
     }
+    const size_t vertices_before = vertices_output.size();
+    const size_t indices_before = indices_output.size();
+
+    auto on_quad = [&indices_output](uint32_t p1, uint32_t p2, uint32_t p3, uint32_t p4) {
+        auto quad = indices_output.append(6);
+        quad[0] = p1;
+        quad[1] = p2;
+        quad[2] = p3;
+        quad[3] = p3;
+        quad[4] = p4;
+        quad[5] = p1;
+    };
 
-    return {{}};
+    size_t outline_i = 0;
+    const size_t size = polyline.size();
+    uint32_t prev_p = 0, prev_d = 0, prev_e = 0;
+    offset_points<Settings>(polyline, width, ctx, [&](size_t k, v2 d, v2 e) {
+        const auto p = static_cast<uint32_t>(vertices_output.size());
+        vertices_output.push_back(polyline[k]);
+        vertices_output.push_back(from_v2(d));
+        if constexpr (Settings::GenerateBothSides) {
+            vertices_output.push_back(from_v2(e));
+        }
+
+        if (k > 0) {
+            on_quad(prev_p, prev_d, p + 1, p);
+            if constexpr (Settings::GenerateBothSides) {
+                on_quad(prev_p, prev_e, p + 2, p);
+            }
+        }
+        if constexpr (Settings::GenerateOutline) {
+            outline_output[outline_i] = from_v2(d);
+            if constexpr (Settings::GenerateBothSides) {
+                outline_output[size * 2 - outline_i - 1] = from_v2(e);
+            }
+            outline_i++;
+        }
+        prev_p = p;
+        prev_d = p + 1;
+        prev_e = p + 2;
+    });
+
+    return {vertices_output.size() - vertices_before, indices_output.size() - indices_before};
+}
+
+// Tessellates independent polylines on `workers` threads, polylines[i] with
+// widths[i]. Triangles and outlines are appended to out_triangles and
+// out_outlines, each polyline into its own slice at offset given by prefix
+// sum of required_capacity(), so the result is the same as of
+// generate_geometry() called for each polyline in order.
+template <class Settings = DefaultRenderSettings>
+static void generate_geometry_batch(span<const span<const p32>> polylines,
+                                    span<const double> widths, vector<p32> &out_triangles,
+                                    vector<p32> &out_outlines,
+                                    size_t workers = parallel::default_concurrency()) {
+    static_assert(!Settings::GenerateDebugGeometry, "DebugCtx can't be shared between threads");
+    assert(widths.size() == polylines.size());
+    const size_t count = polylines.size();
+    vector<Capacity> offsets(count + 1, Capacity{out_triangles.size(), out_outlines.size()});
+    for (size_t i = 0; i < count; ++i) {
+        const auto c = required_capacity<Settings>(polylines[i]);
+        offsets[i + 1] = {offsets[i].triangles_vertices + c.triangles_vertices,
+                          offsets[i].outline_points + c.outline_points};
+    }
+    out_triangles.resize(offsets[count].triangles_vertices);
+    // Points with parallel segments get no outline points, their slots stay
+    // zero rather than uninitialized.
+    out_outlines.resize(offsets[count].outline_points, p32(0, 0));
+
+    std::atomic<size_t> next{0};
+    workers = std::clamp<size_t>(workers, 1, std::max<size_t>(count, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        DebugCtx ctx; // not drawn to, see static_assert above.
+        for (size_t i = next++; i < count; i = next++) {
+            const Capacity &first = offsets[i], &last = offsets[i + 1];
+            if (first.triangles_vertices == last.triangles_vertices) {
+                continue; // less than 3 points.
+            }
+            OutputWriter<p32> triangles(
+                span<p32>(out_triangles.data() + first.triangles_vertices,
+                          last.triangles_vertices - first.triangles_vertices));
+            span<p32> outline(out_outlines.data() + first.outline_points,
+                              last.outline_points - first.outline_points);
+            generate_geometry<Settings>(polylines[i], triangles, outline, widths[i], ctx);
+        }
+    });
+}
+
+// Indexed counterpart of generate_geometry_batch(): vertices and indices are
+// appended to out_vertices and out_indices, indices are rebased to point into
+// out_vertices, the same as generate_geometry_indexed() for each polyline in
+// order would give after concatenation.
+template <class Settings = DefaultRenderSettings>
+static void generate_geometry_indexed_batch(span<const span<const p32>> polylines,
+                                            span<const double> widths, vector<p32> &out_vertices,
+                                            vector<uint32_t> &out_indices,
+                                            vector<p32> &out_outlines,
+                                            size_t workers = parallel::default_concurrency()) {
+    static_assert(!Settings::GenerateDebugGeometry, "DebugCtx can't be shared between threads");
+    assert(widths.size() == polylines.size());
+    struct Offsets {
+        size_t vertices, indices, outline_points;
+    };
+    const size_t count = polylines.size();
+    vector<Offsets> offsets(count + 1,
+                            Offsets{out_vertices.size(), out_indices.size(), out_outlines.size()});
+    for (size_t i = 0; i < count; ++i) {
+        const auto c = required_indexed_capacity<Settings>(polylines[i]);
+        const auto outline = required_capacity<Settings>(polylines[i]).outline_points;
+        offsets[i + 1] = {offsets[i].vertices + c.vertices, offsets[i].indices + c.indices,
+                          offsets[i].outline_points + outline};
+    }
+    assert(offsets[count].vertices <= std::numeric_limits<uint32_t>::max());
+    out_vertices.resize(offsets[count].vertices);
+    out_indices.resize(offsets[count].indices);
+    out_outlines.resize(offsets[count].outline_points, p32(0, 0)); // see above.
+
+    std::atomic<size_t> next{0};
+    workers = std::clamp<size_t>(workers, 1, std::max<size_t>(count, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        DebugCtx ctx; // not drawn to, see static_assert above.
+        for (size_t i = next++; i < count; i = next++) {
+            const Offsets &first = offsets[i], &last = offsets[i + 1];
+            if (first.vertices == last.vertices) {
+                continue; // less than 3 points.
+            }
+            OutputWriter<p32> vertices(span<p32>(out_vertices.data() + first.vertices,
+                                                 last.vertices - first.vertices));
+            OutputWriter<uint32_t> indices(span<uint32_t>(out_indices.data() + first.indices,
+                                                          last.indices - first.indices));
+            span<p32> outline(out_outlines.data() + first.outline_points,
+                              last.outline_points - first.outline_points);
+            generate_geometry_indexed<Settings>(polylines[i], vertices, indices, outline,
+                                                widths[i], ctx);
+            for (auto &index : indices.written()) {
+                index += first.vertices;
+            }
+        }
+    });
 }
 
 } // namespace roads::tesselation
\ No newline at end of file
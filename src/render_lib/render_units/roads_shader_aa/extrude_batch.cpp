@@ -0,0 +1,115 @@
+#include "extrude_batch.h"
+#include "extrude_batch_kernels.h"
+
+#ifdef GG_SIMD_SSE2
+#include <emmintrin.h>
+#include "extrude_batch_impl.h"
+#endif
+
+// Batch miter points for AA outline extrusion. Layout follows
+// gg/mercator_batch.cpp: SSE2 kernel lives here, AVX2 kernel in
+// extrude_batch_avx2.cpp which is the only file compiled with -mavx2.
+namespace roads_shader_aa {
+
+#ifdef GG_SIMD_SSE2
+namespace detail {
+namespace {
+struct Sse2Ops {
+    using vd = __m128d;
+    static constexpr size_t width = 2;
+
+    static vd set1(double v) { return _mm_set1_pd(v); }
+    static vd load(const double *p) { return _mm_loadu_pd(p); }
+    static void store(double *p, vd v) { _mm_storeu_pd(p, v); }
+    static vd add(vd a, vd b) { return _mm_add_pd(a, b); }
+    static vd sub(vd a, vd b) { return _mm_sub_pd(a, b); }
+    static vd mul(vd a, vd b) { return _mm_mul_pd(a, b); }
+    static vd div(vd a, vd b) { return _mm_div_pd(a, b); }
+    static vd sqrt(vd a) { return _mm_sqrt_pd(a); }
+    static vd neg(vd a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+    // lanes where |a| < v, false for NaN as std::fabs(a) < v is.
+    static unsigned abs_lt_mask(vd a, double v) {
+        const vd abs = _mm_andnot_pd(_mm_set1_pd(-0.0), a);
+        return _mm_movemask_pd(_mm_cmplt_pd(abs, _mm_set1_pd(v)));
+    }
+};
+} // namespace
+
+size_t miter_points_sse2(const double *x, const double *y, size_t n, double width, double *out_x,
+                         double *out_y) {
+    return miter_points_impl<Sse2Ops>(x, y, n, width, out_x, out_y);
+}
+} // namespace detail
+#endif // GG_SIMD_SSE2
+
+namespace {
+size_t miter_points_scalar(span<const p32> polyline, double width, v2 *out) {
+    size_t first_parallel = polyline.size();
+    for (size_t i = 1; i + 1 < polyline.size(); ++i) {
+        v2 p1(polyline[i - 1]);
+        v2 p2(polyline[i]);
+        v2 p3(polyline[i + 1]);
+        v2 a(p1, p2);
+        v2 b(p2, p3);
+        v2 t1 = normalized(v2(-a.y, a.x)) * width;
+        v2 t2 = normalized(v2(-b.y, b.x)) * width;
+        if (!gg::lines_intersection(p1 + t1, p2 + t1, p3 + t2, p2 + t2, out[i - 1]) &&
+            first_parallel == polyline.size()) {
+            first_parallel = i;
+        }
+    }
+    return first_parallel;
+}
+} // namespace
+
+size_t miter_points(span<const p32> polyline, double width, v2 *out, gg::simd::Isa kernel) {
+    using kernel_fn = size_t (*)(const double *, const double *, size_t, double, double *,
+                                 double *);
+    kernel_fn simd_kernel = nullptr;
+    switch (gg::simd::usable(kernel, detail::extrude_avx2_compiled())) {
+#ifdef GG_SIMD_SSE2
+    case gg::simd::Isa::avx2:
+        simd_kernel = detail::miter_points_avx2;
+        break;
+    case gg::simd::Isa::sse2:
+        simd_kernel = detail::miter_points_sse2;
+        break;
+#else
+    case gg::simd::Isa::avx2:
+    case gg::simd::Isa::sse2:
+#endif
+    case gg::simd::Isa::scalar:
+        break;
+    }
+    if (!simd_kernel || polyline.size() < 3) {
+        return miter_points_scalar(polyline, width, out);
+    }
+
+    // Points are converted to doubles chunk by chunk on stack, neighbouring
+    // chunks share two points.
+    constexpr size_t CHUNK = 256;
+    double x[CHUNK + 2], y[CHUNK + 2], out_x[CHUNK], out_y[CHUNK];
+    size_t first_parallel = polyline.size();
+    for (size_t first = 1; first + 1 < polyline.size(); first += CHUNK) {
+        const size_t n = std::min(CHUNK, polyline.size() - 1 - first);
+        for (size_t k = 0; k < n + 2; ++k) {
+            x[k] = polyline[first - 1 + k].x;
+            y[k] = polyline[first - 1 + k].y;
+        }
+        const size_t parallel = simd_kernel(x, y, n, width, out_x, out_y);
+        if (parallel != n && first_parallel == polyline.size()) {
+            first_parallel = first + parallel;
+        }
+        for (size_t k = 0; k < n; ++k) {
+            out[first - 1 + k] = v2(out_x[k], out_y[k]);
+        }
+    }
+    return first_parallel;
+}
+
+size_t miter_points(span<const p32> polyline, double width, v2 *out) {
+    static const gg::simd::Isa best = gg::simd::best(detail::extrude_avx2_compiled());
+    return miter_points(polyline, width, out, best);
+}
+
+} // namespace roads_shader_aa
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "common/global.h"
+#include "gg/simd.h"
+
+namespace roads_shader_aa {
+
+// Miter points of polyline outline offset by `width` (see ExtrudePolyline):
+// for every inner point polyline[i], i in [1, N - 1), out[i - 1] receives the
+// point where lines of its two adjacent segments shifted by width meet.
+// Returns index of the first inner point whose adjacent segments are parallel,
+// N if there is none.
+//
+// SIMD kernels do exactly the same operations as the scalar path in the same
+// order (no FMA), so results of all kernels are bit identical.
+size_t miter_points(span<const p32> polyline, double width, v2 *out);
+size_t miter_points(span<const p32> polyline, double width, v2 *out,
+                    gg::simd::Isa kernel);
+
+} // namespace roads_shader_aa
@@ -0,0 +1,53 @@
+// This file is compiled with -mavx2 (see CMakeLists.txt). Do not include
+// anything with inline functions here (gg.h, <algorithm>, etc.): linker may
+// pick AVX2 version of such function for the whole program.
+#include "extrude_batch_kernels.h"
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+#include "extrude_batch_impl.h"
+
+namespace roads_shader_aa::detail {
+namespace {
+struct Avx2Ops {
+    using vd = __m256d;
+    static constexpr size_t width = 4;
+
+    static vd set1(double v) { return _mm256_set1_pd(v); }
+    static vd load(const double *p) { return _mm256_loadu_pd(p); }
+    static void store(double *p, vd v) { _mm256_storeu_pd(p, v); }
+    static vd add(vd a, vd b) { return _mm256_add_pd(a, b); }
+    static vd sub(vd a, vd b) { return _mm256_sub_pd(a, b); }
+    static vd mul(vd a, vd b) { return _mm256_mul_pd(a, b); }
+    static vd div(vd a, vd b) { return _mm256_div_pd(a, b); }
+    static vd sqrt(vd a) { return _mm256_sqrt_pd(a); }
+    static vd neg(vd a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+    // see Sse2Ops::abs_lt_mask.
+    static unsigned abs_lt_mask(vd a, double v) {
+        const vd abs = _mm256_andnot_pd(_mm256_set1_pd(-0.0), a);
+        return _mm256_movemask_pd(_mm256_cmp_pd(abs, _mm256_set1_pd(v), _CMP_LT_OQ));
+    }
+};
+} // namespace
+
+size_t miter_points_avx2(const double *x, const double *y, size_t n, double width, double *out_x,
+                         double *out_y) {
+    return miter_points_impl<Avx2Ops>(x, y, n, width, out_x, out_y);
+}
+
+bool extrude_avx2_compiled() { return true; }
+} // namespace roads_shader_aa::detail
+
+#else
+
+namespace roads_shader_aa::detail {
+// Never called, miter_points checks extrude_avx2_compiled() first.
+size_t miter_points_avx2(const double *, const double *, size_t n, double, double *, double *) {
+    return n;
+}
+
+bool extrude_avx2_compiled() { return false; }
+} // namespace roads_shader_aa::detail
+
+#endif // __AVX2__
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "extrude_batch_kernels.h"
+
+// Generic part of SIMD miter kernels, written against the same kind of tiny
+// vector operations set as gg/mercator_batch_impl.h and included by each
+// kernel translation unit inside of anonymous namespace.
+//
+// Each lane repeats the scalar path of ExtrudePolyline operation by operation:
+//   t1 = normalized(v2(-a.y, a.x)) * width, a = p2 - p1
+//   t2 = normalized(v2(-b.y, b.x)) * width, b = p3 - p2
+//   d = gg::lines_intersection(p1 + t1, p2 + t1, p3 + t2, p2 + t2)
+// add/sub/mul/div/sqrt are correctly rounded, so results are bit identical.
+namespace roads_shader_aa::detail {
+namespace {
+
+template <class V>
+unsigned miter_lanes(const double *x, const double *y, double width, double *out_x,
+                     double *out_y) {
+    using vd = typename V::vd;
+    const vd x1 = V::load(x), x2 = V::load(x + 1), x3 = V::load(x + 2);
+    const vd y1 = V::load(y), y2 = V::load(y + 1), y3 = V::load(y + 2);
+    const vd w = V::set1(width);
+
+    // normalized(v2(-a.y, a.x)) * width, len is sqrt of dot(v, v).
+    const vd ax = V::sub(x2, x1), ay = V::sub(y2, y1);
+    const vd n1x = V::neg(ay), n1y = ax;
+    const vd len1 = V::sqrt(V::add(V::mul(n1x, n1x), V::mul(n1y, n1y)));
+    const vd t1x = V::mul(V::div(n1x, len1), w), t1y = V::mul(V::div(n1y, len1), w);
+
+    const vd bx = V::sub(x3, x2), by = V::sub(y3, y2);
+    const vd n2x = V::neg(by), n2y = bx;
+    const vd len2 = V::sqrt(V::add(V::mul(n2x, n2x), V::mul(n2y, n2y)));
+    const vd t2x = V::mul(V::div(n2x, len2), w), t2y = V::mul(V::div(n2y, len2), w);
+
+    // lines_intersection_impl(p0, p1, p2, p3) with
+    // p0 = p1 + t1, p1 = p2 + t1, p2 = p3 + t2, p3 = p2 + t2.
+    const vd q0x = V::add(x1, t1x), q0y = V::add(y1, t1y);
+    const vd q1x = V::add(x2, t1x), q1y = V::add(y2, t1y);
+    const vd q2x = V::add(x3, t2x), q2y = V::add(y3, t2y);
+    const vd q3x = V::add(x2, t2x), q3y = V::add(y2, t2y);
+    const vd s1x = V::sub(q1x, q0x), s1y = V::sub(q1y, q0y);
+    const vd s2x = V::sub(q3x, q2x), s2y = V::sub(q3y, q2y);
+    const vd det = V::sub(V::mul(s1x, s2y), V::mul(s1y, s2x));
+    const vd t = V::div(V::sub(V::mul(s2x, V::sub(q0y, q2y)), V::mul(s2y, V::sub(q0x, q2x))), det);
+
+    V::store(out_x, V::add(q0x, V::mul(t, s1x)));
+    V::store(out_y, V::add(q0y, V::mul(t, s1y)));
+    return V::abs_lt_mask(det, 1e-5);
+}
+
+template <class V>
+size_t miter_points_impl(const double *x, const double *y, size_t n, double width, double *out_x,
+                         double *out_y) {
+    constexpr size_t W = V::width;
+    size_t first_parallel = n;
+    const auto note_parallel = [&](size_t base, unsigned mask) {
+        for (size_t k = 0; k < W && first_parallel == n; ++k) {
+            if (mask & (1u << k)) {
+                first_parallel = base + k;
+            }
+        }
+    };
+
+    size_t i = 0;
+    for (; i + W <= n; i += W) {
+        note_parallel(i, miter_lanes<V>(x + i, y + i, width, out_x + i, out_y + i));
+    }
+    if (i < n) {
+        // padding lanes get zero length segments, their results and flags are
+        // dropped.
+        double x_tail[W + 2] = {}, y_tail[W + 2] = {};
+        double out_x_tail[W], out_y_tail[W];
+        for (size_t k = 0; k < n - i + 2; ++k) {
+            x_tail[k] = x[i + k];
+            y_tail[k] = y[i + k];
+        }
+        const unsigned mask = miter_lanes<V>(x_tail, y_tail, width, out_x_tail, out_y_tail);
+        note_parallel(i, mask & ((1u << (n - i)) - 1));
+        for (size_t k = 0; k < n - i; ++k) {
+            out_x[i + k] = out_x_tail[k];
+            out_y[i + k] = out_y_tail[k];
+        }
+    }
+    return first_parallel;
+}
+
+} // namespace
+} // namespace roads_shader_aa::detail
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Private interface between roads_shader_aa::miter_points and its SIMD
+// kernels, same rules as for gg/mercator_batch.h: kernels are compiled with
+// their own instruction set flags, so no inline code here.
+namespace roads_shader_aa::detail {
+
+// x and y hold n + 2 polyline points, out_x and out_y receive miter points of
+// points [1, n]. Returns index (in [0, n)) of the first miter point whose
+// segments are parallel, n if there is none.
+size_t miter_points_sse2(const double *x, const double *y, size_t n, double width, double *out_x,
+                         double *out_y);
+size_t miter_points_avx2(const double *x, const double *y, size_t n, double width, double *out_x,
+                         double *out_y);
+
+bool extrude_avx2_compiled();
+
+} // namespace roads_shader_aa::detail
@@ -1,4 +1,8 @@
 #include "common/global.h"
+#include "common/output_writer.h"
+#include "common/parallel.h"
+#include "extrude_batch.h"
+#include <atomic>
 #include "render_lib/debug_ctx.h"
 #include "types.h"
 
@@ -21,87 +25,75 @@ template <class EventHandler> struct ExtrudePolyline : public EventHandler {
     template <typename... Args>
     ExtrudePolyline(Args &&... args) : EventHandler(std::forward<Args>(args)...) {}
 
-    void extrude_polyline(span<p32> polyline, double width, DebugCtx &debug_ctx) {
+    void extrude_polyline(span<const p32> polyline, double width, DebugCtx &debug_ctx) {
         assert(polyline.size() > 2);
         if (polyline.size() < 3) {
             log_err("line with less than 3 points");
             return;
         }
         const size_t N = polyline.size();
-        v2 prev_d;
-        for (size_t i = 1; i < N - 1; ++i) {
-            v2 p1(polyline[i - 1]);
-            v2 p2(polyline[i]);
-            v2 p3(polyline[i + 1]);
-            v2 a(p1, p2);
-            v2 b(p2, p3);
-            v2 t1 = normalized(v2(-a.y, a.x)) * width;
-            v2 t2 = normalized(v2(-b.y, b.x)) * width;
-            v2 d;
-            const bool intersect = gg::lines_intersection(p1 + t1, p2 + t1, p3 + t2, p2 + t2, d);
-            if (unlikely(!intersect)) {
+        // miter points are computed by batch kernel a chunk at a time.
+        constexpr size_t CHUNK = 256;
+        v2 miters[CHUNK];
+        for (size_t first = 1; first < N - 1; first += CHUNK) {
+            const size_t n = std::min(CHUNK, N - 1 - first);
+            auto chunk = polyline.subspan(first - 1, n + 2);
+            const size_t parallel = miter_points(chunk, width, miters);
+            if (unlikely(parallel != chunk.size())) {
+                const size_t i = first - 1 + parallel;
                 log_err("parallel lines at {},{},{}", i - 1, i, i + 1);
                 assert(false);
             }
-            EventHandler::next(p2, d);
-            prev_d = d;
+            for (size_t k = 0; k < n; ++k) {
+                EventHandler::next(v2(polyline[first + k]), miters[k]);
+            }
         }
         EventHandler::finish();
     }
 };
 
 struct PolylineAAHandler {
-    vector<AAVertex> &out_vertices;
-    vector<uint32_t> &out_indices;
-    size_t out_vertices_offset;
-    size_t out_indices_offset;
-    size_t vi;
-    size_t ii;
-
-    PolylineAAHandler(vector<AAVertex> &out_vertices, size_t out_vertices_offset,
-                      vector<uint32_t> &out_indices, size_t out_indices_offset)
+    OutputWriter<AAVertex> &out_vertices;
+    OutputWriter<uint32_t> &out_indices;
+    size_t first_vertex;
+
+    PolylineAAHandler(OutputWriter<AAVertex> &out_vertices, OutputWriter<uint32_t> &out_indices)
         : out_vertices(out_vertices), out_indices(out_indices),
-          out_vertices_offset(out_vertices_offset), out_indices_offset(out_indices_offset),
-          vi(out_vertices_offset), ii(out_indices_offset) {}
+          first_vertex(out_vertices.size()) {}
 
     void add_quad(size_t i_p1, size_t i_prev_d, size_t i_d, size_t i_p2) {
-        out_indices[ii++] = i_p1;
-        out_indices[ii++] = i_prev_d;
-        out_indices[ii++] = i_d;
-        out_indices[ii++] = i_p1;
-        out_indices[ii++] = i_d;
-        out_indices[ii++] = i_p2;
+        auto quad = out_indices.append(6);
+        quad[0] = i_p1;
+        quad[1] = i_prev_d;
+        quad[2] = i_d;
+        quad[3] = i_p1;
+        quad[4] = i_d;
+        quad[5] = i_p2;
     }
 
     void next(v2 p, v2 d) {
-        assert((out_vertices.size() - vi) > 2);
-        assert((out_indices.size() - ii) > 6);
         // -----------------------------------
         //
         //  prev_d            d
         //  o----------------o
         //  |            v /  \
-    //  o------------o     \
-    //  p1         p2 \
-    //
+        //  o------------o     \
+        //  p1         p2 \
+        //
         // -----------------------------------
-
-        out_vertices[vi].coords.x = static_cast<uint32_t>(std::round(p.x));
-        out_vertices[vi].coords.y = static_cast<uint32_t>(std::round(p.y));
-        out_vertices[vi].is_outer = 0;
+        const p32 coords(static_cast<uint32_t>(std::round(p.x)),
+                         static_cast<uint32_t>(std::round(p.y)));
+        auto v = v2(p, d);
+        auto vertices = out_vertices.append(2);
+        vertices[0] = AAVertex{coords, 0, 0, {}};
 
         // we don't use d point here but basically give d point p's cooridinates
         // so that by adding extent_vec it should be d. The shader will add its
         // outer coordinate with extent_vec and it will be what d is in here.
-        out_vertices[vi + 1].coords.x = static_cast<uint32_t>(std::round(p.x));
-        out_vertices[vi + 1].coords.y = static_cast<uint32_t>(std::round(p.y));
-        out_vertices[vi + 1].is_outer = 1;
-        auto v = v2(p, d);
-        out_vertices[vi + 1].extent_vec[0] = v.x;
-        out_vertices[vi + 1].extent_vec[1] = v.y;
-        vi += 2;
+        vertices[1] = AAVertex{coords, 1, 0, {float(v.x), float(v.y)}};
 
-        if (likely((vi - out_vertices_offset) > 2)) {
+        const size_t vi = out_vertices.size();
+        if (likely((vi - first_vertex) > 2)) {
             // first point just collects vertices but does not produce triangles yet
             // since there is no previous point.
             add_quad(vi - 4, vi - 3, vi - 1, vi - 2);
@@ -113,15 +105,78 @@ struct PolylineAAHandler {
     }
 };
 
-static std::tuple<size_t, size_t> make_geometry(span<p32> polyline, double width,
-                                                vector<AAVertex> &out_vertices,
-                                                size_t out_vertices_offset,
-                                                vector<uint32_t> &out_indices,
-                                                size_t out_indices_offset, DebugCtx &debug_ctx) {
-    ExtrudePolyline<PolylineAAHandler> extrude(out_vertices, out_vertices_offset, out_indices,
-                                               out_indices_offset);
+struct Capacity {
+    size_t vertices;
+    size_t indices;
+};
+
+// Exact size of make_geometry output for polyline: two vertices per inner
+// point and a quad between each two of them.
+inline Capacity required_capacity(span<const p32> polyline) {
+    if (polyline.size() < 3) {
+        return {0, 0};
+    }
+    return {2 * (polyline.size() - 2), 6 * (polyline.size() - 3)};
+}
+
+// Appends AA geometry of polyline, indices point into the whole storage of
+// out_vertices. Returns number of vertices and indices appended.
+static std::tuple<size_t, size_t> make_geometry(span<const p32> polyline, double width,
+                                                OutputWriter<AAVertex> &out_vertices,
+                                                OutputWriter<uint32_t> &out_indices,
+                                                DebugCtx &debug_ctx) {
+    const size_t vertices_before = out_vertices.size();
+    const size_t indices_before = out_indices.size();
+    ExtrudePolyline<PolylineAAHandler> extrude(out_vertices, out_indices);
     extrude.extrude_polyline(polyline, width, debug_ctx);
-    return {extrude.vi - out_vertices_offset, extrude.ii - out_indices_offset};
+    return {out_vertices.size() - vertices_before, out_indices.size() - indices_before};
+}
+
+// Extrudes independent polylines on `workers` threads, polylines[i] with
+// widths[i]. Output is appended to out_vertices and out_indices: every
+// polyline gets its own slice at offset given by prefix sum of
+// required_capacity(), so the result is the same as of make_geometry() called
+// for each polyline in order. Returns number of vertices and indices appended.
+// Every appended element is written, so with uninit_vector outputs are not
+// zero-filled first.
+template <class VertexAlloc, class IndexAlloc>
+static std::tuple<size_t, size_t>
+make_geometry_batch(span<const span<const p32>> polylines, span<const double> widths,
+                    std::vector<AAVertex, VertexAlloc> &out_vertices,
+                    std::vector<uint32_t, IndexAlloc> &out_indices,
+                    size_t workers = parallel::default_concurrency()) {
+    assert(widths.size() == polylines.size());
+    const size_t count = polylines.size();
+    vector<Capacity> offsets(count + 1, Capacity{out_vertices.size(), out_indices.size()});
+    for (size_t i = 0; i < count; ++i) {
+        const auto c = required_capacity(polylines[i]);
+        offsets[i + 1] = {offsets[i].vertices + c.vertices, offsets[i].indices + c.indices};
+    }
+    out_vertices.resize(offsets[count].vertices);
+    out_indices.resize(offsets[count].indices);
+
+    std::atomic<size_t> next{0};
+    workers = std::clamp<size_t>(workers, 1, std::max<size_t>(count, 1));
+    parallel::run_workers(workers, [&](size_t) {
+        DebugCtx debug_ctx; // extrusion does not draw anything, only to satisfy the interface.
+        for (size_t i = next++; i < count; i = next++) {
+            const Capacity &first = offsets[i], &last = offsets[i + 1];
+            OutputWriter<AAVertex> vertices(span<AAVertex>(
+                out_vertices.data() + first.vertices, last.vertices - first.vertices));
+            OutputWriter<uint32_t> indices(span<uint32_t>(out_indices.data() + first.indices,
+                                                          last.indices - first.indices));
+            if (vertices.remaining() == 0) {
+                continue; // less than 3 points, make_geometry refuses those.
+            }
+            make_geometry(polylines[i], widths[i], vertices, indices, debug_ctx);
+            // indices are relative to the slice, rebase them in place.
+            for (auto &idx : indices.written()) {
+                idx += first.vertices;
+            }
+        }
+    });
+    return {offsets[count].vertices - offsets[0].vertices,
+            offsets[count].indices - offsets[0].indices};
 }
 
 } // namespace roads_shader_aa
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "packed_vertex.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+
+namespace roads_shader_aa {
+
+namespace {
+constexpr uint32_t QUANTIZATION_STEPS = 65535;
+constexpr uint32_t UNSET = std::numeric_limits<uint32_t>::max();
+
+uint16_t quantize(uint32_t coord, uint32_t origin, float step) {
+    assert(coord >= origin);
+    const double q = std::round((coord - origin) / double(step));
+    return static_cast<uint16_t>(std::min<double>(q, QUANTIZATION_STEPS));
+}
+} // namespace
+
+// See "float_to_half_fast3_rtne" by F. Giesen: subnormals are rounded by
+// float addition of magic number, normals by adding rounding bias to the bits.
+uint16_t float_to_half(float value) {
+    constexpr uint32_t F32_INFINITY = 255u << 23;
+    constexpr uint32_t F16_OVERFLOW = (127u + 16) << 23; // 2^16, rounds to infinity.
+    constexpr uint32_t F16_MIN_NORMAL = 113u << 23;      // 2^-14.
+    constexpr uint32_t DENORM_MAGIC = ((127u - 15) + (23 - 10) + 1) << 23; // 0.5f.
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    uint16_t half;
+    if (bits >= F16_OVERFLOW) {
+        half = bits > F32_INFINITY ? 0x7e00 : 0x7c00; // NaN stays NaN.
+    } else if (bits < F16_MIN_NORMAL) {
+        float magic, f;
+        std::memcpy(&magic, &DENORM_MAGIC, sizeof(magic));
+        std::memcpy(&f, &bits, sizeof(f));
+        f += magic;
+        std::memcpy(&bits, &f, sizeof(bits));
+        half = static_cast<uint16_t>(bits - DENORM_MAGIC);
+    } else {
+        const uint32_t mantissa_odd = (bits >> 13) & 1;
+        // rebias exponent and round, odd mantissa makes ties go to even.
+        bits += (uint32_t(15 - 127) << 23) + 0xfff + mantissa_odd;
+        half = static_cast<uint16_t>(bits >> 13);
+    }
+    return half | static_cast<uint16_t>(sign >> 16);
+}
+
+float half_to_float(uint16_t half) {
+    const int exponent = (half >> 10) & 0x1f;
+    const int mantissa = half & 0x3ff;
+    float value;
+    if (exponent == 0) {
+        value = std::ldexp(float(mantissa), -24);
+    } else if (exponent == 0x1f) {
+        value = mantissa ? std::numeric_limits<float>::quiet_NaN()
+                         : std::numeric_limits<float>::infinity();
+    } else {
+        value = std::ldexp(float(mantissa | 0x400), exponent - 25);
+    }
+    return (half & 0x8000) ? -value : value;
+}
+
+QuantizationBox quantization_box(span<const AAVertex> vertices) {
+    if (vertices.empty()) {
+        return {p32(0, 0), 1.0f};
+    }
+    p32 min = vertices[0].coords, max = vertices[0].coords;
+    for (auto &v : vertices) {
+        min.x = std::min(min.x, v.coords.x);
+        min.y = std::min(min.y, v.coords.y);
+        max.x = std::max(max.x, v.coords.x);
+        max.y = std::max(max.y, v.coords.y);
+    }
+    const uint32_t extent = std::max(max.x - min.x, max.y - min.y);
+    float step = std::max(1.0f, float(extent / double(QUANTIZATION_STEPS)));
+    // float rounding may leave the far edge just past the last step.
+    while (std::round(extent / double(step)) > QUANTIZATION_STEPS) {
+        step = std::nextafter(step, std::numeric_limits<float>::infinity());
+    }
+    return {min, step};
+}
+
+PackedAAVertex pack_vertex(const AAVertex &v, const QuantizationBox &box) {
+    assert(v.style < PackedAAVertex::OUTER_BIT);
+    PackedAAVertex packed;
+    packed.coords = {quantize(v.coords.x, box.origin.x, box.step),
+                     quantize(v.coords.y, box.origin.y, box.step)};
+    packed.style = v.style | (v.is_outer ? PackedAAVertex::OUTER_BIT : 0);
+    packed.extent_vec = {float_to_half(v.extent_vec[0]), float_to_half(v.extent_vec[1])};
+    packed.reserved = 0;
+    return packed;
+}
+
+void pack_vertices(span<const AAVertex> vertices, const QuantizationBox &box,
+                   span<PackedAAVertex> out) {
+    assert(out.size() == vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        out[i] = pack_vertex(vertices[i], box);
+    }
+}
+
+p32 unpack_coords(const PackedAAVertex &v, const QuantizationBox &box) {
+    return p32(box.origin.x + static_cast<uint32_t>(std::lround(v.coords[0] * double(box.step))),
+               box.origin.y + static_cast<uint32_t>(std::lround(v.coords[1] * double(box.step))));
+}
+
+PackedAAMesh pack_aa_mesh(span<const AAVertex> vertices, span<const uint32_t> indices,
+                          uint32_t level) {
+    assert(indices.size() % 3 == 0);
+    // first indices of triangles by tile, ordered so output is deterministic.
+    std::map<uint32_t, vector<size_t>> tiles_triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        tiles_triangles[gg::tile_id_by_pt(vertices[indices[i]].coords, level).id].push_back(i);
+    }
+
+    PackedAAMesh mesh;
+    mesh.indices.reserve(indices.size());
+    vector<uint32_t> local_index(vertices.size(), UNSET);
+    vector<AAVertex> batch_vertices;
+    for (auto &[tile, triangles] : tiles_triangles) {
+        PackedAABatch batch{{}, static_cast<uint32_t>(mesh.indices.size()),
+                            static_cast<uint32_t>(triangles.size() * 3),
+                            static_cast<int32_t>(mesh.vertices.size())};
+        batch_vertices.clear();
+        for (size_t first : triangles) {
+            for (size_t k = first; k < first + 3; ++k) {
+                uint32_t &local = local_index[indices[k]];
+                if (local == UNSET) {
+                    local = batch_vertices.size();
+                    batch_vertices.push_back(vertices[indices[k]]);
+                }
+                mesh.indices.push_back(local);
+            }
+        }
+        for (size_t first : triangles) {
+            for (size_t k = first; k < first + 3; ++k) {
+                local_index[indices[k]] = UNSET;
+            }
+        }
+
+        batch.box = quantization_box(batch_vertices);
+        mesh.vertices.resize(mesh.vertices.size() + batch_vertices.size());
+        pack_vertices(batch_vertices, batch.box,
+                      span<PackedAAVertex>(mesh.vertices.data() + batch.base_vertex,
+                                           batch_vertices.size()));
+        mesh.batches.push_back(batch);
+    }
+    return mesh;
+}
+
+} // namespace roads_shader_aa
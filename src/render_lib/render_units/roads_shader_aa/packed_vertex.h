@@ -0,0 +1,35 @@
+#pragma once
+
+#include "common/global.h"
+#include "types.h"
+
+// Conversion of make_geometry output to the compact layout uploaded to GPU.
+namespace roads_shader_aa {
+
+// IEEE 754 binary16, rounding to nearest even. Out of range values become
+// infinities.
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t half);
+
+// Smallest box whose 16 bit grid covers coordinates of all vertices.
+QuantizationBox quantization_box(span<const AAVertex> vertices);
+
+PackedAAVertex pack_vertex(const AAVertex &v, const QuantizationBox &box);
+void pack_vertices(span<const AAVertex> vertices, const QuantizationBox &box,
+                   span<PackedAAVertex> out);
+p32 unpack_coords(const PackedAAVertex &v, const QuantizationBox &box);
+
+struct PackedAAMesh {
+    vector<PackedAAVertex> vertices;
+    vector<uint32_t> indices;
+    vector<PackedAABatch> batches;
+};
+
+// Splits triangles of arbitrary (untiled) AA mesh into batches by tile of
+// `level` their first vertex falls into, each batch gets its own box so
+// precision does not degrade with the extent of the whole mesh. Vertices
+// shared by batches are duplicated.
+PackedAAMesh pack_aa_mesh(span<const AAVertex> vertices, span<const uint32_t> indices,
+                          uint32_t level);
+
+} // namespace roads_shader_aa
@@ -1,26 +1,34 @@
 #version 330 core
 
+// Coordinates are quantized relative to the box of the batch being drawn:
+// world = origin + coords * quant_step.
 layout(location = 0) in vec2 coords;
-layout(location = 1) in uint isOuter;
-layout(location = 2) in vec3 inColor;
-layout(location = 3) in vec2 extent_vec;
+// Palette index, bit 15 marks outer vertices.
+layout(location = 1) in uint style;
+layout(location = 2) in vec2 extent_vec;
 
-uniform mat4 proj;
-uniform float scale;
-uniform uint data[100];
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
+uniform vec2 origin;
+uniform float quant_step;
+uniform vec3 palette[16];
 
 out vec4 color;
 
 void main() {
-    //if(gl_VertexID % 2 == 1) {
-    if(isOuter == 1u) { // outer
-        color = vec4(inColor, 0.0);
-        vec2 effective_coords = coords + extent_vec / scale;
+    vec2 world_coords = origin + coords * quant_step;
+    vec3 style_color = palette[style & 0x7fffu];
+    if((style & 0x8000u) != 0u) { // outer
+        color = vec4(style_color, 0.0);
+        vec2 effective_coords = world_coords + extent_vec / zoom;
         gl_Position = proj * vec4(effective_coords.x, effective_coords.y, 0.0, 1.0);
 
     } else {
         // inner
-        color = vec4(inColor, 1.0);
-        gl_Position = proj * vec4(coords.x, coords.y, 0.0, 1.0);
+        color = vec4(style_color, 1.0);
+        gl_Position = proj * vec4(world_coords.x, world_coords.y, 0.0, 1.0);
     }
 }
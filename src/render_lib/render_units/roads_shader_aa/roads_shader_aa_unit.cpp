@@ -1,55 +1,26 @@
 #include "roads_shader_aa_unit.h"
-//#include <glm/glm.hpp>
 #include <common/gl_check.h>
-#include <glm/gtc/type_ptr.hpp>
 
 namespace roads_shader_aa {
-bool RoadsShaderAAUnit::load_shaders(std::string shaders_root) {
-    auto shader = shader_program::make_from_fs_bundle(shaders_root, "roads_shader_aa/roads");
+bool RoadsShaderAAUnit::load_shaders(shader_program::ShaderCache &shaders) {
+    auto shader = shaders.get("roads_shader_aa/roads");
     if (!shader) {
         log_err("failed loading shader program for roads");
         return false;
     }
 
     m_shader = std::move(shader);
+    m_palette_location = m_shader->location("palette");
+    m_origin_location = m_shader->location("origin");
+    m_step_location = m_shader->location("quant_step");
 
     return true;
 }
 
-bool RoadsShaderAAUnit::make_buffers() {
+bool RoadsShaderAAUnit::make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap) {
+    m_streamer = &streamer;
+    m_heap = &heap;
     GL_CHECK(glGenVertexArrays(1, &m_vao));
-    GL_CHECK(glGenBuffers(1, &m_vbo));
-    GL_CHECK(glGenBuffers(1, &m_ebo));
-
-    GL_CHECK(glBindVertexArray(m_vao));
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vbo));
-    GL_CHECK(glBufferData(GL_ARRAY_BUFFER, 100'000'000, NULL, GL_DYNAMIC_DRAW));
-
-    static_assert(sizeof(p32) == sizeof(uint32_t) * 2); // todo: fix me.
-    GL_CHECK(glVertexAttribPointer(0, 2, GL_UNSIGNED_INT, GL_FALSE, sizeof(AAVertex),
-                                   (void *)offsetof(AAVertex, coords)));
-    GL_CHECK(glVertexAttribIPointer(1, 1, GL_BYTE, sizeof(AAVertex),
-                                    (void *)offsetof(AAVertex, is_outer)));
-    // glVertexAttribIPointer(2, 3, GL_UNSIGNED_BYTE, sizeof(AAVertex),
-    //                        (void *)offsetof(AAVertex, color));
-    GL_CHECK(glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(AAVertex),
-                                   (void *)offsetof(AAVertex, color)));
-
-    GL_CHECK(glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(AAVertex),
-                                   (void *)offsetof(AAVertex, extent_vec)));
-
-    GL_CHECK(glEnableVertexAttribArray(0));
-    GL_CHECK(glEnableVertexAttribArray(1));
-    GL_CHECK(glEnableVertexAttribArray(2));
-    GL_CHECK(glEnableVertexAttribArray(3));
-
-    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
-
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferData(GL_ELEMENT_ARRAY_BUFFER, 60'000'000, NULL, GL_DYNAMIC_DRAW));
-    // DO NOT UNBIND EBO!
-
-    GL_CHECK(glBindVertexArray(0)); // unbind vao.
 
     m_vertices_uploaded = 0;
     m_indices_uploaded = 0;
@@ -57,47 +28,91 @@ bool RoadsShaderAAUnit::make_buffers() {
     return true;
 }
 
-void RoadsShaderAAUnit::set_data(span<AAVertex> aa_vertices, span<uint32_t> aa_indices) {
-    assert(m_vbo != 0);
-    assert(m_ebo != 0);
+void RoadsShaderAAUnit::set_data(span<const PackedAAVertex> aa_vertices,
+                                 span<const uint32_t> aa_indices,
+                                 span<const PackedAABatch> batches) {
+    assert(m_vao != 0);
+
+    const unsigned old_vertex_buffer = m_vertices.buffer;
+    const unsigned old_index_buffer = m_indices.buffer;
+    bool deleted = m_heap->release(m_vertices);
+    deleted |= m_heap->release(m_indices);
+    m_vertices = m_heap->allocate(aa_vertices.size() * sizeof(PackedAAVertex),
+                                  sizeof(PackedAAVertex));
+    m_indices = m_heap->allocate(aa_indices.size() * sizeof(uint32_t));
+    m_streamer->upload(m_vertices.buffer, m_vertices.offset, aa_vertices);
+    m_streamer->upload(m_indices.buffer, m_indices.offset, aa_indices);
+
+    m_vertices_uploaded = aa_vertices.size();
+    m_indices_uploaded = aa_indices.size();
+    m_batches.assign(batches.begin(), batches.end());
+    if (m_vertices.empty()) {
+        return;
+    }
+    // Attributes point to the start of the buffer, so they stay valid while
+    // the data stays in the same buffers.
+    if (!deleted && m_vertices.buffer == old_vertex_buffer &&
+        m_indices.buffer == old_index_buffer) {
+        return;
+    }
+
+    render::bind_vao(m_vao);
+    GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_vertices.buffer));
 
-    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-    GL_CHECK(glBufferSubData(GL_ARRAY_BUFFER, 0, aa_vertices.size() * sizeof(aa_vertices[0]),
-                             aa_vertices.data()));
+    // coordinates are quantized relative to batch box, see vertex shader.
+    GL_CHECK(glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(PackedAAVertex),
+                                   (void *)offsetof(PackedAAVertex, coords)));
+    GL_CHECK(glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(PackedAAVertex),
+                                    (void *)offsetof(PackedAAVertex, style)));
+    GL_CHECK(glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedAAVertex),
+                                   (void *)offsetof(PackedAAVertex, extent_vec)));
+
+    GL_CHECK(glEnableVertexAttribArray(0));
+    GL_CHECK(glEnableVertexAttribArray(1));
+    GL_CHECK(glEnableVertexAttribArray(2));
 
     GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo));
-    GL_CHECK(glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, aa_indices.size() * sizeof(aa_indices[0]),
-                             aa_indices.data()));
+    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indices.buffer));
+    // DO NOT UNBIND EBO!
 
-    GL_CHECK(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    render::bind_vao(0); // unbind vao.
+}
 
-    m_vertices_uploaded = aa_vertices.size();
-    m_indices_uploaded = aa_indices.size();
+void RoadsShaderAAUnit::set_palette(span<const Color> palette) {
+    if (palette.size() > MAX_PALETTE_SIZE) {
+        log_warn("palette of {} colors is truncated to {}", palette.size(), MAX_PALETTE_SIZE);
+        palette = palette.first(MAX_PALETTE_SIZE);
+    }
+    m_palette.assign(palette.begin(), palette.end());
 }
 
 /*virtual*/
 void RoadsShaderAAUnit::render_frame(const camera::Cam2d &cam) /*override*/ {
+    // Projection and zoom come from the frame uniform block. The program is
+    // shared with other units, so the palette is set every frame.
     m_shader->attach();
-    auto proj = cam.projection_maxtrix();
-    GL_CHECK(glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                                glm::value_ptr(proj)));
-    GL_CHECK(glUniform1f(glGetUniformLocation(m_shader->id, "scale"), (float)cam.zoom));
-
-    unsigned data[100];
-    for (size_t i = 0; i < 100; ++i) {
-        data[i] = i * 10;
-    }
-
-    GL_CHECK(glUniform1uiv(glGetUniformLocation(m_shader->id, "data"), 100, &data[0]));
-
-    // log_debug("drawing: {}", m_indices_uploaded);
 
-    GL_CHECK(glBindVertexArray(m_vao));
-
-    GL_CHECK(glDrawElements(GL_TRIANGLES, m_indices_uploaded, GL_UNSIGNED_INT, 0));
-    glBindVertexArray(0);
-    m_shader->detach();
+    float palette[MAX_PALETTE_SIZE * 3] = {};
+    for (size_t i = 0; i < m_palette.size(); ++i) {
+        palette[i * 3] = m_palette[i].r;
+        palette[i * 3 + 1] = m_palette[i].g;
+        palette[i * 3 + 2] = m_palette[i].b;
+    }
+    GL_CHECK(glUniform3fv(m_palette_location, MAX_PALETTE_SIZE, palette));
+
+    render::bind_vao(m_vao);
+
+    // Attributes point to the start of the heap buffer.
+    const int32_t first_vertex = m_vertices.offset / sizeof(PackedAAVertex);
+    for (auto &batch : m_batches) {
+        GL_CHECK(glUniform2f(m_origin_location, batch.box.origin.x, batch.box.origin.y));
+        GL_CHECK(glUniform1f(m_step_location, batch.box.step));
+        GL_CHECK(glDrawElementsBaseVertex(
+            GL_TRIANGLES, batch.indices_count, GL_UNSIGNED_INT,
+            (void *)(m_indices.offset + batch.first_index * sizeof(uint32_t)),
+            first_vertex + batch.base_vertex));
+        render::count_draw(batch.indices_count);
+    }
 }
 } // namespace roads_shader_aa
\ No newline at end of file
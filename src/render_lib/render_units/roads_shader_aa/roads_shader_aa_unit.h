@@ -4,29 +4,50 @@
 #include "common/global.h"
 #include "common/log.h"
 #include "glad/glad.h"
+#include "render_lib/buffer_streamer.h"
+#include "render_lib/gpu_heap.h"
 #include "render_lib/i_render_unit.h"
 #include <cstddef>
 #include <gg/gg.h>
 #include <tuple>
 #include <vector>
 
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 #include "types.h"
 
 namespace roads_shader_aa {
 class RoadsShaderAAUnit : public IRenderUnit {
     unsigned m_vao = 0;
-    unsigned m_vbo = 0;
-    unsigned m_ebo = 0;
+    render::GpuRange m_vertices; // aligned to vertex size.
+    render::GpuRange m_indices;
+    render::BufferStreamer *m_streamer = nullptr;
+    render::GpuHeap *m_heap = nullptr;
 
     size_t m_vertices_uploaded = 0;
     size_t m_indices_uploaded = 0;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    vector<PackedAABatch> m_batches;
+    vector<Color> m_palette = {Color{0.53, 0.54, 0.55}};
+    std::shared_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    int m_palette_location = -1;
+    int m_origin_location = -1;
+    int m_step_location = -1;
 
   public:
-    bool load_shaders(std::string shaders_root);
-    void set_data(span<AAVertex> aa_vertex_data, span<uint32_t> aa_vertex_indices);
-    bool make_buffers(); // todo: should not be part of interface.
+    // Size of palette uniform in the shader.
+    static constexpr size_t MAX_PALETTE_SIZE = 16;
+
+    bool load_shaders(shader_program::ShaderCache &shaders);
+    // Geometry packed with pack_aa_mesh or read from a tile pack, every batch
+    // is drawn with its own quantization box.
+    void set_data(span<const PackedAAVertex> aa_vertex_data, span<const uint32_t> aa_vertex_indices,
+                  span<const PackedAABatch> batches);
+    // Colors of vertices by their style, alpha is ignored.
+    void set_palette(span<const Color> palette);
+    // Data is uploaded through streamer into ranges of heap, both must outlive
+    // the unit. todo: should not be part of interface.
+    bool make_buffers(render::BufferStreamer &streamer, render::GpuHeap &heap);
     virtual void render_frame(const camera::Cam2d &cam) override;
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
 };
 } // namespace roads_shader_aa
\ No newline at end of file
@@ -4,11 +4,42 @@
 #include <array>
 
 namespace roads_shader_aa {
+// Vertex as produced by make_geometry, absolute coordinates in full
+// precision. It is packed into PackedAAVertex before upload.
 struct AAVertex {
     gg::p32 coords;
     uint8_t is_outer;
-    // std::array<uint8_t,3> color;
-    std::array<float, 3> color;
+    uint16_t style; // index of color in RoadsShaderAAUnit palette.
     std::array<float, 2> extent_vec;
 };
+
+// Vertex as stored in tile packs and uploaded to GPU, 12 bytes instead of 32
+// of AAVertex. Coordinates are quantized relative to QuantizationBox of the
+// batch the vertex belongs to, extent vector is a pair of IEEE half floats.
+struct PackedAAVertex {
+    static constexpr uint16_t OUTER_BIT = 0x8000;
+
+    std::array<uint16_t, 2> coords;
+    uint16_t style; // palette index, OUTER_BIT is set for outer vertices.
+    std::array<uint16_t, 2> extent_vec;
+    uint16_t reserved;
+};
+static_assert(sizeof(PackedAAVertex) == 12);
+
+// Maps quantized coordinates back to world: origin + coords * step.
+struct QuantizationBox {
+    gg::p32 origin;
+    float step; // units, >= 1.
+};
+static_assert(sizeof(QuantizationBox) == 12);
+
+// Range of packed geometry sharing one QuantizationBox, drawn by one call.
+// Indices are relative to base_vertex.
+struct PackedAABatch {
+    QuantizationBox box;
+    uint32_t first_index;
+    uint32_t indices_count;
+    int32_t base_vertex;
+};
+
 } // namespace roads_shader_aa
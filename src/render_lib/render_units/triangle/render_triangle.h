@@ -6,7 +6,7 @@
 
 #include "render_lib/i_render_unit.h"
 
-#include "render_lib/shader_program.h"
+#include "render_lib/shader_cache.h"
 
 namespace {
 struct Vertex { 
@@ -23,7 +23,7 @@ Vertex vertices3[] = {
 class TriangleUnit : public IRenderUnit {
     unsigned m_vao = -1;
     unsigned m_vbo = -1;
-    std::unique_ptr<shader_program::ShaderProgram> m_shader = nullptr;
+    std::shared_ptr<shader_program::ShaderProgram> m_shader = nullptr;
 
   public:
     glm::vec2 triangle_center() const {
@@ -35,8 +35,8 @@ class TriangleUnit : public IRenderUnit {
         return glm::vec2{cx, cy};
     }
 
-    bool load_shaders(std::string shaders_root) {
-        auto shader = shader_program::make_from_fs_bundle(shaders_root, "triangle/triangle");
+    bool load_shaders(shader_program::ShaderCache &shaders) {
+        auto shader = shaders.get("triangle/triangle");
         if (!shader) {
             log_err("failed loading shader program for triangle");
             return false;
@@ -48,7 +48,7 @@ class TriangleUnit : public IRenderUnit {
     void upload_geometry() {
         glGenVertexArrays(1, &m_vao);
         glGenBuffers(1, &m_vbo);
-        glBindVertexArray(m_vao);
+        render::bind_vao(m_vao);
         glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
         glBufferData(GL_ARRAY_BUFFER, sizeof(vertices3), &vertices3[0], GL_STATIC_DRAW);
         // data vec3
@@ -60,20 +60,21 @@ class TriangleUnit : public IRenderUnit {
                               (void *)offsetof(Vertex, col));
         glEnableVertexAttribArray(1);
         glBindBuffer(GL_ARRAY_BUFFER, 0); // unbind
-        glBindVertexArray(0);             // unbind
+        render::bind_vao(0);              // unbind
     }
 
+    unsigned program() const override { return m_shader ? m_shader->id : 0; }
+    unsigned vao() const override { return m_vao; }
+
     virtual void render_frame(const camera::Cam2d &camera) override {
         if (!m_shader) {
             log_err("triangle shader not ready");
             return;
         }
 
-        glUseProgram(m_shader->id);
-        auto proj = camera.projection_maxtrix();
-        glUniformMatrix4fv(glGetUniformLocation(m_shader->id, "proj"), 1, GL_FALSE,
-                           glm::value_ptr(proj));
-        glBindVertexArray(m_vao);
+        m_shader->attach();
+        render::bind_vao(m_vao);
         glDrawArrays(GL_TRIANGLES, 0, 3);
+        render::count_draw(3);
     }
 };
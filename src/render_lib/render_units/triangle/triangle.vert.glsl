@@ -4,7 +4,11 @@ layout(location = 1) in float col;
 
 out float color;
 
-uniform mat4 proj;
+layout(std140) uniform Frame {
+    mat4 proj;
+    float zoom;
+    float rotation;
+};
 
 void main() {
     color = col;
@@ -0,0 +1,244 @@
+#include <render_lib/shader_cache.h>
+
+#include <common/gl_check.h>
+#include <common/log.h>
+#include <fstream>
+#include <system_error>
+
+namespace shader_program {
+
+namespace {
+constexpr uint32_t BINARY_MAGIC = 0x42505047; // "GGPB"
+
+// FNV-1a, stable between runs unlike std::hash.
+uint64_t fnv1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325ull) {
+    for (char c : data) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t sources_hash(const std::string &v_src, const std::string &f_src) {
+    // Separator, so moving text from one shader to another changes the hash.
+    return fnv1a(f_src, fnv1a(std::string_view("\0", 1), fnv1a(v_src)));
+}
+
+class GlProgram : public ProgramGl {
+  public:
+    GlProgram(PFNGLGETPROGRAMBINARYPROC get_program_binary, PFNGLPROGRAMBINARYPROC program_binary,
+              PFNGLPROGRAMPARAMETERIPROC program_parameteri)
+        : m_get_program_binary(get_program_binary), m_program_binary(program_binary),
+          m_program_parameteri(program_parameteri) {}
+
+    std::string driver() const override {
+        auto str = [](GLenum name) {
+            auto *s = reinterpret_cast<const char *>(glGetString(name));
+            return std::string(s ? s : "");
+        };
+        return str(GL_VENDOR) + "|" + str(GL_RENDERER) + "|" + str(GL_VERSION);
+    }
+
+    bool has_program_binary() const override {
+        if (!m_get_program_binary || !m_program_binary || !m_program_parameteri) {
+            return false;
+        }
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        return formats > 0;
+    }
+
+    unsigned compile(const std::string &name, const std::string &v_src,
+                     const std::string &f_src) override {
+        unsigned program = glCreateProgram();
+        if (m_program_parameteri) {
+            // Must be set before linking, or the driver may not keep the binary.
+            m_program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        if (!compile_and_link(program, v_src, f_src, name)) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    bool get_binary(unsigned program, uint32_t &format, vector<uint8_t> &binary) override {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return false;
+        }
+        binary.resize(length);
+        GLenum binary_format = 0;
+        GL_CHECK(m_get_program_binary(program, length, nullptr, &binary_format, binary.data()));
+        format = binary_format;
+        return true;
+    }
+
+    unsigned load_binary(uint32_t format, span<const uint8_t> binary) override {
+        unsigned program = glCreateProgram();
+        m_program_binary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+        // A rejected binary is GL_INVALID_ENUM for an unknown format or a
+        // failed link status, neither is a bug.
+        while (glGetError() != GL_NO_ERROR) {
+        }
+        GLint linked = 0;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    ShaderProgram::locations_t prepare(unsigned program) override {
+        return prepare_linked(program);
+    }
+
+    void delete_program(unsigned program) override { GL_CHECK(glDeleteProgram(program)); }
+
+  private:
+    PFNGLGETPROGRAMBINARYPROC m_get_program_binary;
+    PFNGLPROGRAMBINARYPROC m_program_binary;
+    PFNGLPROGRAMPARAMETERIPROC m_program_parameteri;
+};
+} // namespace
+
+std::unique_ptr<ProgramGl> make_program_gl(void *(*proc_address)(const char *)) {
+    PFNGLGETPROGRAMBINARYPROC get_program_binary = nullptr;
+    PFNGLPROGRAMBINARYPROC program_binary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC program_parameteri = nullptr;
+    const bool gl_4_1 = GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 1);
+    if (gl_4_1 || has_gl_extension("GL_ARB_get_program_binary")) {
+        get_program_binary =
+            reinterpret_cast<PFNGLGETPROGRAMBINARYPROC>(proc_address("glGetProgramBinary"));
+        program_binary = reinterpret_cast<PFNGLPROGRAMBINARYPROC>(proc_address("glProgramBinary"));
+        program_parameteri =
+            reinterpret_cast<PFNGLPROGRAMPARAMETERIPROC>(proc_address("glProgramParameteri"));
+    }
+    return std::make_unique<GlProgram>(get_program_binary, program_binary, program_parameteri);
+}
+
+ShaderCache::ShaderCache(std::unique_ptr<ProgramGl> gl, std::filesystem::path shaders_root,
+                         std::filesystem::path binaries_dir)
+    : m_gl(std::move(gl)), m_shaders_root(std::move(shaders_root)) {
+    if (binaries_dir.empty()) {
+        return;
+    }
+    if (!m_gl->has_program_binary()) {
+        log_debug("shader cache: program binaries are not supported, compiling every start");
+        return;
+    }
+    const std::string driver = m_gl->driver();
+    auto dir = binaries_dir / fmt::format("{:016x}", fnv1a(driver));
+    std::error_code ec;
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        log_warn("shader cache: failed creating {}: {}, binaries are not saved", dir, ec.message());
+        return;
+    }
+    log_debug("shader cache: binaries of {} in {}", driver, dir);
+    m_binaries_dir = std::move(dir);
+}
+
+ShaderCache::~ShaderCache() {
+    for (auto &[key, program] : m_programs) {
+        m_gl->delete_program(program->id);
+    }
+}
+
+std::shared_ptr<ShaderProgram> ShaderCache::get(const std::string &shader_idname) {
+    std::string v_src, f_src;
+    if (!load_fs_bundle(m_shaders_root.string(), shader_idname, v_src, f_src)) {
+        return nullptr;
+    }
+    const uint64_t key = sources_hash(v_src, f_src);
+    if (auto it = m_programs.find(key); it != m_programs.end()) {
+        m_stats.hits++;
+        return it->second;
+    }
+
+    std::filesystem::path binary_path;
+    if (!m_binaries_dir.empty()) {
+        binary_path = m_binaries_dir / fmt::format("{:016x}.bin", key);
+    }
+    unsigned program = binary_path.empty() ? 0 : load(shader_idname, binary_path);
+    if (!program) {
+        program = m_gl->compile(shader_idname, v_src, f_src);
+        if (!program) {
+            return nullptr;
+        }
+        m_stats.compiled++;
+        if (!binary_path.empty()) {
+            save(program, binary_path);
+        }
+    }
+    auto res = std::make_shared<ShaderProgram>(program, m_gl->prepare(program));
+    m_programs.emplace(key, res);
+    m_stats.programs++;
+    return res;
+}
+
+unsigned ShaderCache::load(const std::string &shader_idname,
+                           const std::filesystem::path &binary_path) {
+    std::ifstream fs(binary_path, std::ios::binary);
+    if (!fs) {
+        return 0; // not saved yet.
+    }
+    uint32_t magic = 0;
+    uint32_t format = 0;
+    uint64_t size = 0;
+    fs.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+    fs.read(reinterpret_cast<char *>(&format), sizeof(format));
+    fs.read(reinterpret_cast<char *>(&size), sizeof(size));
+    // Size is checked against the file before allocating, a corrupted one
+    // could ask for any amount of memory.
+    constexpr uint64_t header_size = sizeof(magic) + sizeof(format) + sizeof(size);
+    std::error_code ec;
+    const uint64_t file_size = std::filesystem::file_size(binary_path, ec);
+    unsigned program = 0;
+    if (fs && magic == BINARY_MAGIC && !ec && file_size >= header_size &&
+        size == file_size - header_size) {
+        vector<uint8_t> binary(size);
+        if (fs.read(reinterpret_cast<char *>(binary.data()), size)) {
+            program = m_gl->load_binary(format, binary);
+        }
+    }
+    if (!program) {
+        m_stats.rejected++;
+        log_warn("shader cache: binary of program <{}> is rejected, compiling", shader_idname);
+        return 0;
+    }
+    m_stats.loaded++;
+    return program;
+}
+
+void ShaderCache::save(unsigned program, const std::filesystem::path &binary_path) {
+    uint32_t format = 0;
+    vector<uint8_t> binary;
+    if (!m_gl->get_binary(program, format, binary)) {
+        return;
+    }
+    // Written aside and renamed, so another instance never reads half a file.
+    auto tmp_path = binary_path;
+    tmp_path += ".tmp";
+    {
+        std::ofstream fs(tmp_path, std::ios::binary | std::ios::trunc);
+        const uint64_t size = binary.size();
+        fs.write(reinterpret_cast<const char *>(&BINARY_MAGIC), sizeof(BINARY_MAGIC));
+        fs.write(reinterpret_cast<const char *>(&format), sizeof(format));
+        fs.write(reinterpret_cast<const char *>(&size), sizeof(size));
+        fs.write(reinterpret_cast<const char *>(binary.data()), binary.size());
+        if (!fs) {
+            log_warn("shader cache: failed writing {}", tmp_path);
+            return;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp_path, binary_path, ec);
+    if (ec) {
+        log_warn("shader cache: failed saving {}: {}", binary_path, ec.message());
+    }
+}
+
+} // namespace shader_program
@@ -0,0 +1,121 @@
+#include <render_lib/tile_cache.h>
+
+#include <algorithm>
+
+namespace render {
+
+TileCache::TileCache(Budget budget, evict_fn evict) : m_budget(budget), m_evict(std::move(evict)) {}
+
+void TileCache::begin_frame() { m_frame++; }
+
+void TileCache::use(lru_t::iterator it) {
+    it->last_frame = m_frame;
+    m_lru.splice(m_lru.begin(), m_lru, it);
+}
+
+bool TileCache::touch(gg::tile_at_level_t tile) {
+    auto it = m_entries.find(gg::tile_key(tile));
+    if (it == m_entries.end()) {
+        m_stats.misses++;
+        return false;
+    }
+    m_stats.hits++;
+    use(it->second);
+    return true;
+}
+
+optional<gg::tile_at_level_t> TileCache::touch_fallback(gg::tile_at_level_t tile) {
+    while (tile.level > 0) {
+        tile = gg::parent_tile(tile);
+        auto it = m_entries.find(gg::tile_key(tile));
+        if (it != m_entries.end()) {
+            use(it->second);
+            return tile;
+        }
+    }
+    return std::nullopt;
+}
+
+bool TileCache::contains(gg::tile_at_level_t tile) const {
+    return m_entries.count(gg::tile_key(tile)) > 0;
+}
+
+bool TileCache::insert(gg::tile_at_level_t tile, size_t cpu_bytes, size_t gpu_bytes) {
+    if (cpu_bytes > m_budget.cpu_bytes || gpu_bytes > m_budget.gpu_bytes) {
+        m_stats.rejected++;
+        return false;
+    }
+    auto existing = m_entries.find(gg::tile_key(tile));
+    if (existing != m_entries.end()) {
+        // used in this frame, so it is not evicted to make room for itself.
+        use(existing->second);
+        Entry &e = *existing->second;
+        if (!make_room(cpu_bytes - std::min(cpu_bytes, e.cpu_bytes),
+                       gpu_bytes - std::min(gpu_bytes, e.gpu_bytes))) {
+            m_stats.rejected++;
+            return false;
+        }
+        m_stats.cpu_bytes = m_stats.cpu_bytes - e.cpu_bytes + cpu_bytes;
+        m_stats.gpu_bytes = m_stats.gpu_bytes - e.gpu_bytes + gpu_bytes;
+        e.cpu_bytes = cpu_bytes;
+        e.gpu_bytes = gpu_bytes;
+        return true;
+    }
+    if (!make_room(cpu_bytes, gpu_bytes)) {
+        m_stats.rejected++;
+        return false;
+    }
+    m_lru.push_front(Entry{tile, cpu_bytes, gpu_bytes, m_frame});
+    m_entries[gg::tile_key(tile)] = m_lru.begin();
+    m_stats.tiles++;
+    m_stats.cpu_bytes += cpu_bytes;
+    m_stats.gpu_bytes += gpu_bytes;
+    return true;
+}
+
+void TileCache::set_budget(Budget budget) {
+    m_budget = budget;
+    evict_to_fit(0, 0);
+}
+
+bool TileCache::fits(size_t cpu_bytes, size_t gpu_bytes) const {
+    return m_stats.cpu_bytes + cpu_bytes <= m_budget.cpu_bytes &&
+           m_stats.gpu_bytes + gpu_bytes <= m_budget.gpu_bytes;
+}
+
+bool TileCache::make_room(size_t cpu_bytes, size_t gpu_bytes) {
+    // Counted before evicting anything, so a rejected tile leaves the cache
+    // as it was instead of dropping tiles which would be streamed again.
+    size_t cpu_left = m_stats.cpu_bytes;
+    size_t gpu_left = m_stats.gpu_bytes;
+    for (auto it = m_lru.rbegin(); cpu_left + cpu_bytes > m_budget.cpu_bytes ||
+                                   gpu_left + gpu_bytes > m_budget.gpu_bytes;
+         ++it) {
+        if (it == m_lru.rend() || it->last_frame == m_frame) {
+            return false; // so are all the others.
+        }
+        cpu_left -= it->cpu_bytes;
+        gpu_left -= it->gpu_bytes;
+    }
+    evict_to_fit(cpu_bytes, gpu_bytes);
+    return true;
+}
+
+void TileCache::evict_to_fit(size_t cpu_bytes, size_t gpu_bytes) {
+    while (!fits(cpu_bytes, gpu_bytes) && !m_lru.empty() && m_lru.back().last_frame != m_frame) {
+        const gg::tile_at_level_t tile = m_lru.back().tile;
+        erase(std::prev(m_lru.end()));
+        m_stats.evictions++;
+        m_evict(tile);
+    }
+}
+
+void TileCache::erase(lru_t::iterator it) {
+    m_stats.tiles--;
+    m_stats.cpu_bytes -= it->cpu_bytes;
+    m_stats.gpu_bytes -= it->gpu_bytes;
+    m_entries.erase(gg::tile_key(it->tile));
+    m_lru.erase(it);
+}
+
+} // namespace render
@@ -0,0 +1,89 @@
+#include <render_lib/visible_tiles.h>
+
+#include <cmath>
+#include <unordered_set>
+
+namespace camera {
+
+TileRect visible_tiles(const Cam2d &cam, uint32_t level) {
+    const float w = cam.window_size.x, h = cam.window_size.y;
+    glm::vec2 corners[] = {cam.unproject({0, 0}), cam.unproject({w, 0}), cam.unproject({0, h}),
+                           cam.unproject({w, h})};
+    double min_x = corners[0].x, max_x = corners[0].x;
+    double min_y = corners[0].y, max_y = corners[0].y;
+    for (auto &c : corners) {
+        min_x = std::min<double>(min_x, c.x);
+        max_x = std::max<double>(max_x, c.x);
+        min_y = std::min<double>(min_y, c.y);
+        max_y = std::max<double>(max_y, c.y);
+    }
+    // unproject() works in floats which are only ~500 units precise at the
+    // far end of the world, a few pixels of margin cover that.
+    const double margin = 4.0 / cam.zoom;
+    const auto to_units = [](double v) {
+        return static_cast<uint32_t>(std::clamp<double>(v, 0.0, gg::U32_MAX));
+    };
+    const gg::tile_id_t top_left = gg::tile_id_by_pt(
+        gg::p32(to_units(min_x - margin), to_units(min_y - margin)), level);
+    const gg::tile_id_t bottom_right = gg::tile_id_by_pt(
+        gg::p32(to_units(max_x + margin), to_units(max_y + margin)), level);
+    return {level, top_left.x, top_left.y, bottom_right.x, bottom_right.y};
+}
+
+void covering_tiles(const TileRect &visible, span<const gg::tile_at_level_t> resident,
+                    vector<gg::tile_at_level_t> &out) {
+    // Tiles coarser than visible.level with a resident tile below them.
+    std::unordered_set<uint64_t> branches;
+    for (gg::tile_at_level_t t : resident) {
+        while (t.level > 0) {
+            t = gg::parent_tile(t);
+            if (t.level < visible.level && !branches.insert(gg::tile_key(t)).second) {
+                break; // the rest of ancestors are there already.
+            }
+        }
+    }
+    const auto intersects = [&](gg::tile_at_level_t t) {
+        const uint32_t shift = visible.level - t.level;
+        const uint32_t min_x = uint32_t(t.id.x) << shift, max_x = ((t.id.x + 1u) << shift) - 1;
+        const uint32_t min_y = uint32_t(t.id.y) << shift, max_y = ((t.id.y + 1u) << shift) - 1;
+        return max_x >= visible.min_x && min_x <= visible.max_x && max_y >= visible.min_y &&
+               min_y <= visible.max_y;
+    };
+    // Level 0 is 2x2 tiles, see gg::tile_bb.
+    vector<gg::tile_at_level_t> stack;
+    for (uint16_t y = 0; y < 2; ++y) {
+        for (uint16_t x = 0; x < 2; ++x) {
+            stack.push_back({gg::tile_id_t(x, y), 0});
+        }
+    }
+    while (!stack.empty()) {
+        const gg::tile_at_level_t t = stack.back();
+        stack.pop_back();
+        if (!intersects(t)) {
+            continue;
+        }
+        if (t.level == visible.level || !branches.count(gg::tile_key(t))) {
+            out.push_back(t);
+            continue;
+        }
+        for (gg::tile_id_t child : gg::children_tiles(t)) {
+            stack.push_back({child, t.level + 1});
+        }
+    }
+}
+
+uint32_t level_for_zoom(const Cam2d &cam) {
+    // tile of level L is 2^(31 - L) units wide, see gg::tile_bb.
+    const double window = std::max(cam.window_size.x, cam.window_size.y);
+    const double tile_units = window / 2.0 / cam.zoom;
+    const double level = std::floor(31.0 - std::log2(std::max(tile_units, 1.0)));
+    return static_cast<uint32_t>(std::clamp(level, 0.0, 15.0));
+}
+
+uint32_t closest_level(span<const uint32_t> levels, uint32_t wanted) {
+    assert(!levels.empty());
+    auto it = std::upper_bound(levels.begin(), levels.end(), wanted);
+    return it == levels.begin() ? levels.front() : *std::prev(it);
+}
+
+} // namespace camera